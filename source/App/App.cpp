@@ -1,12 +1,25 @@
 #include "App.h"
 #include <csignal>
 #include <filesystem>
+#include <map>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "EventLog/EventLog.h"
+#include "File/FileWatcher.h"
+#include "Pipeline/GstLogBridge.h"
 #include "Pipeline/PipelineManager.h"
 #include "Pipeline/PipelineCommands.h"
 #include "AppInputs/MessageServer.h"
 #include "Network/TcpNetworkManager.h"
+#include "Network/UnixNetworkManager.h"
+#include "Network/UringNetworkManager.h"
+#include "TasksManager/CommandCoalescer.h"
 #include "TasksManager/CommandDispatcher.h"
+#include "TasksManager/OperationTracker.h"
 #include "TasksManager/Scheduler.h"
+#include "TasksManager/SchedulerCommands.h"
+#include "App/LocalPipeline.h"
 #include "App/SignalHandler.h"
 
 std::atomic<bool> App::keep_running_ = true;
@@ -16,6 +29,14 @@ void App::shutdown() {
     LOG_INFO("Terminating...");
 }
 
+std::pair<std::filesystem::path, std::string> App::parsePipelineSpec(const std::string& spec) {
+    if (const auto separator = spec.rfind(':');
+        separator != std::string::npos && spec.find('/', separator) == std::string::npos) {
+        return {spec.substr(0, separator), spec.substr(separator + 1)};
+    }
+    return {spec, std::string{}};
+}
+
 std::filesystem::path get_pipeline_file_path(const std::filesystem::path& file_path) {
     std::filesystem::path pipeline_file = std::filesystem::current_path() / file_path;
     if (!exists(pipeline_file)) {
@@ -28,6 +49,154 @@ std::filesystem::path get_pipeline_file_path(const std::filesystem::path& file_p
     return pipeline_file;
 }
 
+// Registers the enable/disable commands of the optional elements and branches, along with the enable_<target> and
+// disable_<target> verbs of the first releases, and drops the commands of the ones that are gone. registered maps
+// each target to whether it is a branch.
+void register_pipeline_commands(CommandDispatcher& dispatcher, const std::shared_ptr<PipelineManager>& pipeline_manager,
+                                std::map<std::string, bool>& registered) {
+    std::map<std::string, bool> targets;
+    for (const auto& element_name: pipeline_manager->getOptionalPipelineElementsNames()) {
+        targets.emplace(element_name, false);
+    }
+    for (const auto& branch_name: pipeline_manager->getOptionalPipelineBranchesNames()) {
+        targets.emplace(branch_name, true);
+    }
+
+    for (const auto& [target, is_branch]: registered) {
+        if (const auto it = targets.find(target); it == targets.end() || it->second != is_branch) {
+            dispatcher.unregisterCommand("enable", target);
+            dispatcher.unregisterCommand("disable", target);
+            dispatcher.unregisterCommand("enable_" + target);
+            dispatcher.unregisterCommand("disable_" + target);
+        }
+    }
+    for (const auto& [target, is_branch]: targets) {
+        if (const auto it = registered.find(target); it != registered.end() && it->second == is_branch) {
+            continue;
+        }
+        std::shared_ptr<CommandInterface> enable_command;
+        std::shared_ptr<CommandInterface> disable_command;
+        if (is_branch) {
+            enable_command = std::make_shared<EnableOptionalBranchCommand>(pipeline_manager, target);
+            disable_command = std::make_shared<DisableOptionalBranchCommand>(pipeline_manager, target);
+        } else {
+            enable_command = std::make_shared<EnableOptionalElementCommand>(pipeline_manager, target);
+            disable_command = std::make_shared<DisableOptionalElementCommand>(pipeline_manager, target);
+        }
+        dispatcher.registerCommand("enable", target, enable_command);
+        dispatcher.registerCommand("disable", target, disable_command);
+        dispatcher.registerCommand("enable_" + target, enable_command);
+        dispatcher.registerCommand("disable_" + target, disable_command);
+    }
+    registered = std::move(targets);
+}
+
+void register_pipeline_manager_commands(CommandDispatcher& dispatcher, const std::shared_ptr<PipelineManager>& pipeline_manager) {
+    dispatcher.registerCommand("enable_elements",
+                               std::make_shared<EnableAllOptionalElementsCommand>(pipeline_manager));
+    dispatcher.registerCommand("disable_elements",
+                               std::make_shared<DisableAllOptionalElementsCommand>(pipeline_manager));
+    dispatcher.registerCommand("enable_branches",
+                               std::make_shared<EnableAllOptionalBranchesCommand>(pipeline_manager));
+    dispatcher.registerCommand("disable_branches",
+                               std::make_shared<DisableAllOptionalBranchesCommand>(pipeline_manager),
+                               CommandPriority::Critical);
+}
+
+// Pipelines run next to the input one, each controlled through "<name> <command>" where the name is the instance or
+// the file name without its extension
+std::vector<std::shared_ptr<LocalPipeline>> create_local_pipelines(const AppConfig& config, const PipelineStartupOptions& options,
+                                                                   const std::shared_ptr<Scheduler>& scheduler,
+                                                                   const std::shared_ptr<CommandCoalescer>& coalescer,
+                                                                   CommandDispatcher& dispatcher) {
+    std::vector<std::shared_ptr<LocalPipeline>> local_pipelines;
+    for (const auto& spec: config.pipelines) {
+        const auto [file, instance] = App::parsePipelineSpec(spec);
+        const auto name = instance.empty() ? file.stem().string() : instance;
+        auto local_pipeline = std::make_shared<LocalPipeline>(
+            name, get_pipeline_file_path(file), instance, options, scheduler, coalescer,
+            [](CommandDispatcher& local_dispatcher, const std::shared_ptr<PipelineManager>& pipeline_manager) {
+                register_pipeline_manager_commands(local_dispatcher, pipeline_manager);
+                std::map<std::string, bool> registered;
+                register_pipeline_commands(local_dispatcher, pipeline_manager, registered);
+            });
+        dispatcher.registerCommand(name, std::make_shared<LocalPipelineCommand>(local_pipeline));
+        local_pipelines.push_back(std::move(local_pipeline));
+    }
+    return local_pipelines;
+}
+
+std::shared_ptr<NetworkInterface> create_network_manager(const std::string& backend, const unsigned int port,
+                                                         const std::string& control_socket) {
+    if (!control_socket.empty()) {
+        LOG_INFO("Serving commands on unix socket {}", control_socket);
+        return std::make_shared<UnixNetworkManager>(control_socket);
+    }
+    if (backend == "io_uring") {
+        if (UringNetworkManager::isSupported()) {
+            LOG_INFO("Using io_uring network backend");
+            return std::make_shared<UringNetworkManager>(port);
+        }
+        LOG_WARN("io_uring is not supported by the kernel, falling back to select network backend");
+    } else if (backend != "select") {
+        LOG_WARN("Unknown network backend '{}', using select network backend", backend);
+    }
+
+    return std::make_shared<TcpNetworkManager>(port);
+}
+
+GstState get_standby_state(const std::string& standby) {
+    if (standby == "null") {
+        return GST_STATE_NULL;
+    }
+    if (standby == "ready") {
+        return GST_STATE_READY;
+    }
+    if (standby == "paused") {
+        return GST_STATE_PAUSED;
+    }
+    if (standby != "none") {
+        LOG_WARN("Unknown standby state '{}', running without a standby pipeline", standby);
+    }
+    return GST_STATE_VOID_PENDING;
+}
+
+SourceFiller get_source_filler(const std::string& filler) {
+    if (filler == "none") {
+        return SourceFiller::None;
+    }
+    if (filler == "black") {
+        return SourceFiller::Black;
+    }
+    if (filler != "last") {
+        LOG_WARN("Unknown source filler '{}', repeating the last frame", filler);
+    }
+    return SourceFiller::Last;
+}
+
+// Queues work of a pipeline on the strand its commands run on
+std::function<bool(size_t, std::function<void()>)> get_strand_executor(const std::shared_ptr<Scheduler>& scheduler) {
+    return [weak_scheduler = std::weak_ptr<Scheduler>(scheduler)](const size_t strand_key, std::function<void()> task) {
+        const auto scheduler = weak_scheduler.lock();
+        return scheduler && scheduler->enqueueTask(std::make_shared<PipelineTaskCommand>(strand_key, std::move(task)),
+                                                   CommandPriority::Critical);
+    };
+}
+
+// Tells the supervisor a worker is up, the descriptor is the write end of a pipe it polls
+std::function<void()> get_ready_notifier(const int ready_fd) {
+    if (ready_fd < 0) {
+        return nullptr;
+    }
+    return [ready_fd] {
+        constexpr char READY {'R'};
+        if (write(ready_fd, &READY, 1) != 1) {
+            LOG_WARN("Failed to notify the supervisor");
+        }
+        close(ready_fd);
+    };
+}
+
 int App::run(const AppConfig& config) {
     // SignalHandler::setupSignalHandling(); //FIXME:
 
@@ -35,59 +204,130 @@ int App::run(const AppConfig& config) {
         // gst_debug_set_default_threshold(GST_LEVEL_INFO);
     }
 
-    auto scheduler = std::make_shared<Scheduler>();
+    if (!config.event_log_dir.empty()) {
+        if (auto ec = EventLog::getInstance().open(config.event_log_dir,
+                                                   static_cast<size_t>(config.event_log_segment_size_mb) << 20,
+                                                   config.event_log_segments)) {
+            LOG_WARN("Event log disabled: {}", ec.message());
+        }
+    }
+
+    auto scheduler = std::make_shared<Scheduler>(config.scheduler_threads);
     scheduler->init();
+    if (EventLog::getInstance().isEnabled() && config.event_stats_interval_s != 0) {
+        scheduler->scheduleEvery(std::chrono::seconds(config.event_stats_interval_s), nullptr,
+                                 std::make_shared<RecordStatsEventCommand>(scheduler), CommandPriority::Background);
+    }
+
+    const PipelineStartupOptions startup_options{
+        .plan_cache_directory = config.plan_cache_dir,
+        .registry_file = config.gst_registry_file,
+        .preload_plugins = config.preload_plugins,
+        .use_launch_description = !config.element_by_element,
+        .standby_state = get_standby_state(config.standby),
+        .standby_max_memory_mb = config.standby_max_memory_mb,
+        // Only the input pipeline reports readiness, it is set on its copy below
+        .on_playing = nullptr,
+        .source_recovery = {
+            .enabled = config.source_reconnect,
+            .initial_backoff = std::chrono::milliseconds(config.reconnect_backoff_ms),
+            .max_backoff = std::chrono::milliseconds(std::max(config.reconnect_max_backoff_ms, config.reconnect_backoff_ms)),
+            .no_data_timeout = std::chrono::milliseconds(config.reconnect_timeout_ms),
+            .filler = get_source_filler(config.source_filler)
+        },
+        .strand_executor = get_strand_executor(scheduler)
+    };
+    auto main_startup_options = startup_options;
+    main_startup_options.on_playing = get_ready_notifier(config.ready_fd);
+    std::filesystem::path pipeline_file;
+    std::shared_ptr<PipelineManager> pipeline_manager;
+    try {
+        pipeline_file = get_pipeline_file_path(config.input_file);
+        pipeline_manager = std::make_shared<PipelineManager>(pipeline_file, config.instance, main_startup_options);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Invalid pipeline configuration: {}", e.what());
+        return EXIT_CONFIG_ERROR;
+    }
+    GstLogBridge::setThresholds(pipeline_manager->getStartupSettings().gst_debug);
+    GstLogBridge::setThresholds(config.gst_debug);
 
-    auto pipeline_file = get_pipeline_file_path(config.input_file);
-    auto pipeline_manager = std::make_shared<PipelineManager>(pipeline_file);
+    auto coalescer = std::make_shared<CommandCoalescer>(scheduler, std::chrono::milliseconds(config.debounce_ms));
+    coalescer->init();
 
-    auto dispatcher = std::make_shared<CommandDispatcher>(scheduler);
+    auto operation_tracker = std::make_shared<OperationTracker>(std::chrono::milliseconds(config.deadline_ms));
+    operation_tracker->init();
+
+    auto dispatcher = std::make_shared<CommandDispatcher>(scheduler, coalescer, operation_tracker);
 
 
-    // TODO: Fix cretain commands for multiple elements with the same name
     dispatcher->registerCommand("test",
-                                std::make_shared<CommandFake>());
-    dispatcher->registerCommand("enable_elements",
-                                std::make_shared<EnableAllOptionalElementsCommand>(pipeline_manager));
-    dispatcher->registerCommand("disable_elements",
-                                std::make_shared<DisableAllOptionalElementsCommand>(pipeline_manager));
-    dispatcher->registerCommand("enable_branches",
-                                std::make_shared<EnableAllOptionalBranchesCommand>(pipeline_manager));
-    dispatcher->registerCommand("disable_branches",
-                                std::make_shared<DisableAllOptionalBranchesCommand>(pipeline_manager));
+                                std::make_shared<CommandFake>(), CommandPriority::Query);
+    dispatcher->registerCommand("stats",
+                                std::make_shared<SchedulerStatsCommand>(scheduler), CommandPriority::Query);
+    dispatcher->registerCommand("cancel",
+                                std::make_shared<CancelOperationsCommand>(operation_tracker), CommandPriority::Critical);
+    dispatcher->registerCommand("cancel_all",
+                                std::make_shared<CancelOperationsCommand>(operation_tracker, true), CommandPriority::Critical);
+    register_pipeline_manager_commands(*dispatcher, pipeline_manager);
     dispatcher->registerCommand("stop",
-                                std::make_shared<StopPipelineCommand>(pipeline_manager));
+                                std::make_shared<StopPipelineCommand>(pipeline_manager), CommandPriority::Critical);
+    const std::weak_ptr<CommandDispatcher> weak_dispatcher = dispatcher;
+    dispatcher->registerCommand("schedule", std::make_shared<ScheduleCommand>(weak_dispatcher));
+    dispatcher->registerCommand("unschedule", std::make_shared<UnscheduleCommand>(weak_dispatcher));
+
+    // Only touched by the reload command, which runs on the pipeline strand
+    auto registered_targets = std::make_shared<std::map<std::string, bool>>();
+    register_pipeline_commands(*dispatcher, pipeline_manager, *registered_targets);
+    dispatcher->registerCommand("reload", std::make_shared<ReloadPipelineCommand>(pipeline_manager, [=] {
+        if (const auto reload_dispatcher = weak_dispatcher.lock()) {
+            register_pipeline_commands(*reload_dispatcher, pipeline_manager, *registered_targets);
+        }
+    }));
 
-    for (const auto& optional_element_name: pipeline_manager->getOptionalPipelineElementsNames()) {
-        std::string enable_command_name = "enable_" + optional_element_name;
-        std::string disable_command_name = "disable_" + optional_element_name;
-        dispatcher->registerCommand(enable_command_name,
-                                    std::make_shared<EnableOptionalElementCommand>(
-                                        pipeline_manager, optional_element_name));
-        dispatcher->registerCommand(disable_command_name,
-                                    std::make_shared<DisableOptionalElementCommand>(
-                                        pipeline_manager, optional_element_name));
+    for (const auto& schedule: pipeline_manager->getStartupSettings().schedules) {
+        Scheduler::TimerId timer_id{Scheduler::INVALID_TIMER};
+        if (auto ec = dispatcher->addSchedule(schedule, timer_id)) {
+            LOG_ERROR("Failed to schedule command '{}': {}", schedule.command, ec.message());
+        }
+    }
+
+    // The registry was set up and the plugins were loaded for the input pipeline already. Local pipelines start
+    // on their own threads, which must not change the environment the running threads read.
+    auto local_startup_options = startup_options;
+    local_startup_options.registry_file.clear();
+    local_startup_options.preload_plugins = false;
+    std::vector<std::shared_ptr<LocalPipeline>> local_pipelines;
+    try {
+        local_pipelines = create_local_pipelines(config, local_startup_options, scheduler, coalescer, *dispatcher);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Invalid pipeline configuration: {}", e.what());
+        return EXIT_CONFIG_ERROR;
+    }
+    for (const auto& local_pipeline: local_pipelines) {
+        if (auto ec = local_pipeline->start()) {
+            LOG_ERROR("Failed to start pipeline {}: {}", local_pipeline->getName(), ec.message());
+        }
     }
 
-    for (const auto& optional_branch_name: pipeline_manager->getOptionalPipelineBranchesNames()) {
-        std::string enable_command_name = "enable_" + optional_branch_name;
-        std::string disable_command_name = "disable_" + optional_branch_name;
-        dispatcher->registerCommand(enable_command_name,
-                                    std::make_shared<EnableOptionalBranchCommand>(
-                                        pipeline_manager, optional_branch_name));
-        dispatcher->registerCommand(disable_command_name,
-                                    std::make_shared<DisableOptionalBranchCommand>(
-                                        pipeline_manager, optional_branch_name));
+    std::unique_ptr<FileWatcher> pipeline_file_watcher;
+    if (config.watch) {
+        pipeline_file_watcher = std::make_unique<FileWatcher>(pipeline_file, [weak_dispatcher] {
+            if (const auto watch_dispatcher = weak_dispatcher.lock()) {
+                watch_dispatcher->dispatchCommand("reload");
+            }
+        });
+        pipeline_file_watcher->init();
     }
 
-    auto network_manager = std::make_shared<TcpNetworkManager>(config.port);
+    auto network_manager = create_network_manager(config.network_backend, config.port, config.control_socket);
 
     const auto tcp_server = std::make_shared<MessageServer>(dispatcher, network_manager);
     tcp_server->init();
 
     if (auto ec = pipeline_manager->play()) { // Blocking call
         LOG_ERROR("Failed to play pipeline {}", ec.message());
-        return EXIT_FAILURE;
+        // Elements that cannot be created or linked won't be on a restart either
+        return ec == std::errc::invalid_argument ? EXIT_CONFIG_ERROR : EXIT_FAILURE;
     }
 
     LOG_TRACE("Main thread stopped");
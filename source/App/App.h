@@ -3,19 +3,59 @@
 
 #include <atomic>
 #include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
 
 struct AppConfig {
     std::filesystem::path input_file;
+    std::string instance;
+    std::filesystem::path plan_cache_dir;
+    std::filesystem::path gst_registry_file;
+    bool preload_plugins;
+    std::string standby;
+    unsigned int standby_max_memory_mb;
+    bool source_reconnect;
+    unsigned int reconnect_backoff_ms;
+    unsigned int reconnect_max_backoff_ms;
+    unsigned int reconnect_timeout_ms;
+    std::string source_filler;
+    bool supervise;
+    std::vector<std::string> workers; // <file>[:<instance>] per supervised worker
+    unsigned int restart_backoff_ms;
+    std::string control_socket; // Unix socket replacing the TCP port, '@' selects the abstract namespace
+    std::vector<std::string> pipelines; // <file>[:<instance>] per pipeline run in this process next to the input one
     unsigned int port;
+    std::string network_backend;
+    unsigned int scheduler_threads;
+    unsigned int debounce_ms;
+    unsigned int deadline_ms;
     bool verbose;
+    bool watch;
+    bool element_by_element;
+    bool log_async;
+    std::filesystem::path log_file;
+    std::string log_overflow;
+    unsigned int log_max_size_mb;
+    unsigned int log_rotate_minutes;
+    std::string gst_debug;
+    std::filesystem::path event_log_dir;
+    unsigned int event_log_segment_size_mb;
+    unsigned int event_log_segments;
+    unsigned int event_stats_interval_s;
+    int ready_fd{-1}; // A supervised worker writes one byte to it once the pipeline is PLAYING
 };
 
 class App {
 public:
+    // EX_CONFIG of sysexits.h: the pipeline file or its elements are invalid, so running again won't help
+    static constexpr int EXIT_CONFIG_ERROR {78};
     App() = default;
     ~App() = default;
     static int run(const AppConfig& config);
     static void shutdown();
+    // Splits <file>[:<instance>], a colon inside the path is not an instance separator
+    static std::pair<std::filesystem::path, std::string> parsePipelineSpec(const std::string& spec);
 
 private:
     static std::atomic<bool> keep_running_;
@@ -0,0 +1,129 @@
+#include "LocalPipeline.h"
+#include <chrono>
+#include "Logger/Logger.h"
+
+// A stop sent before the play thread runs its main loop is lost, it is sent again after this long
+constexpr std::chrono::milliseconds STOP_RETRY_INTERVAL {100};
+
+LocalPipeline::LocalPipeline(std::string name, std::filesystem::path pipeline_file, std::string instance_name,
+                             PipelineStartupOptions options, std::shared_ptr<Scheduler> scheduler,
+                             std::shared_ptr<CommandCoalescer> coalescer, CommandRegistrar registrar)
+    : name_(std::move(name)), pipeline_file_(std::move(pipeline_file)), instance_name_(std::move(instance_name)),
+      options_(std::move(options)), scheduler_(std::move(scheduler)), coalescer_(std::move(coalescer)),
+      registrar_(std::move(registrar)) {
+}
+
+LocalPipeline::~LocalPipeline() {
+    stop();
+}
+
+const std::string& LocalPipeline::getName() const {
+    return name_;
+}
+
+std::error_code LocalPipeline::start() {
+    std::lock_guard lock(mutex_);
+    if (pipeline_manager_) {
+        if (!isFinished()) {
+            LOG_WARN("Pipeline {} is already running", name_);
+            return std::make_error_code(std::errc::device_or_resource_busy);
+        }
+        // Stopped on its own, at the end of the stream or on an error
+        retire();
+    }
+
+    std::shared_ptr<PipelineManager> pipeline_manager;
+    try {
+        pipeline_manager = std::make_shared<PipelineManager>(pipeline_file_.string(), instance_name_, options_);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to create pipeline {}: {}", name_, e.what());
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    // Without an operation tracker, the command forwarded to this pipeline already runs as an operation
+    auto dispatcher = std::make_shared<CommandDispatcher>(scheduler_, coalescer_);
+    registrar_(*dispatcher, pipeline_manager);
+
+    {
+        std::lock_guard play_lock(play_mutex_);
+        finished_ = false;
+    }
+    play_thread_ = std::thread([this, pipeline_manager] {
+        if (auto ec = pipeline_manager->play()) { // Blocking call
+            LOG_ERROR("Failed to play pipeline {}: {}", name_, ec.message());
+        }
+        LOG_INFO("Pipeline {} stopped", name_);
+        {
+            std::lock_guard play_lock(play_mutex_);
+            finished_ = true;
+        }
+        play_condition_.notify_all();
+    });
+    pipeline_manager_ = std::move(pipeline_manager);
+    dispatcher_ = std::move(dispatcher);
+    LOG_INFO("Pipeline {} started", name_);
+    return {};
+}
+
+std::error_code LocalPipeline::stop() {
+    std::lock_guard lock(mutex_);
+    if (!pipeline_manager_) {
+        return std::make_error_code(std::errc::no_such_process);
+    }
+
+    {
+        std::unique_lock play_lock(play_mutex_);
+        while (!finished_) {
+            pipeline_manager_->stop();
+            play_condition_.wait_for(play_lock, STOP_RETRY_INTERVAL, [this] { return finished_; });
+        }
+    }
+    retire();
+    return {};
+}
+
+bool LocalPipeline::isFinished() {
+    std::lock_guard play_lock(play_mutex_);
+    return finished_;
+}
+
+void LocalPipeline::retire() {
+    if (play_thread_.joinable()) {
+        play_thread_.join();
+    }
+    dispatcher_.reset();
+
+    // The bus watch of the pipeline is dispatched by the thread running the default main context, releasing the
+    // manager there means no watch runs into it while it is destroyed
+    g_main_context_invoke(nullptr, [](gpointer data) -> gboolean {
+        delete static_cast<std::shared_ptr<PipelineManager>*>(data);
+        return G_SOURCE_REMOVE;
+    }, new std::shared_ptr<PipelineManager>(std::move(pipeline_manager_)));
+}
+
+void LocalPipeline::dispatchCommand(std::shared_ptr<InputInterface::Requester> requester, const std::string_view command) {
+    if (command == "start" || command == "stop") {
+        const auto ec = command == "start" ? start() : stop();
+        requester->source->sendResponse(requester, ec ? "Nack" : "Ack");
+        return;
+    }
+
+    std::shared_ptr<CommandDispatcher> dispatcher;
+    {
+        std::lock_guard lock(mutex_);
+        dispatcher = dispatcher_;
+    }
+    if (!dispatcher) {
+        LOG_ERROR("Pipeline {} is not running", name_);
+        requester->source->sendResponse(requester, "Nack");
+        return;
+    }
+    dispatcher->dispatchCommand(std::move(requester), command);
+}
+
+void LocalPipelineCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    pipeline_->dispatchCommand(requester, command_);
+}
+
+std::shared_ptr<CommandInterface> LocalPipelineCommand::withArguments(const CommandArguments& arguments) const {
+    return std::shared_ptr<CommandInterface>(new LocalPipelineCommand(pipeline_, std::string(arguments.join(0))));
+}
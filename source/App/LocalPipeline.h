@@ -0,0 +1,71 @@
+#ifndef PERIPHERY_MANAGER_LOCALPIPELINE_H
+#define PERIPHERY_MANAGER_LOCALPIPELINE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include "Pipeline/PipelineManager.h"
+#include "TasksManager/CommandDispatcher.h"
+
+// Pipeline run in this process next to the main one, typically fed by a channel of it. "start" and "stop" build
+// and tear down its PipelineManager without touching any other pipeline, other commands go to the commands
+// registered for the running instance. Its bus watch is served by the main loop of the main pipeline.
+class LocalPipeline {
+public:
+    // Registers the commands of a started instance on its own dispatcher
+    using CommandRegistrar = std::function<void(CommandDispatcher&, const std::shared_ptr<PipelineManager>&)>;
+    LocalPipeline(std::string name, std::filesystem::path pipeline_file, std::string instance_name,
+                  PipelineStartupOptions options, std::shared_ptr<Scheduler> scheduler,
+                  std::shared_ptr<CommandCoalescer> coalescer, CommandRegistrar registrar);
+    ~LocalPipeline();
+    LocalPipeline(const LocalPipeline&) = delete;
+    LocalPipeline& operator=(const LocalPipeline&) = delete;
+    const std::string& getName() const;
+    std::error_code start();
+    std::error_code stop();
+    void dispatchCommand(std::shared_ptr<InputInterface::Requester> requester, std::string_view command);
+
+private:
+    bool isFinished();
+    void retire();
+    const std::string name_;
+    const std::filesystem::path pipeline_file_;
+    const std::string instance_name_;
+    const PipelineStartupOptions options_;
+    const std::shared_ptr<Scheduler> scheduler_;
+    const std::shared_ptr<CommandCoalescer> coalescer_;
+    const CommandRegistrar registrar_;
+    std::mutex mutex_;
+    std::shared_ptr<PipelineManager> pipeline_manager_;
+    std::shared_ptr<CommandDispatcher> dispatcher_;
+    // Set by the play thread once play() returned
+    std::mutex play_mutex_;
+    std::condition_variable play_condition_;
+    bool finished_{true};
+    std::thread play_thread_;
+};
+
+// "<name> <command>" addresses a local pipeline. The commands of one pipeline share a strand, so its start, stop
+// and forwarded commands run one at a time and in order.
+class LocalPipelineCommand : public CommandInterface {
+public:
+    explicit LocalPipelineCommand(std::shared_ptr<LocalPipeline> pipeline) : pipeline_(std::move(pipeline)) {}
+    ~LocalPipelineCommand() override = default;
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    std::shared_ptr<CommandInterface> withArguments(const CommandArguments& arguments) const override;
+    size_t getStrandKey() const override { return reinterpret_cast<uintptr_t>(pipeline_.get()); }
+
+private:
+    LocalPipelineCommand(std::shared_ptr<LocalPipeline> pipeline, std::string command)
+        : pipeline_(std::move(pipeline)), command_(std::move(command)) {}
+    std::shared_ptr<LocalPipeline> pipeline_;
+    std::string command_;
+};
+
+#endif //PERIPHERY_MANAGER_LOCALPIPELINE_H
@@ -0,0 +1,572 @@
+#include "Supervisor.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <gst/gst.h>
+#include "Logger/Logger.h"
+#include "Network/UnixNetworkManager.h"
+#include "Pipeline/PipelineManager.h"
+#include "Pipeline/PipelineParser.h"
+#include "Pipeline/PluginPreloader.h"
+
+constexpr size_t MAX_MESSAGE_SIZE {1024};
+constexpr int POLL_INTERVAL_MS {100};
+constexpr std::chrono::milliseconds MAX_RESTART_BACKOFF {30000};
+// A worker that crashes after running this long starts over with the initial backoff
+constexpr std::chrono::seconds STABLE_RUN_TIME {60};
+constexpr std::chrono::seconds STOP_TIMEOUT {5};
+
+volatile std::sig_atomic_t Supervisor::stop_requested_ = 0;
+
+namespace {
+std::string_view trim(std::string_view text) {
+    const auto first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+std::string describeExitStatus(const int status) {
+    if (WIFSIGNALED(status)) {
+        return fmt::format("signal {}", WTERMSIG(status));
+    }
+    return fmt::format("exit status {}", WEXITSTATUS(status));
+}
+
+std::chrono::milliseconds toMilliseconds(const std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+}
+}
+
+Supervisor::Supervisor(AppConfig config, WorkerMain worker_main)
+    : config_(std::move(config)), worker_main_(std::move(worker_main)), control_server_(static_cast<int>(config_.port)),
+      supervisor_pid_(getpid()) {
+}
+
+Supervisor::~Supervisor() {
+    for (const auto& [client_socket, client_relays]: clients_) {
+        close(client_socket);
+    }
+    for (const auto& [relay_socket, relay]: relays_) {
+        close(relay_socket);
+    }
+    control_server_.closeConnection();
+}
+
+void Supervisor::signalHandler(const int) {
+    stop_requested_ = 1;
+}
+
+int Supervisor::run() {
+    createWorkers();
+    if (workers_.empty()) {
+        LOG_ERROR("No pipelines to supervise");
+        return EXIT_FAILURE;
+    }
+
+    if (config_.preload_plugins) {
+        preloadPlugins();
+    }
+
+    if (const auto ec = control_server_.init()) {
+        LOG_ERROR("[Supervisor] Failed to listen on port {}: {}", config_.port, ec.message());
+        return EXIT_FAILURE;
+    }
+
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        if (const auto ec = spawnWorker(i)) {
+            LOG_ERROR("[Supervisor] Failed to start worker {}: {}", workers_[i].name, ec.message());
+            workers_[i].state = WorkerState::Backoff;
+            workers_[i].restart_time = Clock::now() + workers_[i].backoff;
+        }
+    }
+    LOG_INFO("[Supervisor] Supervising {} workers, control port {}", workers_.size(), config_.port);
+
+    std::vector<pollfd> poll_fds;
+    while (!stop_requested_) {
+        poll_fds.clear();
+        poll_fds.push_back({control_server_.getServerSocket(), POLLIN, 0});
+        for (const auto& [client_socket, client_relays]: clients_) {
+            poll_fds.push_back({client_socket, POLLIN, 0});
+        }
+        for (const auto& [relay_socket, relay]: relays_) {
+            poll_fds.push_back({relay_socket, POLLIN, 0});
+        }
+        for (const auto& worker: workers_) {
+            if (worker.ready_fd >= 0) {
+                poll_fds.push_back({worker.ready_fd, POLLIN, 0});
+            }
+        }
+
+        if (poll(poll_fds.data(), poll_fds.size(), getPollTimeout()) < 0 && errno != EINTR) {
+            LOG_ERROR("[Supervisor] Polling failed: {}", std::strerror(errno));
+            break;
+        }
+
+        // Handlers close descriptors, so each one is looked up again before it is handled
+        for (size_t i = 1; i < poll_fds.size(); ++i) {
+            const auto fd = poll_fds[i].fd;
+            if (poll_fds[i].revents == 0) {
+                continue;
+            }
+            if (clients_.count(fd)) {
+                handleClientMessage(fd);
+            } else if (relays_.count(fd)) {
+                handleRelayResponse(fd);
+            } else {
+                for (size_t index = 0; index < workers_.size(); ++index) {
+                    if (workers_[index].ready_fd == fd) {
+                        handleWorkerReady(index);
+                    }
+                }
+            }
+        }
+        if (poll_fds.front().revents & POLLIN) {
+            acceptClient();
+        }
+
+        reapWorkers();
+        restartDueWorkers();
+
+        if (std::all_of(workers_.begin(), workers_.end(), [](const Worker& worker) {
+                return worker.state == WorkerState::Stopped;
+            })) {
+            LOG_INFO("[Supervisor] All workers stopped");
+            return EXIT_SUCCESS;
+        }
+    }
+
+    stopWorkers();
+    return EXIT_SUCCESS;
+}
+
+void Supervisor::createWorkers() {
+    std::vector<std::pair<std::filesystem::path, std::string>> pipelines;
+    for (const auto& spec: config_.workers) {
+        pipelines.push_back(App::parsePipelineSpec(spec));
+    }
+    // One worker per instance of the input file, or for the input file itself
+    if (pipelines.empty()) {
+        for (const auto& instance: PipelineParser(config_.input_file.string()).getInstanceNames()) {
+            pipelines.emplace_back(config_.input_file, instance);
+        }
+        if (pipelines.empty()) {
+            pipelines.emplace_back(config_.input_file, std::string{});
+        }
+    }
+
+    for (const auto& [pipeline_file, instance]: pipelines) {
+        Worker worker;
+        worker.name = instance.empty() ? pipeline_file.stem().string() : instance;
+        if (std::any_of(workers_.begin(), workers_.end(), [&](const Worker& other) { return other.name == worker.name; })) {
+            worker.name += "-" + std::to_string(workers_.size());
+        }
+        worker.backoff = std::chrono::milliseconds(config_.restart_backoff_ms);
+
+        worker.config = config_;
+        worker.config.input_file = pipeline_file;
+        worker.config.instance = instance;
+        worker.config.supervise = false;
+        worker.config.workers.clear();
+        worker.config.control_socket = fmt::format("@{}-{}-{}", APP_NAME, supervisor_pid_, worker.name);
+        worker.config.ready_fd = -1;
+        if (!worker.config.log_file.empty()) {
+            worker.config.log_file += "." + worker.name;
+        }
+        if (!worker.config.event_log_dir.empty()) {
+            worker.config.event_log_dir /= worker.name;
+        }
+        workers_.push_back(std::move(worker));
+    }
+}
+
+void Supervisor::preloadPlugins() const {
+    // The workers inherit the initialized registry and the mapped plugins, and only copy the pages they write to
+    if (!config_.gst_registry_file.empty()) {
+        PipelineManager::configureRegistry(config_.gst_registry_file);
+    }
+    gst_init(nullptr, nullptr);
+
+    std::vector<std::string> factory_names;
+    for (const auto& worker: workers_) {
+        try {
+            for (const auto& element: PipelineParser(worker.config.input_file.string()).getAllElements(worker.config.instance)) {
+                factory_names.push_back(element.name);
+            }
+        } catch (const std::exception& e) {
+            LOG_WARN("[Supervisor] Not preloading the plugins of worker {}: {}", worker.name, e.what());
+        }
+    }
+    std::sort(factory_names.begin(), factory_names.end());
+    factory_names.erase(std::unique(factory_names.begin(), factory_names.end()), factory_names.end());
+
+    // The loading thread is joined before the first fork
+    PluginPreloader preloader;
+    preloader.start(factory_names);
+    LOG_INFO("[Supervisor] Preloaded the plugins of {} element factories in {}us", factory_names.size(),
+             preloader.wait().count());
+}
+
+std::error_code Supervisor::spawnWorker(const size_t index) {
+    auto& worker = workers_[index];
+    int ready_pipe[2];
+    if (pipe2(ready_pipe, O_CLOEXEC) != 0) {
+        return {errno, std::generic_category()};
+    }
+
+    worker.spawn_time = Clock::now();
+    const auto pid = fork();
+    if (pid < 0) {
+        const std::error_code ec {errno, std::generic_category()};
+        close(ready_pipe[0]);
+        close(ready_pipe[1]);
+        return ec;
+    }
+    if (pid == 0) {
+        close(ready_pipe[0]);
+        runWorker(index, ready_pipe[1]);
+    }
+
+    close(ready_pipe[1]);
+    worker.pid = pid;
+    worker.ready_fd = ready_pipe[0];
+    worker.state = WorkerState::Starting;
+    LOG_INFO("[Supervisor] Started worker {} ({}{}{}) as pid {}", worker.name, worker.config.input_file.string(),
+             worker.config.instance.empty() ? "" : ":", worker.config.instance, pid);
+    return {};
+}
+
+void Supervisor::runWorker(const size_t index, const int ready_fd) {
+    // Only the readiness pipe of this worker is kept, every other descriptor belongs to the supervisor
+    control_server_.closeConnection();
+    for (const auto& [client_socket, client_relays]: clients_) {
+        close(client_socket);
+    }
+    for (const auto& [relay_socket, relay]: relays_) {
+        close(relay_socket);
+    }
+    for (const auto& worker: workers_) {
+        if (worker.ready_fd >= 0) {
+            close(worker.ready_fd);
+        }
+    }
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+
+    // Don't outlive the supervisor, it may have died before the death signal was armed
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != supervisor_pid_) {
+        std::_Exit(EXIT_FAILURE);
+    }
+
+    auto config = workers_[index].config;
+    config.ready_fd = ready_fd;
+    auto status = EXIT_FAILURE;
+    try {
+        status = worker_main_(config);
+    } catch (const std::exception& e) {
+        LOG_ERROR("{}", e.what());
+    }
+    std::exit(status);
+}
+
+void Supervisor::handleWorkerReady(const size_t index) {
+    auto& worker = workers_[index];
+    char ready;
+    const auto bytes_read = read(worker.ready_fd, &ready, 1);
+    close(worker.ready_fd);
+    worker.ready_fd = -1;
+    if (bytes_read != 1) {
+        // Exited before its pipeline was PLAYING, reaped separately
+        return;
+    }
+
+    worker.state = WorkerState::Running;
+    worker.ready_time = Clock::now();
+    worker.startup_latency = toMilliseconds(worker.ready_time - worker.spawn_time);
+    if (worker.restarts == 0) {
+        LOG_INFO("[Supervisor] Worker {} PLAYING {}ms after fork", worker.name, worker.startup_latency.count());
+    } else {
+        LOG_INFO("[Supervisor] Worker {} restarted, PLAYING {}ms after fork and {}ms after it exited (restart {})",
+                 worker.name, worker.startup_latency.count(), toMilliseconds(worker.ready_time - worker.exit_time).count(),
+                 worker.restarts);
+    }
+}
+
+void Supervisor::reapWorkers() {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        const auto it = std::find_if(workers_.begin(), workers_.end(), [pid](const Worker& worker) { return worker.pid == pid; });
+        if (it == workers_.end()) {
+            continue;
+        }
+        auto& worker = *it;
+        const auto index = static_cast<size_t>(it - workers_.begin());
+        if (worker.ready_fd >= 0) {
+            close(worker.ready_fd);
+            worker.ready_fd = -1;
+        }
+        closeWorkerRelays(index);
+        worker.pid = -1;
+        worker.exit_time = Clock::now();
+
+        // A pipeline that stopped on a command or at the end of the stream exits normally
+        if (stopping_ || (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)) {
+            worker.state = WorkerState::Stopped;
+            LOG_INFO("[Supervisor] Worker {} stopped ({})", worker.name, describeExitStatus(status));
+            continue;
+        }
+        // Restarting it would fail the same way
+        if (WIFEXITED(status) && WEXITSTATUS(status) == App::EXIT_CONFIG_ERROR) {
+            worker.state = WorkerState::Stopped;
+            LOG_ERROR("[Supervisor] Worker {} has an invalid configuration, not restarting it", worker.name);
+            continue;
+        }
+
+        if (worker.state == WorkerState::Running && worker.exit_time - worker.ready_time >= STABLE_RUN_TIME) {
+            worker.backoff = std::chrono::milliseconds(config_.restart_backoff_ms);
+        }
+        worker.state = WorkerState::Backoff;
+        worker.restart_time = worker.exit_time + worker.backoff;
+        LOG_WARN("[Supervisor] Worker {} crashed ({}), restarting in {}ms", worker.name, describeExitStatus(status),
+                 worker.backoff.count());
+        worker.backoff = std::min(worker.backoff * 2, MAX_RESTART_BACKOFF);
+    }
+}
+
+void Supervisor::restartDueWorkers() {
+    const auto now = Clock::now();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        auto& worker = workers_[i];
+        if (worker.state != WorkerState::Backoff || worker.restart_time > now) {
+            continue;
+        }
+        ++worker.restarts;
+        if (const auto ec = spawnWorker(i)) {
+            LOG_ERROR("[Supervisor] Failed to restart worker {}: {}", worker.name, ec.message());
+            worker.restart_time = now + worker.backoff;
+            worker.backoff = std::min(worker.backoff * 2, MAX_RESTART_BACKOFF);
+        }
+    }
+}
+
+void Supervisor::stopWorkers() {
+    stopping_ = true;
+    LOG_INFO("[Supervisor] Stopping workers");
+    for (const auto& worker: workers_) {
+        if (worker.pid > 0) {
+            kill(worker.pid, SIGTERM);
+        }
+    }
+
+    const auto deadline = Clock::now() + STOP_TIMEOUT;
+    const auto isRunning = [](const Worker& worker) { return worker.pid > 0; };
+    while (std::any_of(workers_.begin(), workers_.end(), isRunning) && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+        reapWorkers();
+    }
+
+    for (auto& worker: workers_) {
+        if (worker.pid > 0) {
+            LOG_WARN("[Supervisor] Worker {} didn't stop, killing it", worker.name);
+            kill(worker.pid, SIGKILL);
+            waitpid(worker.pid, nullptr, 0);
+            worker.pid = -1;
+            worker.state = WorkerState::Stopped;
+        }
+    }
+}
+
+void Supervisor::acceptClient() {
+    if (const int client_socket = control_server_.acceptConnection(); client_socket >= 0) {
+        LOG_TRACE("[Supervisor] Client {} connected", client_socket);
+        clients_.emplace(client_socket, std::map<size_t, int>{});
+    }
+}
+
+void Supervisor::handleClientMessage(const int client_socket) {
+    std::array<char, MAX_MESSAGE_SIZE> buffer{};
+    const auto [data, disconnect] = control_server_.readData(client_socket, buffer.data(), buffer.size());
+    if (disconnect) {
+        closeClient(client_socket);
+        return;
+    }
+
+    const auto message = trim(data);
+    if (message.empty()) {
+        return;
+    }
+    const auto separator = message.find_first_of(" \t");
+    const auto target = message.substr(0, separator);
+    const auto command = separator == std::string_view::npos ? std::string_view{} : trim(message.substr(separator));
+
+    if (target == "workers" && command.empty()) {
+        sendToClient(client_socket, "Ack " + getWorkersStatus());
+        return;
+    }
+
+    const auto it = std::find_if(workers_.begin(), workers_.end(), [target](const Worker& worker) { return worker.name == target; });
+    if (it == workers_.end()) {
+        sendToClient(client_socket, fmt::format("Nack unknown worker {}", target));
+        return;
+    }
+    if (command.empty()) {
+        sendToClient(client_socket, fmt::format("{} Nack missing command", target));
+        return;
+    }
+
+    const auto index = static_cast<size_t>(it - workers_.begin());
+    auto& client_relays = clients_[client_socket];
+    auto relay_it = client_relays.find(index);
+    int relay_socket = relay_it != client_relays.end() ? relay_it->second : connectRelay(client_socket, index);
+    if (relay_socket >= 0 && send(relay_socket, command.data(), command.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(command.size())) {
+        LOG_DEBUG("[Supervisor] Forwarding to worker {} failed: {}", it->name, std::strerror(errno));
+        relays_.erase(relay_socket);
+        clients_[client_socket].erase(index);
+        close(relay_socket);
+        relay_socket = -1;
+    }
+    if (relay_socket < 0) {
+        sendToClient(client_socket, fmt::format("{} Nack unavailable", target));
+    }
+}
+
+int Supervisor::connectRelay(const int client_socket, const size_t index) {
+    const auto& worker = workers_[index];
+    if (worker.pid < 0) {
+        return -1;
+    }
+
+    sockaddr_un address{};
+    const auto address_length = UnixNetworkManager::makeAddress(worker.config.control_socket, address);
+    const int relay_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (relay_socket < 0) {
+        return -1;
+    }
+    // Unix stream connects complete immediately, or fail while the worker isn't listening yet
+    if (connect(relay_socket, reinterpret_cast<sockaddr*>(&address), address_length) != 0) {
+        LOG_DEBUG("[Supervisor] Connecting to worker {} failed: {}", worker.name, std::strerror(errno));
+        close(relay_socket);
+        return -1;
+    }
+
+    relays_.emplace(relay_socket, Relay{client_socket, index});
+    clients_[client_socket][index] = relay_socket;
+    return relay_socket;
+}
+
+void Supervisor::handleRelayResponse(const int relay_socket) {
+    auto& relay = relays_.at(relay_socket);
+    std::array<char, MAX_MESSAGE_SIZE> buffer{};
+    const auto bytes_read = read(relay_socket, buffer.data(), buffer.size());
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (bytes_read <= 0) {
+        clients_[relay.client_socket].erase(relay.worker);
+        relays_.erase(relay_socket);
+        close(relay_socket);
+        return;
+    }
+
+    // Every line gets the worker name, also when a read holds several responses or ends inside one
+    const auto& name = workers_[relay.worker].name;
+    std::string response;
+    std::string_view data(buffer.data(), static_cast<size_t>(bytes_read));
+    while (!data.empty()) {
+        const auto line_end = data.find('\n');
+        const auto line = data.substr(0, line_end == std::string_view::npos ? line_end : line_end + 1);
+        if (relay.line_start) {
+            response.append(name).append(" ");
+        }
+        response.append(line);
+        relay.line_start = line.back() == '\n';
+        data.remove_prefix(line.size());
+    }
+    const auto client_socket = relay.client_socket;
+    if (const auto ec = control_server_.sendData(client_socket, {response})) {
+        LOG_DEBUG("[Supervisor] Relaying a response to client {} failed: {}", client_socket, ec.message());
+        closeClient(client_socket);
+    }
+}
+
+void Supervisor::sendToClient(const int client_socket, const std::string_view response) {
+    if (const auto ec = control_server_.sendData(client_socket, {response})) {
+        LOG_DEBUG("[Supervisor] Responding to client {} failed: {}", client_socket, ec.message());
+        closeClient(client_socket);
+    }
+}
+
+void Supervisor::closeClient(const int client_socket) {
+    const auto it = clients_.find(client_socket);
+    if (it == clients_.end()) {
+        return;
+    }
+    for (const auto& [index, relay_socket]: it->second) {
+        relays_.erase(relay_socket);
+        close(relay_socket);
+    }
+    clients_.erase(it);
+    close(client_socket);
+    LOG_TRACE("[Supervisor] Client {} disconnected", client_socket);
+}
+
+void Supervisor::closeWorkerRelays(const size_t index) {
+    for (auto& [client_socket, client_relays]: clients_) {
+        if (const auto it = client_relays.find(index); it != client_relays.end()) {
+            relays_.erase(it->second);
+            close(it->second);
+            client_relays.erase(it);
+        }
+    }
+}
+
+std::string_view Supervisor::toString(const WorkerState state) {
+    switch (state) {
+        case WorkerState::Starting:
+            return "starting";
+        case WorkerState::Running:
+            return "running";
+        case WorkerState::Backoff:
+            return "backoff";
+        case WorkerState::Stopped:
+            break;
+    }
+    return "stopped";
+}
+
+std::string Supervisor::getWorkersStatus() const {
+    std::string status;
+    for (const auto& worker: workers_) {
+        if (!status.empty()) {
+            status += ", ";
+        }
+        status += fmt::format("{} {} pid={} restarts={} startup={}ms", worker.name, toString(worker.state), worker.pid,
+                              worker.restarts, worker.startup_latency.count());
+    }
+    return status;
+}
+
+int Supervisor::getPollTimeout() const {
+    auto timeout = std::chrono::milliseconds(POLL_INTERVAL_MS);
+    const auto now = Clock::now();
+    for (const auto& worker: workers_) {
+        if (worker.state == WorkerState::Backoff) {
+            timeout = std::min(timeout, std::max(std::chrono::milliseconds(0), toMilliseconds(worker.restart_time - now)));
+        }
+    }
+    return static_cast<int>(timeout.count());
+}
@@ -0,0 +1,91 @@
+#ifndef PERIPHERY_MANAGER_SUPERVISOR_H
+#define PERIPHERY_MANAGER_SUPERVISOR_H
+
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <sys/types.h>
+#include "App/App.h"
+#include "Network/TcpNetworkManager.h"
+
+// Runs every pipeline in a worker process of its own behind a single control endpoint. Workers are forked from
+// the supervisor, after it loaded the plugins of all pipelines when plugin preloading is enabled, so the workers
+// share those pages copy-on-write. Each worker serves its commands on an abstract unix socket. "<worker> <command>"
+// received on the TCP port is forwarded on a connection of the client to that worker and the responses come back
+// prefixed with the worker name. Crashed workers are restarted with an exponential backoff. The supervisor runs a
+// single poll loop and never starts a thread, so a fork never copies a lock held by another thread.
+class Supervisor {
+public:
+    // Runs the application of a worker in the forked child, returns its exit status
+    using WorkerMain = std::function<int(const AppConfig&)>;
+    Supervisor(AppConfig config, WorkerMain worker_main);
+    ~Supervisor();
+    Supervisor(const Supervisor&) = delete;
+    Supervisor& operator=(const Supervisor&) = delete;
+    // Blocks until every worker stopped on its own or the supervisor got SIGINT or SIGTERM
+    int run();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    enum class WorkerState {
+        Starting, // Forked, the pipeline isn't PLAYING yet
+        Running,
+        Backoff,  // Crashed, waiting to be restarted
+        Stopped
+    };
+    struct Worker {
+        std::string name;
+        AppConfig config;
+        pid_t pid{-1};
+        int ready_fd{-1}; // Read end of the readiness pipe while starting
+        WorkerState state{WorkerState::Stopped};
+        unsigned int restarts{0};
+        std::chrono::milliseconds backoff{0};
+        std::chrono::milliseconds startup_latency{0};
+        Clock::time_point spawn_time;
+        Clock::time_point ready_time;
+        Clock::time_point exit_time;
+        Clock::time_point restart_time;
+    };
+    // Forwarded connection of a control client to a worker
+    struct Relay {
+        int client_socket;
+        size_t worker;
+        bool line_start{true}; // The next byte relayed starts a response line and gets the worker name
+    };
+    void createWorkers();
+    void preloadPlugins() const;
+    std::error_code spawnWorker(size_t index);
+    [[noreturn]] void runWorker(size_t index, int ready_fd);
+    void handleWorkerReady(size_t index);
+    void reapWorkers();
+    void restartDueWorkers();
+    void stopWorkers();
+    void acceptClient();
+    void handleClientMessage(int client_socket);
+    void handleRelayResponse(int relay_socket);
+    int connectRelay(int client_socket, size_t index);
+    void closeClient(int client_socket);
+    void closeWorkerRelays(size_t index);
+    void sendToClient(int client_socket, std::string_view response);
+    static std::string_view toString(WorkerState state);
+    std::string getWorkersStatus() const;
+    int getPollTimeout() const;
+    static void signalHandler(int signal);
+    static volatile std::sig_atomic_t stop_requested_;
+    AppConfig config_;
+    WorkerMain worker_main_;
+    std::vector<Worker> workers_;
+    TcpNetworkManager control_server_;
+    std::map<int, std::map<size_t, int>> clients_; // Client socket to its relay socket per worker
+    std::map<int, Relay> relays_;
+    pid_t supervisor_pid_{-1};
+    bool stopping_{false};
+};
+
+#endif //PERIPHERY_MANAGER_SUPERVISOR_H
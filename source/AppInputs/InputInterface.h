@@ -1,7 +1,9 @@
 #ifndef PERIPHERY_MANAGER_INPUTINTERFACE_H
 #define PERIPHERY_MANAGER_INPUTINTERFACE_H
 
-#include <string>
+#include <functional>
+#include <memory>
+#include <string_view>
 #include <utility>
 
 class InputInterface : public std::enable_shared_from_this<InputInterface> {
@@ -11,7 +13,10 @@ public:
         int source_id;
         Requester(std::shared_ptr<InputInterface> input_interface, int id) : source(std::move(input_interface)), source_id(id) {}
     };
-    virtual void sendResponse(std::shared_ptr<InputInterface::Requester> requester, const std::string& response) = 0;
+    virtual void sendResponse(std::shared_ptr<InputInterface::Requester> requester, std::string_view response) = 0;
+    // Runs the handler once the requester stopped waiting for the response (timeout or cancellation), right
+    // away if it already did. Sources that always wait for the response ignore it.
+    virtual void onAbandon(std::shared_ptr<InputInterface::Requester>, std::function<void()>) {}
     virtual ~InputInterface() = default;
 };
 
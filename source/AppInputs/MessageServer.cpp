@@ -1,10 +1,35 @@
 #include "MessageServer.h"
-#include <sstream>
-#include <string>
+#include <array>
 #include <unistd.h>
 #include <utility>
+#include <fmt/ranges.h>
 #include "Logger/Logger.h"
 
+namespace {
+// Answers the commands of one client. It owns the client socket, which stays open until no command
+// holds a requester for it anymore, so a late response cannot reach a new client that got the same
+// descriptor.
+class ClientConnection : public InputInterface {
+public:
+    ClientConnection(std::shared_ptr<NetworkInterface> network_manager, const int client_socket)
+        : network_manager_(std::move(network_manager)), client_socket_(client_socket) {}
+
+    ~ClientConnection() override {
+        close(client_socket_);
+    }
+
+    void sendResponse(std::shared_ptr<Requester>, const std::string_view response) override {
+        if (const auto ec = network_manager_->sendData(client_socket_, {response})) {
+            LOG_ERROR("[Message Server] {}", ec.message());
+        }
+    }
+
+private:
+    std::shared_ptr<NetworkInterface> network_manager_;
+    int client_socket_;
+};
+}
+
 MessageServer::MessageServer(std::shared_ptr<CommandDispatcher> command_dispatcher, std::shared_ptr<NetworkInterface> network_manager)
     : command_dispatcher_(std::move(command_dispatcher)), network_manager_(std::move(network_manager)) {
 }
@@ -43,6 +68,12 @@ void MessageServer::runServer() {
 
     LOG_INFO("[Message Server] Started");
 
+    // A backend with a completion loop serves every connection from this thread
+    if (network_manager_->serveConnections(*this, keep_running_)) {
+        requesters_.clear();
+        return;
+    }
+
     while (keep_running_) {
         if (const int client_socket = network_manager_->acceptConnection(); client_socket >= 0) {
             LOG_TRACE("[Message Server] Client {} connected", client_socket);
@@ -52,48 +83,60 @@ void MessageServer::runServer() {
     }
 }
 
+// Per-connection state is created once and reused for every message of this client
+std::shared_ptr<MessageServer::Requester> MessageServer::createRequester(const int client_socket) {
+    const auto connection = std::allocate_shared<ClientConnection>(PoolAllocator<ClientConnection>(connection_pool_),
+                                                                   network_manager_, client_socket);
+    return std::allocate_shared<Requester>(PoolAllocator<Requester>(requester_pool_), connection, client_socket);
+}
+
 void MessageServer::handleClient(const int client_socket) {
+    std::array<char, MAX_MESSAGE_SIZE> buffer{};
+    const auto requester = createRequester(client_socket);
+
     while (keep_running_) {
-        auto [data, disconnect] = network_manager_->readData(client_socket);
+        auto [data, disconnect] = network_manager_->readData(client_socket, buffer.data(), buffer.size());
 
         if (disconnect) {
             break;
         }
 
         if (!data.empty()) {
-            parseMessage(client_socket, data);
+            parseMessage(requester, data);
         }
     }
 
-    close(client_socket);
     LOG_TRACE("[Message Server] Client {} disconnected", client_socket);
 }
 
-bool MessageServer::parseMessage(const int client, const std::vector<char>& buffer) {
-    LOG_TRACE("{}", printMessage(client, buffer));
+void MessageServer::onConnect(const int client_socket) {
+    LOG_TRACE("[Message Server] Client {} connected", client_socket);
+    requesters_[client_socket] = createRequester(client_socket);
+}
 
-    const auto requester = std::make_shared<Requester>(shared_from_this(), client);
-    command_dispatcher_->dispatchCommand(requester, std::string(buffer.begin(), buffer.end()));
+void MessageServer::onData(const int client_socket, const std::string_view data) {
+    if (const auto it = requesters_.find(client_socket); it != requesters_.end()) {
+        parseMessage(it->second, data);
+    }
+}
 
-    return true;
+// Commands still holding the requester keep the socket open until they answered
+void MessageServer::onDisconnect(const int client_socket) {
+    requesters_.erase(client_socket);
+    LOG_TRACE("[Message Server] Client {} disconnected", client_socket);
 }
 
-std::string MessageServer::printMessage(const int client, const std::vector<char>& buffer) {
-    std::ostringstream os;
-    os << "[Message Server] Received from client " << client << " (" << buffer.size() << " bytes): ";
-    os << std::string(buffer.begin(), buffer.end()) << " [";
+bool MessageServer::parseMessage(const std::shared_ptr<Requester>& requester, const std::string_view message) {
+    LOG_TRACE("[Message Server] Received from client {} ({} bytes): {} [{:d}]", requester->source_id, message.size(),
+              message, fmt::join(message.begin(), message.end(), " "));
 
-    for (const auto& c: buffer) {
-        os << static_cast<int>(static_cast<unsigned char>(c)) << " ";
-    }
+    command_dispatcher_->dispatchCommand(requester, message);
 
-    os << "]";
-    return os.str();
+    return true;
 }
 
-void MessageServer::sendResponse(const std::shared_ptr<Requester> requester, const std::string& response) {
-    const std::vector<char> data(response.begin(), response.end());
-    if (const auto ec = network_manager_->sendData(requester->source_id, data)) {
+void MessageServer::sendResponse(const std::shared_ptr<Requester> requester, const std::string_view response) {
+    if (const auto ec = network_manager_->sendData(requester->source_id, {response})) {
         LOG_ERROR("[Message Server] {}", ec.message());
     }
 }
@@ -2,32 +2,44 @@
 #define PERIPHERY_MANAGER_MESSAGESERVER_H
 
 #include "TasksManager/CommandDispatcher.h"
+#include "TasksManager/PoolAllocator.h"
 #include "Network/NetworkInterface.h"
 #include "InputInterface.h"
 #include <atomic>
 #include <iostream>
 #include <list>
+#include <mutex>
+#include <string_view>
 #include <thread>
-#include <vector>
+#include <unordered_map>
 
-class MessageServer : public InputInterface {
+class MessageServer : public InputInterface, private NetworkInterface::ConnectionHandler {
 public:
     MessageServer(std::shared_ptr<CommandDispatcher> command_dispatcher, std::shared_ptr<NetworkInterface> network_manager);
     ~MessageServer() override;
     bool init();
     bool deinit();
-    void sendResponse(std::shared_ptr<Requester> requester, const std::string& response) override;
+    void sendResponse(std::shared_ptr<Requester> requester, std::string_view response) override;
 
 private:
+    static constexpr size_t MAX_MESSAGE_SIZE {1024};
     void runServer();
-    bool parseMessage(const int client, const std::vector<char>& buffer);
-    static std::string printMessage(const int client, const std::vector<char>& buffer);
+    bool parseMessage(const std::shared_ptr<Requester>& requester, std::string_view message);
+    std::shared_ptr<Requester> createRequester(int client_socket);
     void handleClient(int client_socket);
+    void onConnect(int client_socket) override;
+    void onData(int client_socket, std::string_view data) override;
+    void onDisconnect(int client_socket) override;
     void stopAllClientThreads();
     std::shared_ptr<CommandDispatcher> command_dispatcher_;
     std::shared_ptr<NetworkInterface> network_manager_;
+    // Connections and their requesters are recycled, commands may keep one alive after its client disconnected
+    std::shared_ptr<BlockPool> connection_pool_{std::make_shared<BlockPool>()};
+    std::shared_ptr<BlockPool> requester_pool_{std::make_shared<BlockPool>()};
     std::atomic<bool> keep_running_{false};
     std::list<std::thread> client_threads_;
+    // Connections served by the completion loop of the network backend, only used by the server thread
+    std::unordered_map<int, std::shared_ptr<Requester>> requesters_;
     std::mutex client_threads_mutex_;
     std::thread server_thread_;
 };
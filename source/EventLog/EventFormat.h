@@ -0,0 +1,120 @@
+#ifndef PERIPHERY_MANAGER_EVENTFORMAT_H
+#define PERIPHERY_MANAGER_EVENTFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// On-disk layout of the binary event log. A segment file starts with a SegmentHeader followed by
+// records aligned to RECORD_ALIGNMENT. A record becomes visible once its size is stored, which is
+// written last, so a zero size marks the end of the data (or a record torn by a crash).
+
+enum class EventType : uint16_t {
+    Command = 1,       // values: priority (-1 if unresolved), operation id (0 if untracked); text: command line
+    CommandResult = 2, // values: operation id, duration in us; text: response
+    StateChange = 3,   // values: old GstState, new GstState; text: element name
+    Probe = 4,         // values: ProbeAction, pts (-1 if none); text: element or branch name
+    BusMessage = 5,    // values: GstMessageType, 0; text: source name and details
+    Stats = 6,         // values: count, max queue wait in us; text: priority class
+    Source = 7,        // values: reconnect attempts, outage in us (0 when lost); text: source name and reason
+    Failover = 8       // values: time from the error to the standby playing in us, 0; text: pipeline name
+};
+
+enum class ProbeAction : int64_t {
+    ElementInserted,
+    ElementRemoved,
+    BranchConnected,
+    BranchDisconnected,
+    Cancelled // The probe was removed before it applied the change
+};
+
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t segment_index;
+    uint64_t created_ns;
+};
+
+struct EventRecordHeader {
+    uint32_t size; // Whole record including the padded text
+    uint16_t type;
+    uint16_t text_size;
+    uint64_t timestamp_ns; // Wall clock, ns since the epoch
+    int64_t values[2];
+};
+
+constexpr char EVENT_LOG_MAGIC[8] = {'G', 'P', 'L', 'E', 'V', 'L', 'O', 'G'};
+constexpr uint32_t EVENT_LOG_VERSION {1};
+constexpr size_t RECORD_ALIGNMENT {8};
+constexpr size_t MAX_EVENT_TEXT_SIZE {1024};
+
+constexpr size_t alignRecordSize(const size_t size) {
+    return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+inline const char* toString(const EventType type) {
+    switch (type) {
+        case EventType::Command:
+            return "command";
+        case EventType::CommandResult:
+            return "command_result";
+        case EventType::StateChange:
+            return "state_change";
+        case EventType::Probe:
+            return "probe";
+        case EventType::BusMessage:
+            return "bus_message";
+        case EventType::Stats:
+            return "stats";
+        case EventType::Source:
+            return "source";
+        case EventType::Failover:
+            return "failover";
+        default:
+            return "unknown";
+    }
+}
+
+inline const char* toString(const ProbeAction action) {
+    switch (action) {
+        case ProbeAction::ElementInserted:
+            return "element_inserted";
+        case ProbeAction::ElementRemoved:
+            return "element_removed";
+        case ProbeAction::BranchConnected:
+            return "branch_connected";
+        case ProbeAction::BranchDisconnected:
+            return "branch_disconnected";
+        case ProbeAction::Cancelled:
+            return "cancelled";
+        default:
+            return "unknown";
+    }
+}
+
+// Names of the two values of a record type, as used by the decoder
+inline std::pair<const char*, const char*> getValueNames(const EventType type) {
+    switch (type) {
+        case EventType::Command:
+            return {"priority", "operation"};
+        case EventType::CommandResult:
+            return {"operation", "duration_us"};
+        case EventType::StateChange:
+            return {"old_state", "new_state"};
+        case EventType::Probe:
+            return {"action", "pts"};
+        case EventType::BusMessage:
+            return {"message_type", "value"};
+        case EventType::Stats:
+            return {"count", "max_us"};
+        case EventType::Source:
+            return {"attempts", "outage_us"};
+        case EventType::Failover:
+            return {"duration_us", "value"};
+        default:
+            return {"value0", "value1"};
+    }
+}
+
+#endif //PERIPHERY_MANAGER_EVENTFORMAT_H
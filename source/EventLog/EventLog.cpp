@@ -0,0 +1,182 @@
+#include "EventLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cinttypes>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "Logger/Logger.h"
+
+namespace {
+uint64_t getTimestampNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Index of an events-<index>.bin file name, false for other files
+bool parseSegmentIndex(const std::string& file_name, uint64_t& index) {
+    return std::sscanf(file_name.c_str(), "events-%" SCNu64 ".bin", &index) == 1;
+}
+}
+
+EventLog::Segment::Segment(const int fd, char* data, const size_t size, const uint64_t index)
+    : fd_(fd), data_(data), size_(size), index_(index), offset_(alignRecordSize(sizeof(SegmentHeader))) {
+}
+
+EventLog::Segment::~Segment() {
+    // Drop the unused preallocated tail, the decoder stops at the first empty record anyway
+    const auto used_size = std::min(offset_.load(), size_);
+    munmap(data_, size_);
+    if (ftruncate(fd_, static_cast<off_t>(used_size)) != 0) {
+        LOG_WARN("Failed to trim event log segment {}: {}", index_, std::strerror(errno));
+    }
+    ::close(fd_);
+}
+
+std::unique_ptr<EventLog::Segment> EventLog::Segment::create(const std::filesystem::path& path, const uint64_t index,
+                                                             const size_t size, std::error_code& ec) {
+    const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ec = {errno, std::generic_category()};
+        return nullptr;
+    }
+
+    // Reserve the blocks up front, so appending never hits a full disk through a page fault
+    if (const auto error = posix_fallocate(fd, 0, static_cast<off_t>(size))) {
+        ec = {error, std::generic_category()};
+        ::close(fd);
+        return nullptr;
+    }
+
+    const auto data = static_cast<char*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    if (data == MAP_FAILED) {
+        ec = {errno, std::generic_category()};
+        ::close(fd);
+        return nullptr;
+    }
+
+    SegmentHeader header {};
+    std::memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.version = EVENT_LOG_VERSION;
+    header.header_size = sizeof(SegmentHeader);
+    header.segment_index = index;
+    header.created_ns = getTimestampNs();
+    std::memcpy(data, &header, sizeof(header));
+
+    ec = {};
+    return std::make_unique<Segment>(fd, data, size, index);
+}
+
+bool EventLog::Segment::append(const EventType type, const int64_t value0, const int64_t value1,
+                               const std::string_view text) const {
+    const auto text_size = std::min(text.size(), MAX_EVENT_TEXT_SIZE);
+    const auto record_size = alignRecordSize(sizeof(EventRecordHeader) + text_size);
+    const auto offset = offset_.fetch_add(record_size, std::memory_order_relaxed);
+    if (offset + record_size > size_) {
+        return false;
+    }
+
+    const auto record = reinterpret_cast<EventRecordHeader*>(data_ + offset);
+    record->type = static_cast<uint16_t>(type);
+    record->text_size = static_cast<uint16_t>(text_size);
+    record->timestamp_ns = getTimestampNs();
+    record->values[0] = value0;
+    record->values[1] = value1;
+    std::memcpy(data_ + offset + sizeof(EventRecordHeader), text.data(), text_size);
+    __atomic_store_n(&record->size, static_cast<uint32_t>(record_size), __ATOMIC_RELEASE);
+    return true;
+}
+
+std::error_code EventLog::open(const std::filesystem::path& directory, const size_t segment_size,
+                               const size_t max_segments) {
+    std::lock_guard lock(rotation_mutex_);
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        LOG_ERROR("Failed to create event log directory {}: {}", directory.string(), ec.message());
+        return ec;
+    }
+
+    directory_ = directory;
+    segment_size_ = std::max(segment_size, MIN_SEGMENT_SIZE);
+    max_segments_ = std::max<size_t>(max_segments, 1);
+
+    // Continue after the segments of previous runs instead of overwriting them
+    uint64_t last_index = 0;
+    for (const auto& entry: std::filesystem::directory_iterator(directory_, ec)) {
+        uint64_t index;
+        if (parseSegmentIndex(entry.path().filename().string(), index)) {
+            last_index = std::max(last_index, index);
+        }
+    }
+    segment_index_ = last_index + 1;
+
+    auto segment = Segment::create(getSegmentPath(segment_index_), segment_index_, segment_size_, ec);
+    if (!segment) {
+        LOG_ERROR("Failed to create event log segment {}: {}", getSegmentPath(segment_index_).string(), ec.message());
+        return ec;
+    }
+    for (auto index = segment_index_ - std::min<uint64_t>(segment_index_, max_segments_); index > 0; --index) {
+        std::filesystem::remove(getSegmentPath(index), ec);
+    }
+
+    segment_ = std::make_unique<RcuPointer<Segment>>(std::move(segment));
+    enabled_ = true;
+    LOG_INFO("Recording events to {}", getSegmentPath(segment_index_).string());
+    return {};
+}
+
+void EventLog::record(const EventType type, const int64_t value0, const int64_t value1, const std::string_view text) {
+    while (true) {
+        uint64_t full_segment_index = 0;
+        const auto appended = segment_->read([&](const Segment& segment) {
+            if (segment.append(type, value0, value1, text)) {
+                return true;
+            }
+            full_segment_index = segment.getIndex();
+            return false;
+        });
+        if (appended) {
+            return;
+        }
+        if (rotate(full_segment_index)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+// Called by every writer that found the segment full, only the first one replaces it
+std::error_code EventLog::rotate(const uint64_t full_segment_index) {
+    std::lock_guard lock(rotation_mutex_);
+    if (!enabled_) {
+        return std::make_error_code(std::errc::not_connected);
+    }
+    if (segment_index_ != full_segment_index) {
+        return {};
+    }
+
+    std::error_code ec;
+    auto segment = Segment::create(getSegmentPath(segment_index_ + 1), segment_index_ + 1, segment_size_, ec);
+    if (!segment) {
+        LOG_ERROR("Failed to create event log segment {}, recording stopped: {}",
+                  getSegmentPath(segment_index_ + 1).string(), ec.message());
+        enabled_ = false;
+        return ec;
+    }
+
+    ++segment_index_;
+    segment_->update(std::move(segment));
+    if (segment_index_ > max_segments_) {
+        std::filesystem::remove(getSegmentPath(segment_index_ - max_segments_), ec);
+    }
+    return {};
+}
+
+std::filesystem::path EventLog::getSegmentPath(const uint64_t index) const {
+    char file_name[32];
+    std::snprintf(file_name, sizeof(file_name), "events-%06" PRIu64 ".bin", index);
+    return directory_ / file_name;
+}
@@ -0,0 +1,78 @@
+#ifndef PERIPHERY_MANAGER_EVENTLOG_H
+#define PERIPHERY_MANAGER_EVENTLOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+#include "EventLog/EventFormat.h"
+#include "TasksManager/RcuPointer.h"
+
+// Always-on binary timeline of pipeline events for post-mortem analysis. Records are appended to
+// preallocated, memory-mapped segment files (events-<index>.bin) with one atomic reservation, so
+// appending performs no I/O and the data survives a crash of the process. The writer that fills a
+// segment creates the next one, the full segment is trimmed and only the newest max_segments are kept.
+class EventLog {
+public:
+    static constexpr size_t DEFAULT_SEGMENT_SIZE {16 << 20};
+    static constexpr size_t DEFAULT_MAX_SEGMENTS {8};
+    static constexpr size_t MIN_SEGMENT_SIZE {64 << 10};
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    static EventLog& getInstance() {
+        static EventLog instance;
+        return instance;
+    }
+
+    // Recording is disabled until the log is opened, only call before other threads record
+    std::error_code open(const std::filesystem::path& directory, size_t segment_size = DEFAULT_SEGMENT_SIZE,
+                         size_t max_segments = DEFAULT_MAX_SEGMENTS);
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void record(EventType type, int64_t value0, int64_t value1, std::string_view text = {});
+    size_t getDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    class Segment {
+    public:
+        Segment(int fd, char* data, size_t size, uint64_t index);
+        ~Segment();
+        static std::unique_ptr<Segment> create(const std::filesystem::path& path, uint64_t index, size_t size,
+                                               std::error_code& ec);
+        // Returns false if the record does not fit anymore
+        bool append(EventType type, int64_t value0, int64_t value1, std::string_view text) const;
+        uint64_t getIndex() const { return index_; }
+
+    private:
+        int fd_;
+        char* data_;
+        size_t size_;
+        uint64_t index_;
+        mutable std::atomic<size_t> offset_;
+    };
+
+    EventLog() = default;
+    std::filesystem::path getSegmentPath(uint64_t index) const;
+    std::error_code rotate(uint64_t full_segment_index);
+    std::filesystem::path directory_;
+    size_t segment_size_ {DEFAULT_SEGMENT_SIZE};
+    size_t max_segments_ {DEFAULT_MAX_SEGMENTS};
+    std::unique_ptr<RcuPointer<Segment>> segment_;
+    uint64_t segment_index_ {0};
+    std::mutex rotation_mutex_;
+    std::atomic<bool> enabled_ {false};
+    std::atomic<size_t> dropped_ {0};
+};
+
+#define RECORD_EVENT(...) \
+    do { \
+        if (EventLog::getInstance().isEnabled()) { \
+            EventLog::getInstance().record(__VA_ARGS__); \
+        } \
+    } while (false)
+
+#endif //PERIPHERY_MANAGER_EVENTLOG_H
@@ -0,0 +1,97 @@
+#include "FileWatcher.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <utility>
+#include "Logger/Logger.h"
+
+FileWatcher::FileWatcher(std::filesystem::path file_path, std::function<void()> on_change,
+                         const std::chrono::milliseconds settle_delay)
+    : file_path_(std::move(file_path)), on_change_(std::move(on_change)), settle_delay_(settle_delay) {
+}
+
+FileWatcher::~FileWatcher() {
+    deinit();
+}
+
+std::error_code FileWatcher::init() {
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || stop_fd_ < 0) {
+        const std::error_code ec{errno, std::generic_category()};
+        LOG_ERROR("Failed to create file watcher: {}", ec.message());
+        deinit();
+        return ec;
+    }
+
+    const auto directory = file_path_.has_parent_path() ? file_path_.parent_path() : std::filesystem::path(".");
+    if (inotify_add_watch(inotify_fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        const std::error_code ec{errno, std::generic_category()};
+        LOG_ERROR("Failed to watch {}: {}", directory.string(), ec.message());
+        deinit();
+        return ec;
+    }
+
+    watcher_thread_ = std::thread(&FileWatcher::run, this);
+    LOG_INFO("Watching {} for changes", file_path_.string());
+    return {};
+}
+
+void FileWatcher::deinit() {
+    if (watcher_thread_.joinable()) {
+        const uint64_t stop = 1;
+        if (write(stop_fd_, &stop, sizeof(stop)) != sizeof(stop)) {
+            LOG_ERROR("Failed to stop file watcher");
+        }
+        watcher_thread_.join();
+    }
+    for (auto fd: {&inotify_fd_, &stop_fd_}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void FileWatcher::run() {
+    pollfd fds[] = {{inotify_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+    auto changed = false;
+    while (true) {
+        // Wait for the first event without a timeout, then until the events settle
+        const auto timeout = changed ? static_cast<int>(settle_delay_.count()) : -1;
+        const auto ready = poll(fds, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("File watcher failed: {}", std::error_code(errno, std::generic_category()).message());
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+        if (ready == 0) {
+            changed = false;
+            LOG_INFO("File {} changed", file_path_.string());
+            on_change_();
+            continue;
+        }
+        changed = readEvents() || changed;
+    }
+}
+
+// Drains the pending events, true if one of them concerns the watched file
+bool FileWatcher::readEvents() const {
+    alignas(inotify_event) char buffer[4096];
+    auto matched = false;
+    ssize_t size;
+    while ((size = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+        for (auto offset = 0; offset < size;) {
+            const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            matched = matched || (event->len > 0 && file_path_.filename() == event->name);
+            offset += static_cast<int>(sizeof(inotify_event) + event->len);
+        }
+    }
+    return matched;
+}
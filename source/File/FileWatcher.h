@@ -0,0 +1,34 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+// Calls on_change from its own thread after the file was written, replaced or moved into place. The
+// directory is watched, so editors saving through a temporary file are seen as well, and bursts of
+// events are reported once after settle_delay without further changes.
+class FileWatcher {
+public:
+    FileWatcher(std::filesystem::path file_path, std::function<void()> on_change,
+                std::chrono::milliseconds settle_delay = std::chrono::milliseconds(200));
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    std::error_code init();
+    void deinit();
+
+private:
+    void run();
+    bool readEvents() const;
+    std::filesystem::path file_path_;
+    std::function<void()> on_change_;
+    std::chrono::milliseconds settle_delay_;
+    int inotify_fd_{-1};
+    int stop_fd_{-1};
+    std::thread watcher_thread_;
+};
+
+#endif //FILEWATCHER_H
@@ -0,0 +1,176 @@
+#ifndef PERIPHERY_MANAGER_ASYNCLOGADAPTER_H
+#define PERIPHERY_MANAGER_ASYNCLOGADAPTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <fmt/format.h>
+#include "Logger/LoggerInterface.h"
+#include "Logger/LogRingBuffer.h"
+#include "Logger/LogSink.h"
+
+// Queues log lines into a lock-free ring and writes them in batches from a dedicated thread, so the
+// logging thread (including GStreamer streaming threads) never waits on a mutex or on the output.
+class AsyncLogAdapter : public LoggerInterface {
+public:
+    enum class OverflowPolicy {
+        Block, // Wait for the writer to free a slot
+        Drop   // Discard the message, the writer reports the number of dropped messages
+    };
+
+    static constexpr size_t DEFAULT_CAPACITY {8192};
+
+    explicit AsyncLogAdapter(std::unique_ptr<LogSink> sink, const size_t capacity = DEFAULT_CAPACITY,
+                             const OverflowPolicy overflow_policy = OverflowPolicy::Block)
+        : sink_(std::move(sink)), ring_(capacity), overflow_policy_(overflow_policy) {
+        writer_thread_ = std::thread(&AsyncLogAdapter::runWriter, this);
+    }
+
+    ~AsyncLogAdapter() override {
+        keep_running_ = false;
+        wakeWriter();
+        if (writer_thread_.joinable()) {
+            writer_thread_.join();
+        }
+    }
+
+    AsyncLogAdapter(const AsyncLogAdapter&) = delete;
+    AsyncLogAdapter& operator=(const AsyncLogAdapter&) = delete;
+
+    void setLogLevel(const LogLevel level) override {
+        log_level_ = level;
+    }
+
+    // Blocks until every message queued before the call was written
+    void flush() {
+        const auto position = ring_.getPushedPosition();
+        while (ring_.getConsumedPosition() < position) {
+            wakeWriter();
+            std::this_thread::yield();
+        }
+    }
+
+    size_t getDroppedCount() const {
+        return dropped_total_.load(std::memory_order_relaxed);
+    }
+
+protected:
+    void logImpl(const LogLevel level, const std::string_view msg) override {
+        if (level < log_level_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        while (!ring_.tryPush(level, msg)) {
+            if (overflow_policy_ == OverflowPolicy::Drop) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                dropped_total_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            wakeWriter();
+            std::this_thread::yield();
+        }
+
+        if (writer_sleeping_.load(std::memory_order_relaxed)) {
+            wakeWriter();
+        }
+
+        if (level == LogLevel::Critical) {
+            flush();
+            throw std::runtime_error(std::string(msg));
+        }
+    }
+
+private:
+    static constexpr size_t BATCH_SIZE {256};
+    static constexpr std::chrono::milliseconds IDLE_WAIT {10};
+
+    // Notifies without taking the mutex, a wakeup lost to the race is caught by the idle timeout
+    void wakeWriter() {
+        wake_condition_.notify_one();
+    }
+
+    void runWriter() {
+        fmt::memory_buffer batch;
+        while (true) {
+            const auto running = keep_running_.load();
+            batch.clear();
+            if (const auto dropped = dropped_.exchange(0, std::memory_order_relaxed)) {
+                appendLine(batch, LogLevel::Warn, std::chrono::system_clock::now(),
+                           fmt::format("{} log messages dropped, the log queue is full", dropped), false);
+            }
+            const auto count = ring_.consume([this, &batch](const LogRecord& record) {
+                appendLine(batch, record.level, record.time, record.text(), record.truncated);
+            }, BATCH_SIZE);
+            if (batch.size() != 0) {
+                sink_->write({batch.data(), batch.size()});
+            }
+
+            if (count == BATCH_SIZE) {
+                continue;
+            }
+            if (!running) {
+                break; // Queue drained after shutdown was requested
+            }
+
+            std::unique_lock lock(wake_mutex_);
+            writer_sleeping_ = true;
+            wake_condition_.wait_for(lock, IDLE_WAIT);
+            writer_sleeping_ = false;
+        }
+    }
+
+    // Same layout as the spdlog backend: [2024-01-01 12:00:00.000] [console] [info] message
+    void appendLine(fmt::memory_buffer& batch, const LogLevel level, const std::chrono::system_clock::time_point time,
+                    const std::string_view text, const bool truncated) {
+        const auto seconds = std::chrono::system_clock::to_time_t(time);
+        if (seconds != cached_seconds_) {
+            cached_seconds_ = seconds;
+            localtime_r(&seconds, &cached_time_);
+        }
+        const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+            time.time_since_epoch()).count() % 1000;
+        fmt::format_to(std::back_inserter(batch), "[{:04}-{:02}-{:02} {:02}:{:02}:{:02}.{:03}] [console] [{}] {}{}\n",
+                       cached_time_.tm_year + 1900, cached_time_.tm_mon + 1, cached_time_.tm_mday, cached_time_.tm_hour,
+                       cached_time_.tm_min, cached_time_.tm_sec, milliseconds, toString(level), text,
+                       truncated ? " [truncated]" : "");
+    }
+
+    static const char* toString(const LogLevel level) {
+        switch (level) {
+            case LogLevel::Trace:
+                return "trace";
+            case LogLevel::Debug:
+                return "debug";
+            case LogLevel::Info:
+                return "info";
+            case LogLevel::Warn:
+                return "warning";
+            case LogLevel::Error:
+                return "error";
+            case LogLevel::Critical:
+                return "critical";
+            default:
+                return "unknown";
+        }
+    }
+
+    std::unique_ptr<LogSink> sink_;
+    LogRingBuffer ring_;
+    OverflowPolicy overflow_policy_;
+    std::atomic<LogLevel> log_level_ {LogLevel::Info};
+    std::atomic<size_t> dropped_ {0};
+    std::atomic<size_t> dropped_total_ {0};
+    std::atomic<bool> keep_running_ {true};
+    std::atomic<bool> writer_sleeping_ {false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_condition_;
+    std::thread writer_thread_;
+    std::time_t cached_seconds_ {-1};
+    std::tm cached_time_ {};
+};
+
+#endif //PERIPHERY_MANAGER_ASYNCLOGADAPTER_H
@@ -0,0 +1,121 @@
+#ifndef PERIPHERY_MANAGER_LOGRINGBUFFER_H
+#define PERIPHERY_MANAGER_LOGRINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include "Logger/LoggerInterface.h"
+
+// Formatted message waiting for the writer thread, longer messages are truncated
+struct LogRecord {
+    static constexpr size_t MAX_MESSAGE_SIZE {480};
+    LoggerInterface::LogLevel level {LoggerInterface::LogLevel::Info};
+    std::chrono::system_clock::time_point time;
+    size_t size {0};
+    bool truncated {false};
+    char message[MAX_MESSAGE_SIZE];
+
+    void assign(const LoggerInterface::LogLevel record_level, const std::string_view text) {
+        level = record_level;
+        time = std::chrono::system_clock::now();
+        size = std::min(text.size(), MAX_MESSAGE_SIZE);
+        truncated = size < text.size();
+        std::memcpy(message, text.data(), size);
+    }
+
+    std::string_view text() const { return {message, size}; }
+};
+
+// Bounded lock-free multi-producer single-consumer ring of log records. Producers claim a slot with
+// one CAS and copy the message in place, so logging never locks or allocates on the calling thread.
+class LogRingBuffer {
+public:
+    explicit LogRingBuffer(const size_t capacity) : capacity_(roundUpToPowerOfTwo(capacity)), mask_(capacity_ - 1),
+                                                    slots_(std::make_unique<Slot[]>(capacity_)) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LogRingBuffer(const LogRingBuffer&) = delete;
+    LogRingBuffer& operator=(const LogRingBuffer&) = delete;
+
+    // Returns false if the ring is full
+    bool tryPush(const LoggerInterface::LogLevel level, const std::string_view text) {
+        Slot* slot;
+        size_t position = enqueue_position_.load(std::memory_order_relaxed);
+        while (true) {
+            slot = &slots_[position & mask_];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0) {
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueue_position_.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->record.assign(level, text);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Hands up to max_count published records to the consumer in order, only one thread may consume
+    template<typename Consumer>
+    size_t consume(Consumer&& consumer, const size_t max_count) {
+        size_t count = 0;
+        for (; count < max_count; ++count) {
+            auto& slot = slots_[dequeue_position_ & mask_];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeue_position_ + 1) {
+                break;
+            }
+            consumer(slot.record);
+            slot.sequence.store(dequeue_position_ + capacity_, std::memory_order_release);
+            ++dequeue_position_;
+        }
+        consumed_position_.store(dequeue_position_, std::memory_order_release);
+        return count;
+    }
+
+    // Position after the last claimed slot, the record there is consumed once getConsumedPosition() reaches it
+    size_t getPushedPosition() const {
+        return enqueue_position_.load(std::memory_order_acquire);
+    }
+
+    size_t getConsumedPosition() const {
+        return consumed_position_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE {64};
+
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        LogRecord record;
+    };
+
+    static size_t roundUpToPowerOfTwo(const size_t value) {
+        size_t power = 2;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_position_{0};
+    alignas(CACHE_LINE_SIZE) size_t dequeue_position_{0};
+    std::atomic<size_t> consumed_position_{0};
+};
+
+#endif //PERIPHERY_MANAGER_LOGRINGBUFFER_H
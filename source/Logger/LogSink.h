@@ -0,0 +1,103 @@
+#ifndef PERIPHERY_MANAGER_LOGSINK_H
+#define PERIPHERY_MANAGER_LOGSINK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Destination of the batches written by the asynchronous logger, only called from its writer thread
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+    virtual void write(std::string_view batch) = 0;
+};
+
+class StdoutLogSink : public LogSink {
+public:
+    void write(const std::string_view batch) override {
+        std::fwrite(batch.data(), 1, batch.size(), stdout);
+        std::fflush(stdout);
+    }
+};
+
+// Appends to a file and rotates it once it exceeds max_size bytes or is older than rotate_interval
+// (zero disables either check). Rotated files are kept as <file>.1 (newest) to <file>.<max_files>.
+class RotatingFileLogSink : public LogSink {
+public:
+    RotatingFileLogSink(std::filesystem::path path, const size_t max_size, const std::chrono::seconds rotate_interval,
+                        const size_t max_files)
+        : path_(std::move(path)), max_size_(max_size), rotate_interval_(rotate_interval), max_files_(max_files) {
+        open("a");
+    }
+
+    ~RotatingFileLogSink() override {
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    RotatingFileLogSink(const RotatingFileLogSink&) = delete;
+    RotatingFileLogSink& operator=(const RotatingFileLogSink&) = delete;
+
+    void write(const std::string_view batch) override {
+        const auto size_exceeded = max_size_ != 0 && size_ != 0 && size_ + batch.size() > max_size_;
+        const auto interval_elapsed = rotate_interval_.count() != 0 &&
+                                      std::chrono::steady_clock::now() - opened_time_ >= rotate_interval_;
+        if (size_exceeded || interval_elapsed) {
+            rotate();
+        }
+
+        if (!file_) {
+            std::fwrite(batch.data(), 1, batch.size(), stderr);
+            return;
+        }
+        size_ += std::fwrite(batch.data(), 1, batch.size(), file_);
+        std::fflush(file_);
+    }
+
+private:
+    void open(const char* mode) {
+        file_ = std::fopen(path_.c_str(), mode);
+        if (!file_) {
+            std::fprintf(stderr, "Failed to open log file %s, logging to stderr\n", path_.c_str());
+            return;
+        }
+        std::fseek(file_, 0, SEEK_END);
+        size_ = static_cast<size_t>(std::max(0L, std::ftell(file_)));
+        opened_time_ = std::chrono::steady_clock::now();
+    }
+
+    void rotate() {
+        if (file_) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+
+        std::error_code ec;
+        for (auto index = max_files_; index > 1; --index) {
+            std::filesystem::rename(rotatedPath(index - 1), rotatedPath(index), ec);
+        }
+        if (max_files_ > 0) {
+            std::filesystem::rename(path_, rotatedPath(1), ec);
+        }
+        open("w");
+    }
+
+    std::filesystem::path rotatedPath(const size_t index) const {
+        return path_.string() + "." + std::to_string(index);
+    }
+
+    std::filesystem::path path_;
+    size_t max_size_;
+    std::chrono::seconds rotate_interval_;
+    size_t max_files_;
+    std::FILE* file_ {nullptr};
+    size_t size_ {0};
+    std::chrono::steady_clock::time_point opened_time_ {std::chrono::steady_clock::now()};
+};
+
+#endif //PERIPHERY_MANAGER_LOGSINK_H
@@ -3,7 +3,14 @@
 
 #include "Logger/LoggerInterface.h"
 #include "Logger/SpdLogAdapter.h" /* Or use StdoutAdapter.h */
+#include <atomic>
 #include <memory>
+#include <utility>
+
+// LOG_* calls below this level are compiled out (0 trace, 1 debug, 2 info, 3 warn, 4 error), critical is always kept
+#ifndef LOG_ACTIVE_LEVEL
+#define LOG_ACTIVE_LEVEL 0
+#endif
 
 class Logger {
 public:
@@ -15,28 +22,78 @@ public:
         return instance;
     }
 
-    void setLogLevel(const LoggerInterface::LogLevel level) const {
+    // Replaces the backend, only safe before other threads start logging
+    void setAdapter(std::shared_ptr<LoggerInterface> adapter) {
+        logger_adapter_ = std::move(adapter);
+        logger_adapter_->setLogLevel(log_level_);
+    }
+
+    void setLogLevel(const LoggerInterface::LogLevel level) {
+        log_level_ = level;
         logger_adapter_->setLogLevel(level);
     }
 
+    bool isEnabled(const LoggerInterface::LogLevel level) const {
+        return level >= log_level_.load(std::memory_order_relaxed);
+    }
+
     template<typename... Args>
-    void log(LoggerInterface::LogLevel level, const std::string& format, Args... args) {
-        logger_adapter_->log(level, format, std::forward<Args>(args)...);
+    void log(LoggerInterface::LogLevel level, fmt::format_string<Args...> format, Args&&... args) {
+        if (isEnabled(level)) {
+            logger_adapter_->log(level, format, std::forward<Args>(args)...);
+        }
     }
 
 private:
     Logger() = default;
 
     std::shared_ptr<LoggerInterface> logger_adapter_ = std::make_shared<SpdLogAdapter>(); /* Or use StdoutAdapter */
+    std::atomic<LoggerInterface::LogLevel> log_level_ {LoggerInterface::LogLevel::Info};
 };
 
 #define SET_LOG_LEVEL(level) Logger::getInstance().setLogLevel(level)
 
-#define LOG_TRACE(...) Logger::getInstance().log(LoggerInterface::LogLevel::Trace, __VA_ARGS__)
-#define LOG_DEBUG(...) Logger::getInstance().log(LoggerInterface::LogLevel::Debug, __VA_ARGS__)
-#define LOG_INFO(...) Logger::getInstance().log(LoggerInterface::LogLevel::Info, __VA_ARGS__)
-#define LOG_WARN(...) Logger::getInstance().log(LoggerInterface::LogLevel::Warn, __VA_ARGS__)
-#define LOG_ERROR(...) Logger::getInstance().log(LoggerInterface::LogLevel::Error, __VA_ARGS__)
-#define LOG_CRITICAL(...) Logger::getInstance().log(LoggerInterface::LogLevel::Critical, __VA_ARGS__)
+// The level is checked before the arguments are evaluated, so disabled calls cost one atomic load.
+// FMT_STRING validates the format string against the arguments at compile time.
+#define LOG_AT_LEVEL(level, format, ...) \
+    do { \
+        if (Logger::getInstance().isEnabled(level)) { \
+            Logger::getInstance().log(level, FMT_STRING(format), ##__VA_ARGS__); \
+        } \
+    } while (false)
+
+#define LOG_DISABLED(...) do {} while (false)
+
+#if LOG_ACTIVE_LEVEL <= 0
+#define LOG_TRACE(...) LOG_AT_LEVEL(LoggerInterface::LogLevel::Trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= 1
+#define LOG_DEBUG(...) LOG_AT_LEVEL(LoggerInterface::LogLevel::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= 2
+#define LOG_INFO(...) LOG_AT_LEVEL(LoggerInterface::LogLevel::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= 3
+#define LOG_WARN(...) LOG_AT_LEVEL(LoggerInterface::LogLevel::Warn, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_ACTIVE_LEVEL <= 4
+#define LOG_ERROR(...) LOG_AT_LEVEL(LoggerInterface::LogLevel::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#define LOG_CRITICAL(...) LOG_AT_LEVEL(LoggerInterface::LogLevel::Critical, __VA_ARGS__)
 
 #endif //PERIPHERY_MANAGER_LOGGER_H
@@ -1,7 +1,9 @@
 #ifndef PERIPHERY_MANAGER_LOGGERINTERFACE_H
 #define PERIPHERY_MANAGER_LOGGERINTERFACE_H
 
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <fmt/format.h>
 
 class LoggerInterface {
@@ -17,15 +19,18 @@ public:
 
     virtual ~LoggerInterface() = default;
 
+    // The format string is checked at compile time, short messages are formatted without allocating
     template<typename... Args>
-    void log(LogLevel level, const std::string &format, Args &&... args) {
-        logImpl(level, fmt::format(format, std::forward<Args>(args)...));
+    void log(LogLevel level, fmt::format_string<Args...> format, Args &&... args) {
+        fmt::memory_buffer message;
+        fmt::format_to(std::back_inserter(message), format, std::forward<Args>(args)...);
+        logImpl(level, std::string_view(message.data(), message.size()));
     }
 
     virtual void setLogLevel(LogLevel level) = 0;
 
 protected:
-    virtual void logImpl(LogLevel level, const std::string &msg) = 0;
+    virtual void logImpl(LogLevel level, std::string_view msg) = 0;
 };
 
-#endif //PERIPHERY_MANAGER_LOGGERINTERFACE_H
\ No newline at end of file
+#endif //PERIPHERY_MANAGER_LOGGERINTERFACE_H
@@ -24,11 +24,11 @@ public:
     }
 
 protected:
-    void logImpl(LogLevel level, const std::string &msg) override {
+    void logImpl(LogLevel level, const std::string_view msg) override {
         logger_->log(toSpdLogLevel(level), msg);
 
         if (level == LogLevel::Critical) {
-            throw std::runtime_error(msg);
+            throw std::runtime_error(std::string(msg));
         }
     }
 
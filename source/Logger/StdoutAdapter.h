@@ -17,13 +17,13 @@ public:
     }
 
 protected:
-    void logImpl(LogLevel level, const std::string& msg) override {
+    void logImpl(LogLevel level, const std::string_view msg) override {
         if (level >= log_level_) {
             std::cout << "[" << toSpdLogLevel(level) << "] " << msg << std::endl;
         }
 
         if (level == LogLevel::Error || level == LogLevel::Critical) {
-            throw std::runtime_error(msg);
+            throw std::runtime_error(std::string(msg));
         }
     }
 
@@ -0,0 +1,175 @@
+#include "IoUring.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    template<typename T>
+    T* ringPointer(void* ring, const unsigned int offset) {
+        return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+    }
+}
+
+IoUring::~IoUring() {
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+    }
+}
+
+std::error_code IoUring::init(const unsigned int entries, const unsigned int cq_entries) {
+    io_uring_params params{};
+    if (cq_entries != 0) {
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = cq_entries;
+    }
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring_fd_ < 0) {
+        return {errno, std::generic_category()};
+    }
+
+    features_ = params.features;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (hasFeature(IORING_FEAT_SINGLE_MMAP)) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        return {errno, std::generic_category()};
+    }
+
+    if (hasFeature(IORING_FEAT_SINGLE_MMAP)) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                        IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            return {errno, std::generic_category()};
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    auto* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return {errno, std::generic_category()};
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_ = ringPointer<unsigned int>(sq_ring_, params.sq_off.head);
+    sq_tail_ = ringPointer<unsigned int>(sq_ring_, params.sq_off.tail);
+    sq_array_ = ringPointer<unsigned int>(sq_ring_, params.sq_off.array);
+    sq_mask_ = *ringPointer<unsigned int>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+    cq_head_ = ringPointer<unsigned int>(cq_ring_, params.cq_off.head);
+    cq_tail_ = ringPointer<unsigned int>(cq_ring_, params.cq_off.tail);
+    cqes_ = ringPointer<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+    cq_mask_ = *ringPointer<unsigned int>(cq_ring_, params.cq_off.ring_mask);
+
+    return {};
+}
+
+bool IoUring::hasFeature(const unsigned int feature) const {
+    return (features_ & feature) == feature;
+}
+
+bool IoUring::supportsOperations(const std::initializer_list<uint8_t> operations) const {
+    constexpr size_t MAX_PROBE_OPS {256};
+    alignas(io_uring_probe) std::array<char, sizeof(io_uring_probe) + MAX_PROBE_OPS * sizeof(io_uring_probe_op)> buffer{};
+    auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+
+    if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe, MAX_PROBE_OPS) < 0) {
+        return false;
+    }
+
+    return std::all_of(operations.begin(), operations.end(), [probe](const uint8_t operation) {
+        return operation <= probe->last_op && (probe->ops[operation].flags & IO_URING_OP_SUPPORTED);
+    });
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    const unsigned int head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sq_local_tail_ - head >= sq_entries_) {
+        return nullptr;
+    }
+
+    const unsigned int index = sq_local_tail_ & sq_mask_;
+    sq_array_[index] = index;
+    ++sq_local_tail_;
+
+    auto* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+std::error_code IoUring::submit(const unsigned int wait_completions, const __kernel_timespec* timeout) {
+    // Entries a failed call left unconsumed are submitted again
+    __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+    const unsigned int to_submit = sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+
+    unsigned int flags = wait_completions > 0 ? IORING_ENTER_GETEVENTS : 0;
+    io_uring_getevents_arg arg{};
+    void* arg_ptr = nullptr;
+    size_t arg_size = 0;
+    if (timeout) {
+        arg.ts = reinterpret_cast<uint64_t>(timeout);
+        flags |= IORING_ENTER_EXT_ARG;
+        arg_ptr = &arg;
+        arg_size = sizeof(arg);
+    }
+
+    syscall_count_.fetch_add(1, std::memory_order_relaxed);
+    if (syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_completions, flags, arg_ptr, arg_size) < 0) {
+        return {errno, std::generic_category()};
+    }
+
+    return {};
+}
+
+io_uring_cqe* IoUring::peekCqe() const {
+    const unsigned int head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        return nullptr;
+    }
+
+    return &cqes_[head & cq_mask_];
+}
+
+void IoUring::seenCqe() {
+    __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+}
+
+std::error_code IoUring::registerBufferRing(io_uring_buf_ring* buffer_ring, const unsigned int entries,
+                                            const uint16_t group_id) {
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(buffer_ring);
+    registration.ring_entries = entries;
+    registration.bgid = group_id;
+    if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        return {errno, std::generic_category()};
+    }
+
+    return {};
+}
+
+uint64_t IoUring::getSyscallCount() const {
+    return syscall_count_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,54 @@
+#ifndef PERIPHERY_MANAGER_IOURING_H
+#define PERIPHERY_MANAGER_IOURING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <system_error>
+#include <linux/io_uring.h>
+
+// Minimal io_uring wrapper on top of the raw syscalls. A ring is owned by a single thread, only the syscall count
+// may be read from others.
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    // A completion queue of cq_entries, twice the submission queue if 0
+    std::error_code init(unsigned int entries, unsigned int cq_entries = 0);
+    bool hasFeature(unsigned int feature) const;
+    bool supportsOperations(std::initializer_list<uint8_t> operations) const;
+    io_uring_sqe* getSqe();
+    std::error_code submit(unsigned int wait_completions, const __kernel_timespec* timeout = nullptr);
+    io_uring_cqe* peekCqe() const;
+    void seenCqe();
+    // Registers a ring of provided buffers for recv with IOSQE_BUFFER_SELECT. The ring memory is page aligned,
+    // owned by the caller and must outlive this ring.
+    std::error_code registerBufferRing(io_uring_buf_ring* buffer_ring, unsigned int entries, uint16_t group_id);
+    uint64_t getSyscallCount() const;
+
+private:
+    int ring_fd_{-1};
+    unsigned int features_{0};
+    void* sq_ring_{nullptr};
+    void* cq_ring_{nullptr};
+    size_t sq_ring_size_{0};
+    size_t cq_ring_size_{0};
+    io_uring_sqe* sqes_{nullptr};
+    size_t sqes_size_{0};
+    unsigned int* sq_head_{nullptr};
+    unsigned int* sq_tail_{nullptr};
+    unsigned int* sq_array_{nullptr};
+    unsigned int sq_mask_{0};
+    unsigned int sq_entries_{0};
+    unsigned int sq_local_tail_{0};
+    unsigned int* cq_head_{nullptr};
+    unsigned int* cq_tail_{nullptr};
+    io_uring_cqe* cqes_{nullptr};
+    unsigned int cq_mask_{0};
+    std::atomic<uint64_t> syscall_count_{0};
+};
+
+#endif //PERIPHERY_MANAGER_IOURING_H
@@ -1,18 +1,39 @@
 #ifndef PERIPHERY_MANAGER_NETWORKINTERFACE_H
 #define PERIPHERY_MANAGER_NETWORKINTERFACE_H
 
-#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
 #include <system_error>
+#include <utility>
 
 class NetworkInterface {
 public:
+    // Receives the events of every connection of a backend that serves them from one completion loop
+    class ConnectionHandler {
+    public:
+        virtual ~ConnectionHandler() = default;
+        virtual void onConnect(int client_socket) = 0;
+        // The data is only valid during the call
+        virtual void onData(int client_socket, std::string_view data) = 0;
+        virtual void onDisconnect(int client_socket) = 0;
+    };
     virtual ~NetworkInterface() = default;
     virtual std::error_code init() = 0;
     virtual int acceptConnection() = 0;
-    virtual std::pair<std::vector<char>, bool> readData(int client_socket) = 0;
-    virtual std::error_code sendData(int client_socket, const std::vector<char> data) = 0;
+    // Reads into the caller-owned buffer, returns a view of the received bytes and a disconnect flag
+    virtual std::pair<std::string_view, bool> readData(int client_socket, char* buffer, size_t buffer_size) = 0;
+    // Sends all chunks as a single gathered write
+    virtual std::error_code sendData(int client_socket, std::initializer_list<std::string_view> chunks) = 0;
     virtual void closeConnection() = 0;
     virtual int getServerSocket() = 0;
+    // Backends multiplexing every connection on the calling thread serve them until keep_running is cleared and
+    // return true. The others return false right away and are driven through acceptConnection and readData.
+    virtual bool serveConnections(ConnectionHandler&, const std::atomic<bool>&) { return false; }
+    // Syscalls issued to receive and send data, for comparing backends
+    virtual uint64_t getIoSyscallCount() const { return 0; }
 };
 
 #endif //PERIPHERY_MANAGER_NETWORKINTERFACE_H
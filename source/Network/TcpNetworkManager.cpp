@@ -3,10 +3,18 @@
 #include <csignal>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <array>
 #include <thread>
 
-constexpr int MAX_BUFFER_SIZE {1024};
-constexpr int MAX_CLIENTS_NUM {5};
+// Connections waiting to be accepted, clients connecting in a burst beyond it wait for a SYN retransmit
+constexpr int MAX_PENDING_CONNECTIONS {SOMAXCONN};
+constexpr size_t MAX_SEND_CHUNKS {8};
+constexpr int SEND_TIMEOUT_MS {1000};
 
 TcpNetworkManager::TcpNetworkManager(const int port) :
         port_(port) {}
@@ -35,7 +43,7 @@ std::error_code TcpNetworkManager::init() {
         return {errno, std::generic_category()};
     }
 
-    listen(server_socket_, MAX_CLIENTS_NUM);
+    listen(server_socket_, MAX_PENDING_CONNECTIONS);
 
     return {};
 }
@@ -55,16 +63,20 @@ int TcpNetworkManager::acceptConnection() {
             return -1;
         }
     } else {
+        // A command is answered with an acceptance line and then its outcome, both are sent right away
+        // instead of the second one waiting until the first is acknowledged
+        constexpr int no_delay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
         return client_socket;
     }
 
     return -1;
 }
 
-std::pair<std::vector<char>, bool> TcpNetworkManager::readData(const int client_socket) {
+std::pair<std::string_view, bool> TcpNetworkManager::readData(const int client_socket, char* buffer, const size_t buffer_size) {
     fd_set read_fds;
     timeval tv {};
-    std::vector<char> buffer(MAX_BUFFER_SIZE);
+    size_t bytes_received{0};
     bool disconnect{false};
 
     FD_ZERO(&read_fds);
@@ -74,28 +86,67 @@ std::pair<std::vector<char>, bool> TcpNetworkManager::readData(const int client_
     tv.tv_sec = 1;
     tv.tv_usec = 0;
 
-    if (select(client_socket + 1, &read_fds, nullptr, nullptr, &tv) >= 0 ) {
-        const ssize_t bytes_read = read(client_socket, buffer.data(), buffer.size() - 1);
+    io_syscall_count_.fetch_add(1, std::memory_order_relaxed);
+    if (const int ready = select(client_socket + 1, &read_fds, nullptr, nullptr, &tv); ready > 0) {
+        io_syscall_count_.fetch_add(1, std::memory_order_relaxed);
+        const ssize_t bytes_read = read(client_socket, buffer, buffer_size);
         if (bytes_read > 0) {
-            buffer.resize(bytes_read);
+            bytes_received = static_cast<size_t>(bytes_read);
         } else if (bytes_read == 0) {
             disconnect = true;
-        } else {
-            buffer.clear();
-            if (errno != EWOULDBLOCK && errno != EAGAIN) {
-                LOG_ERROR("[Message Server] Reading failed");
-            }
+        } else if (errno != EWOULDBLOCK && errno != EAGAIN) {
+            LOG_ERROR("[Message Server] Reading failed");
         }
-    } else {
+    } else if (ready < 0 && errno != EINTR) {
         LOG_ERROR("[Message Server] Listening to socket failed");
     }
 
-    return {buffer, disconnect};
+    return {std::string_view(buffer, bytes_received), disconnect};
 }
 
-std::error_code TcpNetworkManager::sendData(const int client_socket, const std::vector<char> data) {
-    if (send(client_socket, data.data(), data.size(), 0) < 0) {
-        return {errno, std::generic_category()};
+std::error_code TcpNetworkManager::sendData(const int client_socket, const std::initializer_list<std::string_view> chunks) {
+    std::array<iovec, MAX_SEND_CHUNKS> iov{};
+    if (chunks.size() > iov.size()) {
+        return std::make_error_code(std::errc::argument_list_too_long);
+    }
+
+    size_t iov_count{0};
+    for (const auto& chunk: chunks) {
+        if (!chunk.empty()) {
+            iov[iov_count++] = {const_cast<char*>(chunk.data()), chunk.size()};
+        }
+    }
+
+    // The client socket is non-blocking, so keep writing until the kernel took every chunk
+    auto* next = iov.data();
+    while (iov_count > 0) {
+        io_syscall_count_.fetch_add(1, std::memory_order_relaxed);
+        const ssize_t bytes_written = writev(client_socket, next, static_cast<int>(iov_count));
+        if (bytes_written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                io_syscall_count_.fetch_add(1, std::memory_order_relaxed);
+                pollfd write_fd {client_socket, POLLOUT, 0};
+                if (poll(&write_fd, 1, SEND_TIMEOUT_MS) > 0) {
+                    continue;
+                }
+                return std::make_error_code(std::errc::timed_out);
+            }
+            return {errno, std::generic_category()};
+        }
+
+        auto remaining = static_cast<size_t>(bytes_written);
+        while (iov_count > 0 && remaining >= next->iov_len) {
+            remaining -= next->iov_len;
+            ++next;
+            --iov_count;
+        }
+        if (iov_count > 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + remaining;
+            next->iov_len -= remaining;
+        }
     }
 
     return {};
@@ -111,3 +162,7 @@ void TcpNetworkManager::closeConnection() {
 int TcpNetworkManager::getServerSocket() {
     return server_socket_;
 }
+
+uint64_t TcpNetworkManager::getIoSyscallCount() const {
+    return io_syscall_count_.load(std::memory_order_relaxed);
+}
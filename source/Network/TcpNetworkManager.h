@@ -1,7 +1,7 @@
 #ifndef PERIPHERY_MANAGER_TCPNETWORKMANAGER_H
 #define PERIPHERY_MANAGER_TCPNETWORKMANAGER_H
 
-#include <vector>
+#include <atomic>
 #include "NetworkInterface.h"
 
 class TcpNetworkManager : public NetworkInterface {
@@ -10,14 +10,16 @@ public:
     ~TcpNetworkManager() override = default;
     std::error_code init() override;
     int acceptConnection() override;
-    std::pair<std::vector<char>, bool> readData(int client_socket) override;
-    std::error_code sendData(int client_socket, const std::vector<char> data) override;
+    std::pair<std::string_view, bool> readData(int client_socket, char* buffer, size_t buffer_size) override;
+    std::error_code sendData(int client_socket, std::initializer_list<std::string_view> chunks) override;
     void closeConnection() override;
     int getServerSocket() override;
+    uint64_t getIoSyscallCount() const override;
 
 private:
     int server_socket_{-1};
     int port_{-1};
+    std::atomic<uint64_t> io_syscall_count_{0};
 };
 
 #endif //PERIPHERY_MANAGER_TCPNETWORKMANAGER_H
@@ -0,0 +1,87 @@
+#include "UnixNetworkManager.h"
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include "Logger/Logger.h"
+
+constexpr int MAX_CLIENTS_NUM {5};
+constexpr int ACCEPT_TIMEOUT_MS {100};
+
+UnixNetworkManager::UnixNetworkManager(std::string socket_name) :
+        TcpNetworkManager(-1), socket_name_(std::move(socket_name)) {}
+
+UnixNetworkManager::~UnixNetworkManager() {
+    UnixNetworkManager::closeConnection();
+}
+
+socklen_t UnixNetworkManager::makeAddress(const std::string& socket_name, sockaddr_un& address) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_name.empty() || socket_name.size() >= sizeof(address.sun_path)) {
+        return 0;
+    }
+
+    std::memcpy(address.sun_path, socket_name.data(), socket_name.size());
+    if (socket_name.front() == '@') {
+        // Abstract names are not terminated, the address length delimits them
+        address.sun_path[0] = '\0';
+        return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + socket_name.size());
+    }
+    return static_cast<socklen_t>(sizeof(address));
+}
+
+std::error_code UnixNetworkManager::init() {
+    sockaddr_un server_addr{};
+    const auto address_length = makeAddress(socket_name_, server_addr);
+    if (address_length == 0) {
+        return std::make_error_code(std::errc::filename_too_long);
+    }
+
+    if (server_socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0); server_socket_ < 0) {
+        return {errno, std::generic_category()};
+    }
+
+    if (socket_name_.front() != '@') {
+        unlink(socket_name_.c_str());
+    }
+
+    if (bind(server_socket_, reinterpret_cast<sockaddr*>(&server_addr), address_length) != 0 ||
+        listen(server_socket_, MAX_CLIENTS_NUM) != 0) {
+        const std::error_code ec {errno, std::generic_category()};
+        close(server_socket_);
+        server_socket_ = -1;
+        return ec;
+    }
+
+    LOG_DEBUG("[Message Server] Listening on unix socket {}", socket_name_);
+    return {};
+}
+
+int UnixNetworkManager::acceptConnection() {
+    if (server_socket_ < 0) {
+        return -1;
+    }
+
+    // Wait for a connection instead of spinning, supervised workers keep their control server idle most of the time
+    pollfd accept_fd {server_socket_, POLLIN, 0};
+    if (poll(&accept_fd, 1, ACCEPT_TIMEOUT_MS) <= 0) {
+        return -1;
+    }
+
+    return accept4(server_socket_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+}
+
+void UnixNetworkManager::closeConnection() {
+    if (server_socket_ != -1) {
+        close(server_socket_);
+        server_socket_ = -1;
+        if (socket_name_.front() != '@') {
+            unlink(socket_name_.c_str());
+        }
+    }
+}
+
+int UnixNetworkManager::getServerSocket() {
+    return server_socket_;
+}
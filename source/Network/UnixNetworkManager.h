@@ -0,0 +1,28 @@
+#ifndef PERIPHERY_MANAGER_UNIXNETWORKMANAGER_H
+#define PERIPHERY_MANAGER_UNIXNETWORKMANAGER_H
+
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "Network/TcpNetworkManager.h"
+
+// Control server on a unix domain stream socket. A name starting with '@' is bound in the abstract namespace and
+// vanishes with the process, any other name is a filesystem path that is replaced on init and removed on close.
+// Client connections are read and written like TCP ones.
+class UnixNetworkManager : public TcpNetworkManager {
+public:
+    explicit UnixNetworkManager(std::string socket_name);
+    ~UnixNetworkManager() override;
+    std::error_code init() override;
+    int acceptConnection() override;
+    void closeConnection() override;
+    int getServerSocket() override;
+    // Fills the address of a socket name, returns its length or 0 when the name is too long
+    static socklen_t makeAddress(const std::string& socket_name, sockaddr_un& address);
+
+private:
+    std::string socket_name_;
+    int server_socket_{-1};
+};
+
+#endif //PERIPHERY_MANAGER_UNIXNETWORKMANAGER_H
@@ -0,0 +1,207 @@
+#include "UringNetworkManager.h"
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include "Logger/Logger.h"
+
+constexpr unsigned int SUBMISSION_ENTRIES {64};
+constexpr unsigned int COMPLETION_ENTRIES {1024};
+// Shared by all connections, a buffer is handed back to the kernel as soon as its message was handled
+constexpr unsigned int BUFFER_COUNT {256};
+constexpr size_t BUFFER_SIZE {1024};
+constexpr uint16_t BUFFER_GROUP {0};
+constexpr __kernel_timespec WAIT_TIMEOUT {0, 100'000'000};
+
+enum OperationTag : uint64_t {
+    ACCEPT_TAG = 1,
+    RECV_TAG
+};
+
+namespace {
+uint64_t makeUserData(const OperationTag tag, const int socket) {
+    return static_cast<uint64_t>(tag) << 32 | static_cast<uint32_t>(socket);
+}
+
+// Multishot recv came with Linux 6.0, the probe doesn't report operation flags
+bool hasMultishotRecv() {
+    utsname name{};
+    unsigned int major = 0;
+    unsigned int minor = 0;
+    return uname(&name) == 0 && std::sscanf(name.release, "%u.%u", &major, &minor) == 2 && major >= 6;
+}
+}
+
+UringNetworkManager::UringNetworkManager(const int port)
+    : TcpNetworkManager(port), buffer_ring_(allocateBufferRing()), buffers_(BUFFER_COUNT * BUFFER_SIZE) {}
+
+UringNetworkManager::~UringNetworkManager() {
+    LOG_DEBUG("[Message Server] io_uring backend issued {} io_uring_enter calls", ring_.getSyscallCount());
+}
+
+UringNetworkManager::BufferRing UringNetworkManager::allocateBufferRing() {
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto size = (BUFFER_COUNT * sizeof(io_uring_buf) + page_size - 1) / page_size * page_size;
+    BufferRing buffer_ring {static_cast<io_uring_buf_ring*>(std::aligned_alloc(page_size, size)), &std::free};
+    // The kernel starts consuming at the head, the tail shares the first entry
+    if (buffer_ring) {
+        std::memset(buffer_ring.get(), 0, size);
+    }
+    return buffer_ring;
+}
+
+bool UringNetworkManager::isSupported() {
+    // Provided buffer rings came with Linux 5.19
+    const auto buffer_ring = allocateBufferRing();
+    IoUring ring;
+    if (!buffer_ring || ring.init(2) || !hasMultishotRecv()) {
+        return false;
+    }
+
+    return ring.hasFeature(IORING_FEAT_EXT_ARG) && ring.supportsOperations({IORING_OP_ACCEPT, IORING_OP_RECV}) &&
+           !ring.registerBufferRing(buffer_ring.get(), BUFFER_COUNT, BUFFER_GROUP);
+}
+
+std::error_code UringNetworkManager::init() {
+    if (auto ec = TcpNetworkManager::init()) {
+        return ec;
+    }
+
+    if (!buffer_ring_) {
+        return std::make_error_code(std::errc::not_enough_memory);
+    }
+    if (auto ec = ring_.init(SUBMISSION_ENTRIES, COMPLETION_ENTRIES)) {
+        return ec;
+    }
+    if (auto ec = ring_.registerBufferRing(buffer_ring_.get(), BUFFER_COUNT, BUFFER_GROUP)) {
+        return ec;
+    }
+    for (uint16_t buffer_id = 0; buffer_id < BUFFER_COUNT; ++buffer_id) {
+        provideBuffer(buffer_id);
+    }
+
+    return {};
+}
+
+// Hands a buffer to the kernel, which fills it with the next data received on any connection
+void UringNetworkManager::provideBuffer(const uint16_t buffer_id) {
+    // Indexed by hand, in C++ the empty struct ahead of the flexible bufs array of the uapi header moves it by 8 bytes
+    auto& buffer = reinterpret_cast<io_uring_buf*>(buffer_ring_.get())[buffer_ring_tail_ & (BUFFER_COUNT - 1)];
+    buffer.addr = reinterpret_cast<uint64_t>(buffers_.data() + buffer_id * BUFFER_SIZE);
+    buffer.len = BUFFER_SIZE;
+    buffer.bid = buffer_id;
+    __atomic_store_n(&buffer_ring_->tail, ++buffer_ring_tail_, __ATOMIC_RELEASE);
+}
+
+// Submissions are queued for the next wait, a full queue is flushed first
+io_uring_sqe* UringNetworkManager::nextSqe() {
+    auto* sqe = ring_.getSqe();
+    if (!sqe && !ring_.submit(0)) {
+        sqe = ring_.getSqe();
+    }
+    return sqe;
+}
+
+bool UringNetworkManager::armAccept() {
+    auto* sqe = nextSqe();
+    if (!sqe) {
+        return false;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = getServerSocket();
+    sqe->accept_flags = SOCK_CLOEXEC | SOCK_NONBLOCK;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = makeUserData(ACCEPT_TAG, getServerSocket());
+    return true;
+}
+
+bool UringNetworkManager::armRecv(const int client_socket) {
+    auto* sqe = nextSqe();
+    if (!sqe) {
+        return false;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = client_socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = makeUserData(RECV_TAG, client_socket);
+    return true;
+}
+
+bool UringNetworkManager::serveConnections(ConnectionHandler& handler, const std::atomic<bool>& keep_running) {
+    if (!armAccept()) {
+        LOG_ERROR("[Message Server] Failed to accept connections with io_uring");
+        return true;
+    }
+
+    while (keep_running) {
+        // Also submits what the completions handled last time armed
+        if (const auto ec = ring_.submit(1, &WAIT_TIMEOUT);
+            ec && ec != std::errc::interrupted && ec != std::errc::stream_timeout) {
+            LOG_ERROR("[Message Server] {}", ec.message());
+            break;
+        }
+        while (const auto* cqe = ring_.peekCqe()) {
+            const auto completion = *cqe;
+            ring_.seenCqe();
+            handleCompletion(completion, handler);
+        }
+    }
+
+    return true;
+}
+
+void UringNetworkManager::handleCompletion(const io_uring_cqe& cqe, ConnectionHandler& handler) {
+    const auto tag = static_cast<OperationTag>(cqe.user_data >> 32);
+    const auto more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+    if (tag == ACCEPT_TAG) {
+        if (cqe.res >= 0) {
+            // A command is answered with an acceptance line and then its outcome, see TcpNetworkManager
+            constexpr int no_delay = 1;
+            setsockopt(cqe.res, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+            handler.onConnect(cqe.res);
+            if (!armRecv(cqe.res)) {
+                LOG_ERROR("[Message Server] Failed to receive from client {}", cqe.res);
+                handler.onDisconnect(cqe.res);
+            }
+        } else {
+            LOG_DEBUG("[Message Server] Accepting failed: {}", std::error_code(-cqe.res, std::generic_category()).message());
+        }
+        // Ends when the listening socket was closed
+        if (!more && getServerSocket() >= 0 && !armAccept()) {
+            LOG_ERROR("[Message Server] Failed to accept connections with io_uring");
+        }
+        return;
+    }
+
+    const auto client_socket = static_cast<int>(cqe.user_data & UINT32_MAX);
+    if (cqe.res > 0) {
+        const auto buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        handler.onData(client_socket, std::string_view(buffers_.data() + buffer_id * BUFFER_SIZE,
+                                                       static_cast<size_t>(cqe.res)));
+        provideBuffer(buffer_id);
+    }
+    if (more) {
+        return;
+    }
+
+    // The recv stops when the connection is closed, fails, or found no free buffer. The buffers are back by now.
+    if ((cqe.res > 0 || cqe.res == -ENOBUFS) && armRecv(client_socket)) {
+        return;
+    }
+    if (cqe.res < 0 && cqe.res != -ECONNRESET) {
+        LOG_ERROR("[Message Server] Reading from client {} failed: {}", client_socket,
+                  std::error_code(-cqe.res, std::generic_category()).message());
+    }
+    handler.onDisconnect(client_socket);
+}
+
+uint64_t UringNetworkManager::getIoSyscallCount() const {
+    return TcpNetworkManager::getIoSyscallCount() + ring_.getSyscallCount();
+}
@@ -0,0 +1,39 @@
+#ifndef PERIPHERY_MANAGER_URINGNETWORKMANAGER_H
+#define PERIPHERY_MANAGER_URINGNETWORKMANAGER_H
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "Network/IoUring.h"
+#include "Network/TcpNetworkManager.h"
+
+// TCP server driven by a single io_uring completion loop. The listening socket has a multishot accept and every
+// connection a multishot recv that picks its buffer from a registered buffer ring, so receiving a message needs no
+// submission of its own. Arms queued while handling completions go to the kernel with the io_uring_enter waiting for
+// the next ones, and one call reaps the completions of every connection. Responses are written by the responding
+// thread with the gathered write of TcpNetworkManager, which keeps them ordered per connection without copying.
+class UringNetworkManager : public TcpNetworkManager {
+public:
+    explicit UringNetworkManager(const int port);
+    ~UringNetworkManager() override;
+    static bool isSupported();
+    std::error_code init() override;
+    bool serveConnections(ConnectionHandler& handler, const std::atomic<bool>& keep_running) override;
+    uint64_t getIoSyscallCount() const override;
+
+private:
+    using BufferRing = std::unique_ptr<io_uring_buf_ring, decltype(&std::free)>;
+    static BufferRing allocateBufferRing();
+    io_uring_sqe* nextSqe();
+    bool armAccept();
+    bool armRecv(int client_socket);
+    void provideBuffer(uint16_t buffer_id);
+    void handleCompletion(const io_uring_cqe& cqe, ConnectionHandler& handler);
+    // The ring goes first, it may still hand out the buffers
+    BufferRing buffer_ring_;
+    std::vector<char> buffers_;
+    uint16_t buffer_ring_tail_{0};
+    IoUring ring_;
+};
+
+#endif //PERIPHERY_MANAGER_URINGNETWORKMANAGER_H
@@ -0,0 +1,413 @@
+#include "FrameExport.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Logger/Logger.h"
+#include "Network/UnixNetworkManager.h"
+
+namespace {
+const std::string EXPORT_ELEMENT {"frame-export"};
+const std::string SOCKET_PROPERTY {"socket"};
+const std::string SLOTS_PROPERTY {"slots"};
+const std::string SLOT_SIZE_PROPERTY {"slot-size"};
+constexpr unsigned int DEFAULT_SLOTS {4};
+constexpr int LISTEN_RETRY_MS {500};
+
+void signalEventFd(const int event_fd) {
+    constexpr uint64_t ONE {1};
+    // A full counter means the consumer did not look for a long while, it reads every pending frame anyway
+    if (::write(event_fd, &ONE, sizeof(ONE)) < 0 && errno != EAGAIN) {
+        LOG_TRACE("Failed to signal frame export consumer: {}", strerror(errno));
+    }
+}
+}
+
+bool FrameExport::isExportElement(const std::string& element_name) {
+    return element_name == EXPORT_ELEMENT;
+}
+
+bool FrameExport::isExportProperty(const std::string& key) {
+    return key == SOCKET_PROPERTY || key == SLOTS_PROPERTY || key == SLOT_SIZE_PROPERTY;
+}
+
+std::error_code FrameExport::attach(const std::map<std::string, std::string>& properties, GstElement* sink) {
+    const auto socket_property = properties.find(SOCKET_PROPERTY);
+    if (socket_property == properties.end() || socket_property->second.empty()) {
+        LOG_ERROR("Element {} has no {} property", EXPORT_ELEMENT, SOCKET_PROPERTY);
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    auto slot_count = DEFAULT_SLOTS;
+    size_t slot_size = 0;
+    try {
+        if (const auto slots_property = properties.find(SLOTS_PROPERTY); slots_property != properties.end()) {
+            slot_count = std::stoul(slots_property->second);
+        }
+        if (const auto size_property = properties.find(SLOT_SIZE_PROPERTY); size_property != properties.end()) {
+            slot_size = std::stoull(size_property->second);
+        }
+    } catch (const std::exception&) {
+        LOG_ERROR("Invalid {} or {} property of {}", SLOTS_PROPERTY, SLOT_SIZE_PROPERTY, GST_ELEMENT_NAME(sink));
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    if (slot_count < 2) {
+        LOG_ERROR("{} needs at least 2 slots", GST_ELEMENT_NAME(sink));
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    // Exporting must never hold the pipeline back
+    g_object_set(sink, "sync", FALSE, "async", FALSE, "enable-last-sample", FALSE, nullptr);
+
+    // Owned by the probe, destroyed along with the element
+    const auto frame_export = new FrameExport(socket_property->second, slot_count, slot_size);
+    const auto pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(pad, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                      handleProbe, frame_export, [](gpointer data) { delete static_cast<FrameExport*>(data); });
+    gst_object_unref(pad);
+    LOG_INFO("Frame export {}: {} exports {} slots", socket_property->second, GST_ELEMENT_NAME(sink), slot_count);
+    return {};
+}
+
+FrameExport::EventFd::~EventFd() {
+    close(fd);
+}
+
+FrameExport::FrameExport(std::string socket_name, const unsigned int slot_count, const size_t slot_size)
+    : socket_name_(std::move(socket_name)), slot_count_(slot_count), slot_size_(slot_size),
+      stop_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), event_fds_(std::make_shared<const EventFds>()) {
+    server_thread_ = std::thread(&FrameExport::serve, this);
+}
+
+FrameExport::~FrameExport() {
+    stopping_ = true;
+    signalEventFd(stop_fd_);
+    if (server_thread_.joinable()) {
+        server_thread_.join();
+    }
+    if (ring_) {
+        munmap(ring_, ring_size_);
+    }
+    if (memfd_ >= 0) {
+        close(memfd_);
+    }
+    if (stop_fd_ >= 0) {
+        close(stop_fd_);
+    }
+    if (socket_name_.front() != '@') {
+        unlink(socket_name_.c_str());
+    }
+    LOG_INFO("Frame export {}: closed after {} frames", socket_name_, sequence_.load());
+}
+
+GstPadProbeReturn FrameExport::handleProbe(GstPad*, GstPadProbeInfo* info, gpointer data) {
+    const auto frame_export = static_cast<FrameExport*>(data);
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        frame_export->write(GST_PAD_PROBE_INFO_BUFFER(info));
+    } else if (const auto event = GST_PAD_PROBE_INFO_EVENT(info); GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+        GstCaps* caps;
+        gst_event_parse_caps(event, &caps);
+        frame_export->setCaps(caps);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// Runs on the streaming thread for every buffer
+void FrameExport::write(GstBuffer* buffer) {
+    const auto size = gst_buffer_get_size(buffer);
+    if (!ring_ && !ring_failed_) {
+        if (auto ec = createRing(size)) {
+            LOG_ERROR("Frame export {}: failed to create the ring: {}", socket_name_, ec.message());
+            ring_failed_ = true;
+        }
+    }
+    if (!ring_) {
+        return;
+    }
+    if (size > slot_capacity_) {
+        if (!oversized_logged_) {
+            LOG_WARN("Frame export {}: dropping frames of {} bytes, slots hold {} bytes", socket_name_, size,
+                     slot_capacity_);
+            oversized_logged_ = true;
+        }
+        return;
+    }
+
+    const auto sequence = sequence_.load(std::memory_order_relaxed) + 1;
+    const auto slot_address = reinterpret_cast<char*>(ring_) + slot_offset_ + sequence % slot_count_ * slot_stride_;
+    const auto slot = reinterpret_cast<FrameSlotHeader*>(slot_address);
+    // Readers of the previous frame of the slot see it change while it is overwritten
+    slot->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    // GST_CLOCK_TIME_NONE is FRAME_RING_NO_TIME
+    slot->pts = GST_BUFFER_PTS(buffer);
+    slot->dts = GST_BUFFER_DTS(buffer);
+    slot->duration = GST_BUFFER_DURATION(buffer);
+    slot->size = size;
+    slot->caps_sequence = caps_sequence_;
+    slot->flags = GST_BUFFER_FLAGS(buffer);
+    gst_buffer_extract(buffer, 0, slot_address + FRAME_SLOT_DATA_OFFSET, size);
+    slot->sequence.store(sequence, std::memory_order_release);
+    ring_->write_sequence.store(sequence, std::memory_order_release);
+    sequence_.store(sequence, std::memory_order_release);
+
+    std::shared_ptr<const EventFds> event_fds;
+    {
+        std::lock_guard lock(event_fds_mutex_);
+        event_fds = event_fds_;
+    }
+    for (const auto& event_fd: *event_fds) {
+        signalEventFd(event_fd->fd);
+    }
+}
+
+void FrameExport::setCaps(const GstCaps* caps) {
+    const auto caps_string = gst_caps_to_string(caps);
+    caps_ = caps_string;
+    g_free(caps_string);
+    writeCaps();
+}
+
+std::error_code FrameExport::createRing(const size_t frame_size) {
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto alignPage = [page_size](const size_t size) { return (size + page_size - 1) / page_size * page_size; };
+    const auto slot_capacity = std::max<size_t>(slot_size_ ? slot_size_ : frame_size, 1);
+    const auto slot_offset = alignPage(sizeof(FrameRingHeader));
+    const auto slot_stride = alignPage(FRAME_SLOT_DATA_OFFSET + slot_capacity);
+    const auto ring_size = slot_offset + slot_stride * slot_count_;
+
+    memfd_ = memfd_create(("frame-export:" + socket_name_).c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd_ < 0) {
+        return {errno, std::generic_category()};
+    }
+    // Consumers may rely on the size, it is sealed once set
+    if (ftruncate(memfd_, static_cast<off_t>(ring_size)) < 0 ||
+        fcntl(memfd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        return {errno, std::generic_category()};
+    }
+    const auto address = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd_, 0);
+    if (address == MAP_FAILED) {
+        return {errno, std::generic_category()};
+    }
+
+    // The memfd is zero filled, sequences and cursors start at 0
+    const auto ring = static_cast<FrameRingHeader*>(address);
+    std::memcpy(ring->magic, FRAME_RING_MAGIC, sizeof(FRAME_RING_MAGIC));
+    ring->version = FRAME_RING_VERSION;
+    ring->slot_count = slot_count_;
+    ring->slot_offset = slot_offset;
+    ring->slot_stride = slot_stride;
+    ring->slot_capacity = slot_capacity;
+    ring_ = ring;
+    ring_size_ = ring_size;
+    slot_offset_ = slot_offset;
+    slot_stride_ = slot_stride;
+    slot_capacity_ = slot_capacity;
+    writeCaps();
+
+    ring_ready_ = true;
+    signalEventFd(stop_fd_);
+    LOG_INFO("Frame export {}: ring of {} slots of {} bytes, {} MB", socket_name_, slot_count_, slot_capacity,
+             ring_size >> 20);
+    return {};
+}
+
+void FrameExport::writeCaps() {
+    if (!ring_) {
+        return;
+    }
+    if (caps_.size() >= FRAME_RING_MAX_CAPS_SIZE) {
+        LOG_WARN("Frame export {}: caps truncated to {} bytes", socket_name_, FRAME_RING_MAX_CAPS_SIZE - 1);
+    }
+    ring_->caps_sequence.store(caps_sequence_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    const auto size = std::min(caps_.size(), FRAME_RING_MAX_CAPS_SIZE - 1);
+    std::memcpy(ring_->caps, caps_.data(), size);
+    ring_->caps[size] = '\0';
+    caps_sequence_ += 2;
+    ring_->caps_sequence.store(caps_sequence_, std::memory_order_release);
+}
+
+// Accepts consumers once the ring exists and notices the ones hanging up, consumers never send anything
+void FrameExport::serve() {
+    auto server_socket = -1;
+    auto listen_failure_logged = false;
+    while (!stopping_) {
+        if (server_socket < 0) {
+            server_socket = listen();
+            if (server_socket < 0 && !listen_failure_logged) {
+                LOG_ERROR("Frame export {}: failed to listen: {}, retrying", socket_name_, strerror(errno));
+                listen_failure_logged = true;
+            }
+        }
+
+        const auto accepting = server_socket >= 0 && ring_ready_;
+        std::vector<pollfd> poll_fds{{stop_fd_, POLLIN, 0}};
+        if (accepting) {
+            poll_fds.push_back({server_socket, POLLIN, 0});
+        }
+        const auto first_consumer = poll_fds.size();
+        for (const auto& consumer: consumers_) {
+            poll_fds.push_back({consumer.socket, POLLIN, 0});
+        }
+
+        if (poll(poll_fds.data(), poll_fds.size(), server_socket < 0 ? LISTEN_RETRY_MS : -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Frame export {}: poll failed: {}", socket_name_, strerror(errno));
+            break;
+        }
+        if (poll_fds[0].revents & POLLIN) {
+            uint64_t value;
+            while (read(stop_fd_, &value, sizeof(value)) > 0) {}
+        }
+
+        std::vector<Consumer> gone;
+        for (auto i = first_consumer; i < poll_fds.size(); ++i) {
+            if (!poll_fds[i].revents) {
+                continue;
+            }
+            char byte;
+            if (const auto received = recv(poll_fds[i].fd, &byte, sizeof(byte), MSG_DONTWAIT);
+                received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) {
+                gone.push_back(consumers_[i - first_consumer]);
+            }
+        }
+        for (const auto& consumer: gone) {
+            releaseConsumer(consumer);
+        }
+        if (accepting && poll_fds[1].revents & POLLIN) {
+            acceptConsumer(server_socket);
+        }
+    }
+
+    const auto consumers = consumers_;
+    for (const auto& consumer: consumers) {
+        releaseConsumer(consumer);
+    }
+    if (server_socket >= 0) {
+        close(server_socket);
+    }
+}
+
+int FrameExport::listen() const {
+    sockaddr_un address{};
+    const auto address_size = UnixNetworkManager::makeAddress(socket_name_, address);
+    if (!address_size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    const auto server_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server_socket < 0) {
+        return -1;
+    }
+    if (socket_name_.front() != '@') {
+        unlink(socket_name_.c_str());
+    }
+    if (bind(server_socket, reinterpret_cast<sockaddr*>(&address), address_size) < 0 ||
+        ::listen(server_socket, FRAME_RING_MAX_CONSUMERS) < 0) {
+        const auto error = errno;
+        close(server_socket);
+        errno = error;
+        return -1;
+    }
+    LOG_INFO("Frame export {}: serving consumers", socket_name_);
+    return server_socket;
+}
+
+void FrameExport::acceptConsumer(const int server_socket) {
+    const auto consumer_socket = accept4(server_socket, nullptr, nullptr, SOCK_CLOEXEC);
+    if (consumer_socket < 0) {
+        LOG_WARN("Frame export {}: failed to accept a consumer: {}", socket_name_, strerror(errno));
+        return;
+    }
+
+    FrameRingHandshake handshake{};
+    std::memcpy(handshake.magic, FRAME_RING_MAGIC, sizeof(FRAME_RING_MAGIC));
+    handshake.version = FRAME_RING_VERSION;
+    handshake.consumer_index = FRAME_RING_NO_CONSUMER;
+    handshake.ring_size = ring_size_;
+    iovec data{&handshake, sizeof(handshake)};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+
+    // First cursor no connected consumer uses
+    uint32_t index = 0;
+    while (index < FRAME_RING_MAX_CONSUMERS && std::any_of(consumers_.begin(), consumers_.end(), [index](const auto& consumer) {
+        return consumer.index == index;
+    })) {
+        ++index;
+    }
+    if (index == FRAME_RING_MAX_CONSUMERS) {
+        LOG_WARN("Frame export {}: refusing a consumer, {} are connected", socket_name_, FRAME_RING_MAX_CONSUMERS);
+        sendmsg(consumer_socket, &message, MSG_NOSIGNAL);
+        close(consumer_socket);
+        return;
+    }
+
+    const auto event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event_fd < 0) {
+        LOG_WARN("Frame export {}: failed to create a consumer eventfd: {}", socket_name_, strerror(errno));
+        close(consumer_socket);
+        return;
+    }
+    // Starts with the next frame
+    auto& cursor = ring_->cursors[index];
+    cursor.read_sequence.store(sequence_.load(std::memory_order_acquire) + 1, std::memory_order_relaxed);
+    cursor.dropped.store(0, std::memory_order_relaxed);
+    cursor.active.store(1, std::memory_order_release);
+
+    handshake.consumer_index = index;
+    const int fds[] {memfd_, event_fd};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    const auto control_message = CMSG_FIRSTHDR(&message);
+    control_message->cmsg_level = SOL_SOCKET;
+    control_message->cmsg_type = SCM_RIGHTS;
+    control_message->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(control_message), fds, sizeof(fds));
+    if (sendmsg(consumer_socket, &message, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(handshake))) {
+        LOG_WARN("Frame export {}: handshake with a consumer failed: {}", socket_name_, strerror(errno));
+        cursor.active.store(0, std::memory_order_release);
+        close(event_fd);
+        close(consumer_socket);
+        return;
+    }
+
+    consumers_.push_back({consumer_socket, std::make_shared<const EventFd>(event_fd), index});
+    publishEventFds();
+    LOG_INFO("Frame export {}: consumer {} connected, {} connected", socket_name_, index, consumers_.size());
+}
+
+void FrameExport::releaseConsumer(const Consumer& consumer) {
+    auto& cursor = ring_->cursors[consumer.index];
+    cursor.active.store(0, std::memory_order_release);
+    const auto next_sequence = sequence_.load(std::memory_order_acquire) + 1;
+    const auto read_sequence = std::min(cursor.read_sequence.load(std::memory_order_acquire), next_sequence);
+    LOG_INFO("Frame export {}: consumer {} left {} frames behind, {} frames dropped", socket_name_, consumer.index,
+             next_sequence - read_sequence, cursor.dropped.load(std::memory_order_relaxed));
+    close(consumer.socket);
+    consumers_.erase(std::remove_if(consumers_.begin(), consumers_.end(), [&consumer](const auto& connected) {
+        return connected.index == consumer.index;
+    }), consumers_.end());
+    // The eventfd is closed once the streaming thread no longer signals it
+    publishEventFds();
+}
+
+void FrameExport::publishEventFds() {
+    auto event_fds = std::make_shared<EventFds>();
+    for (const auto& consumer: consumers_) {
+        event_fds->push_back(consumer.event_fd);
+    }
+    std::lock_guard lock(event_fds_mutex_);
+    event_fds_ = std::move(event_fds);
+}
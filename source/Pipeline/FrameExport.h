@@ -0,0 +1,88 @@
+#ifndef FRAMEEXPORT_H
+#define FRAMEEXPORT_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <gst/gst.h>
+#include "Pipeline/FrameRingFormat.h"
+
+// Publishes the raw frames reaching a "frame-export" element, a fakesink whose sink pad is probed, into a memfd ring
+// shared with local processes (see FrameRingFormat.h). A frame is copied once into the ring whatever the number of
+// consumers, which read it in place. This is the single copy shmsink makes too: ALLOCATION queries are not answered,
+// so upstream buffers never live in the ring. The ring is created with the first frame, sized by the "slot-size"
+// property or by that frame, and holds "slots" frames. Consumers are served on the unix socket named by the "socket"
+// property, '@' selecting the abstract namespace. The export lives as long as its element, so disabling the optional
+// branch holding it closes the socket and the consumers see it hang up.
+class FrameExport {
+public:
+    static bool isExportElement(const std::string& element_name);
+    static bool isExportProperty(const std::string& key);
+    static std::error_code attach(const std::map<std::string, std::string>& properties, GstElement* sink);
+
+    FrameExport(std::string socket_name, unsigned int slot_count, size_t slot_size);
+    ~FrameExport();
+    FrameExport(const FrameExport&) = delete;
+    FrameExport& operator=(const FrameExport&) = delete;
+
+private:
+    struct EventFd {
+        explicit EventFd(const int fd) : fd(fd) {}
+        ~EventFd();
+        EventFd(const EventFd&) = delete;
+        EventFd& operator=(const EventFd&) = delete;
+        const int fd;
+    };
+    struct Consumer {
+        int socket{-1};
+        std::shared_ptr<const EventFd> event_fd;
+        uint32_t index{0};
+    };
+    using EventFds = std::vector<std::shared_ptr<const EventFd>>;
+    static GstPadProbeReturn handleProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+    // Streaming thread
+    void write(GstBuffer* buffer);
+    void setCaps(const GstCaps* caps);
+    std::error_code createRing(size_t frame_size);
+    void writeCaps();
+    // Server thread
+    void serve();
+    int listen() const;
+    void acceptConsumer(int server_socket);
+    void releaseConsumer(const Consumer& consumer);
+    void publishEventFds();
+
+    const std::string socket_name_;
+    const unsigned int slot_count_;
+    const size_t slot_size_;
+    int stop_fd_{-1}; // eventfd waking the server thread up, to accept consumers once the ring exists or to stop
+    std::thread server_thread_;
+    std::atomic<bool> stopping_{false};
+
+    // Written by the streaming thread before the ring is published through ring_ready_. Consumers map the ring
+    // writable for their cursors, so the layout and the caps sequence are never read back from its header.
+    int memfd_{-1};
+    size_t ring_size_{0};
+    FrameRingHeader* ring_{nullptr};
+    size_t slot_offset_{0};
+    size_t slot_stride_{0};
+    size_t slot_capacity_{0};
+    uint64_t caps_sequence_{0};
+    std::atomic<bool> ring_ready_{false};
+    // Last frame written, read by the server thread to place the cursor of a consumer
+    std::atomic<uint64_t> sequence_{0};
+    std::string caps_;
+    bool ring_failed_{false};
+    bool oversized_logged_{false};
+
+    std::vector<Consumer> consumers_; // Server thread only
+    mutable std::mutex event_fds_mutex_;
+    std::shared_ptr<const EventFds> event_fds_; // Replaced as a whole, the streaming thread signals a snapshot
+};
+
+#endif //FRAMEEXPORT_H
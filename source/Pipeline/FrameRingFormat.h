@@ -0,0 +1,68 @@
+#ifndef FRAMERINGFORMAT_H
+#define FRAMERINGFORMAT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the shared memory ring a frame-export element publishes raw frames into. The ring is a sealed memfd
+// starting with a FrameRingHeader followed by slot_count slots of slot_stride bytes, frame n is written into slot
+// n % slot_count. Each slot starts with a FrameSlotHeader, the frame data follows at FRAME_SLOT_DATA_OFFSET.
+//
+// A consumer connects to the unix socket of the element and receives a FrameRingHandshake along with two file
+// descriptors: the memfd, to be mapped read-write as a whole, and an eventfd signalled after every frame. The
+// producer never waits for consumers, the oldest frame is overwritten once the ring is full. Consumers keep their own
+// read cursor: a frame is valid when the slot sequence equals the expected sequence before and after it was read,
+// anything else means it was overwritten. A consumer a full ring behind best resumes from the newest frame, the oldest
+// ones are the next to be overwritten. A consumer publishes its cursor and drop count in its FrameRingCursor.
+
+constexpr char FRAME_RING_MAGIC[8] = {'G', 'P', 'L', 'F', 'R', 'A', 'M', 'E'};
+constexpr uint32_t FRAME_RING_VERSION {1};
+constexpr uint32_t FRAME_RING_MAX_CONSUMERS {16};
+constexpr uint32_t FRAME_RING_NO_CONSUMER {UINT32_MAX}; // Handshake of a refused consumer, no descriptors are passed
+constexpr size_t FRAME_RING_MAX_CAPS_SIZE {2048};
+constexpr size_t FRAME_SLOT_DATA_OFFSET {64};
+constexpr uint64_t FRAME_RING_NO_TIME {UINT64_MAX};
+
+struct FrameRingCursor {
+    std::atomic<uint64_t> read_sequence; // Next frame the consumer reads, written by the consumer
+    std::atomic<uint64_t> dropped;       // Frames overwritten before they were read, written by the consumer
+    std::atomic<uint32_t> active;        // Written by the producer
+    uint32_t reserved;
+};
+
+struct FrameRingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint64_t slot_offset;   // Offset of the first slot, page aligned
+    uint64_t slot_stride;   // Distance between slots, page aligned
+    uint64_t slot_capacity; // Largest frame a slot holds
+    std::atomic<uint64_t> write_sequence; // Last complete frame, frames are numbered from 1
+    std::atomic<uint64_t> caps_sequence;  // Odd while the caps are written
+    char caps[FRAME_RING_MAX_CAPS_SIZE];  // Caps of the frames as a null terminated string
+    FrameRingCursor cursors[FRAME_RING_MAX_CONSUMERS];
+};
+
+struct FrameSlotHeader {
+    std::atomic<uint64_t> sequence; // Frame held by the slot, 0 while it is written
+    uint64_t pts;                   // FRAME_RING_NO_TIME when the buffer had none
+    uint64_t dts;
+    uint64_t duration;
+    uint64_t size;
+    uint64_t caps_sequence; // caps_sequence of the caps the frame was produced with
+    uint32_t flags;         // GstBufferFlags
+    uint32_t reserved;
+};
+
+struct FrameRingHandshake {
+    char magic[8];
+    uint32_t version;
+    uint32_t consumer_index; // Cursor of the consumer in the header
+    uint64_t ring_size;      // Size of the memfd
+};
+
+static_assert(sizeof(FrameSlotHeader) <= FRAME_SLOT_DATA_OFFSET, "Slot header overlaps the frame data");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring sequences must be lock free to be shared");
+
+#endif //FRAMERINGFORMAT_H
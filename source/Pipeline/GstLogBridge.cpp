@@ -0,0 +1,149 @@
+#include "GstLogBridge.h"
+#include <array>
+#include <atomic>
+#include <functional>
+#include <string_view>
+
+namespace {
+// Message budget of the call sites hashing to the slot. The last call site that had a message suppressed is kept
+// so the summary can name it.
+struct CallSiteBudget {
+    std::atomic<uint64_t> window {0};
+    std::atomic<size_t> count {0};
+    std::atomic<size_t> suppressed {0};
+    std::atomic<size_t> last_message {0};
+    std::atomic<GstDebugCategory*> category {nullptr};
+    std::atomic<LoggerInterface::LogLevel> level {LoggerInterface::LogLevel::Info};
+    std::atomic<const gchar*> file {nullptr};
+    std::atomic<const gchar*> function {nullptr};
+    std::atomic<gint> line {0};
+};
+
+constexpr size_t CALL_SITE_SLOTS {1024};
+std::array<CallSiteBudget, CALL_SITE_SLOTS> call_site_budgets;
+}
+
+void GstLogBridge::install() {
+    gst_debug_add_log_function(handleLogMessage, nullptr, nullptr);
+    gst_debug_remove_log_function(gst_debug_log_default);
+    g_timeout_add_seconds(static_cast<guint>(WINDOW.count()), flushSuppressed, nullptr);
+}
+
+void GstLogBridge::setThresholds(const std::string& thresholds) {
+    if (thresholds.empty()) {
+        return;
+    }
+
+    gst_debug_set_threshold_from_string(thresholds.c_str(), TRUE);
+    LOG_INFO("GStreamer debug thresholds set to '{}'", thresholds);
+}
+
+bool GstLogBridge::toLogLevel(const GstDebugLevel gst_level, LoggerInterface::LogLevel& level) {
+    switch (gst_level) {
+        case GST_LEVEL_ERROR:
+            level = LoggerInterface::LogLevel::Error;
+            return true;
+        case GST_LEVEL_WARNING:
+            level = LoggerInterface::LogLevel::Warn;
+            return true;
+        case GST_LEVEL_FIXME:
+        case GST_LEVEL_INFO:
+            level = LoggerInterface::LogLevel::Info;
+            return true;
+        case GST_LEVEL_DEBUG:
+            level = LoggerInterface::LogLevel::Debug;
+            return true;
+        case GST_LEVEL_LOG:
+        case GST_LEVEL_TRACE:
+            level = LoggerInterface::LogLevel::Trace;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Called from streaming threads for every message, so the budget is kept in lock-free slots. Call sites
+// sharing a slot share its budget.
+bool GstLogBridge::admitMessage(GstDebugCategory* category, const LoggerInterface::LogLevel level, const gchar* file,
+                                const gchar* function, const gint line, const size_t message_hash, size_t& suppressed) {
+    const auto hash = std::hash<const void*>{}(file) ^ (static_cast<size_t>(line) * 0x9e3779b97f4a7c15ULL);
+    auto& budget = call_site_budgets[hash % CALL_SITE_SLOTS];
+
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    const auto current_window = static_cast<uint64_t>(now / WINDOW) + 1;
+    auto window = budget.window.load(std::memory_order_relaxed);
+    suppressed = 0;
+    if (window != current_window && budget.window.compare_exchange_strong(window, current_window)) {
+        suppressed = budget.suppressed.exchange(0);
+        budget.count.store(0);
+    }
+
+    if (budget.last_message.exchange(message_hash, std::memory_order_relaxed) == message_hash ||
+        budget.count.fetch_add(1, std::memory_order_relaxed) >= MESSAGES_PER_WINDOW) {
+        budget.category.store(category, std::memory_order_relaxed);
+        budget.level.store(level, std::memory_order_relaxed);
+        budget.file.store(file, std::memory_order_relaxed);
+        budget.function.store(function, std::memory_order_relaxed);
+        budget.line.store(line, std::memory_order_relaxed);
+        budget.suppressed.fetch_add(1, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+// Main loop timer, reports the messages suppressed since the last message or flush of their call site
+gboolean GstLogBridge::flushSuppressed(gpointer) {
+    for (auto& budget: call_site_budgets) {
+        if (budget.suppressed.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        if (const auto suppressed = budget.suppressed.exchange(0, std::memory_order_acquire)) {
+            Logger::getInstance().log(budget.level.load(std::memory_order_relaxed),
+                                      FMT_STRING("[{}] [{}()] suppressed {} similar messages from {}:{}"),
+                                      gst_debug_category_get_name(budget.category.load(std::memory_order_relaxed)),
+                                      budget.function.load(std::memory_order_relaxed), suppressed,
+                                      budget.file.load(std::memory_order_relaxed),
+                                      budget.line.load(std::memory_order_relaxed));
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+void GstLogBridge::handleLogMessage(GstDebugCategory* category, const GstDebugLevel gst_level, const gchar* file,
+                                    const gchar* function, const gint line, GObject* object, GstDebugMessage* message,
+                                    gpointer) {
+    LoggerInterface::LogLevel level;
+    if (!toLogLevel(gst_level, level) || static_cast<int>(level) < LOG_ACTIVE_LEVEL ||
+        !Logger::getInstance().isEnabled(level)) {
+        return;
+    }
+
+    // Identical text from another object is a different message
+    const auto text = gst_debug_message_get(message);
+    const auto message_hash = std::hash<std::string_view>{}(text ? text : "") ^ std::hash<const void*>{}(object);
+    size_t suppressed;
+    const auto admitted = admitMessage(category, level, file, function, line, message_hash, suppressed);
+    const auto category_name = gst_debug_category_get_name(category);
+    if (suppressed != 0) {
+        Logger::getInstance().log(level, FMT_STRING("[{}] [{}()] suppressed {} similar messages from {}:{}"),
+                                  category_name, function, suppressed, file, line);
+    }
+    if (!admitted) {
+        return;
+    }
+
+    const gchar* parent_name = "";
+    const gchar* separator = "";
+    const gchar* object_name = "";
+    if (object && GST_IS_OBJECT(object)) {
+        object_name = GST_OBJECT_NAME(object);
+        if (GST_IS_PAD(object)) {
+            const auto parent = GST_OBJECT_PARENT(object);
+            parent_name = parent && GST_OBJECT_NAME(parent) ? GST_OBJECT_NAME(parent) : "unknown";
+            separator = ":";
+        }
+    }
+
+    Logger::getInstance().log(level, FMT_STRING("[{}] [{}()<{}{}{}>] {}"), category_name, function, parent_name,
+                              separator, object_name ? object_name : "", text ? text : "");
+}
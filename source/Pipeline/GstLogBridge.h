@@ -0,0 +1,34 @@
+#ifndef PERIPHERY_MANAGER_GSTLOGBRIDGE_H
+#define PERIPHERY_MANAGER_GSTLOGBRIDGE_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <gst/gst.h>
+#include "Logger/Logger.h"
+
+// Routes GStreamer debug messages into the Logger. GStreamer drops messages above the category
+// threshold before formatting them, the bridge also drops levels the Logger would discard before
+// the message text is built. A message repeating the previous one of its call site and object is
+// dropped, and each call site may log MESSAGES_PER_WINDOW messages per WINDOW. Dropped messages are
+// counted and reported as "suppressed N" with the next message from that call site, or every WINDOW
+// from the main loop when the call site went quiet.
+class GstLogBridge {
+public:
+    static constexpr size_t MESSAGES_PER_WINDOW {20};
+    static constexpr std::chrono::seconds WINDOW {1};
+
+    static void install();
+    // Thresholds in GST_DEBUG syntax, e.g. "2,GST_CAPS:4,nvmsgconv:5"
+    static void setThresholds(const std::string& thresholds);
+
+private:
+    static void handleLogMessage(GstDebugCategory* category, GstDebugLevel level, const gchar* file, const gchar* function,
+                                 gint line, GObject* object, GstDebugMessage* message, gpointer user_data);
+    static bool toLogLevel(GstDebugLevel gst_level, LoggerInterface::LogLevel& level);
+    static bool admitMessage(GstDebugCategory* category, LoggerInterface::LogLevel level, const gchar* file,
+                             const gchar* function, gint line, size_t message_hash, size_t& suppressed);
+    static gboolean flushSuppressed(gpointer);
+};
+
+#endif //PERIPHERY_MANAGER_GSTLOGBRIDGE_H
@@ -0,0 +1,221 @@
+#include "PipelineChannel.h"
+#include <algorithm>
+#include "Logger/Logger.h"
+#include "Pipeline/FrameExport.h"
+
+namespace {
+const std::string PRODUCER_ELEMENT {"channel-out"};
+const std::string CONSUMER_ELEMENT {"channel-in"};
+const std::string PRODUCER_FACTORY {"fakesink"};
+const std::string CONSUMER_FACTORY {"appsrc"};
+const std::string CHANNEL_PROPERTY {"channel"};
+const std::string POLICY_PROPERTY {"policy"};
+
+// Never destroyed, producer probes may still run on streaming threads while the process exits
+std::mutex& getChannelsMutex() {
+    static auto* mutex = new std::mutex;
+    return *mutex;
+}
+
+std::map<std::string, std::shared_ptr<PipelineChannel>>& getChannels() {
+    static auto* channels = new std::map<std::string, std::shared_ptr<PipelineChannel>>;
+    return *channels;
+}
+}
+
+std::shared_ptr<PipelineChannel> PipelineChannel::get(const std::string& name) {
+    std::lock_guard lock(getChannelsMutex());
+    auto& channel = getChannels()[name];
+    if (!channel) {
+        channel = std::make_shared<PipelineChannel>(name);
+    }
+    return channel;
+}
+
+bool PipelineChannel::isChannelElement(const std::string& element_name) {
+    return element_name == PRODUCER_ELEMENT || element_name == CONSUMER_ELEMENT || FrameExport::isExportElement(element_name);
+}
+
+std::string PipelineChannel::getFactoryName(const std::string& element_name) {
+    if (element_name == PRODUCER_ELEMENT || FrameExport::isExportElement(element_name)) {
+        return PRODUCER_FACTORY;
+    }
+    if (element_name == CONSUMER_ELEMENT) {
+        return CONSUMER_FACTORY;
+    }
+    return element_name;
+}
+
+bool PipelineChannel::isChannelProperty(const std::string& element_name, const std::string& key) {
+    if (FrameExport::isExportElement(element_name)) {
+        return FrameExport::isExportProperty(key);
+    }
+    return isChannelElement(element_name) && (key == CHANNEL_PROPERTY || key == POLICY_PROPERTY);
+}
+
+std::error_code PipelineChannel::attach(const std::string& element_name, const std::map<std::string, std::string>& properties,
+                                        GstElement* gst_element) {
+    if (!isChannelElement(element_name)) {
+        return {};
+    }
+    if (FrameExport::isExportElement(element_name)) {
+        return FrameExport::attach(properties, gst_element);
+    }
+
+    const auto channel_property = properties.find(CHANNEL_PROPERTY);
+    if (channel_property == properties.end() || channel_property->second.empty()) {
+        LOG_ERROR("Element {} has no {} property", element_name, CHANNEL_PROPERTY);
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    const auto channel = get(channel_property->second);
+    if (element_name == PRODUCER_ELEMENT) {
+        channel->addProducer(gst_element);
+        return {};
+    }
+
+    auto policy = Policy::Drop;
+    if (const auto policy_property = properties.find(POLICY_PROPERTY); policy_property != properties.end()) {
+        if (policy_property->second == "block") {
+            policy = Policy::Block;
+        } else if (policy_property->second != "drop") {
+            LOG_WARN("Unknown channel policy '{}', {} drops buffers while it is behind", policy_property->second,
+                     GST_ELEMENT_NAME(gst_element));
+        }
+    }
+    channel->addConsumer(gst_element, policy);
+    return {};
+}
+
+PipelineChannel::PipelineChannel(std::string name)
+    : name_(std::move(name)), consumers_(std::make_shared<const Consumers>()) {
+}
+
+PipelineChannel::~PipelineChannel() {
+    if (caps_) {
+        gst_caps_unref(caps_);
+    }
+}
+
+void PipelineChannel::addProducer(GstElement* sink) {
+    // The consumers render, the producer branch must never wait for the clock
+    g_object_set(sink, "sync", FALSE, "async", FALSE, "enable-last-sample", FALSE, nullptr);
+
+    // The channel outlives every element, it is never removed from the registry
+    const auto pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(pad, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                      handleProducerProbe, this, nullptr);
+    gst_object_unref(pad);
+    LOG_INFO("Channel {}: producer {} attached", name_, GST_ELEMENT_NAME(sink));
+}
+
+void PipelineChannel::addConsumer(GstElement* source, const Policy policy) {
+    auto consumer = std::make_shared<Consumer>();
+    g_weak_ref_init(&consumer->source, source);
+    consumer->policy = policy;
+
+    // Buffers are timestamped on arrival, in the running time of the consuming pipeline
+    g_object_set(source, "format", GST_FORMAT_TIME, "is-live", TRUE, "do-timestamp", TRUE,
+                 "block", static_cast<gboolean>(policy == Policy::Block), "emit-signals", TRUE, nullptr);
+    const auto release = [](gpointer data, GClosure*) { delete static_cast<std::shared_ptr<Consumer>*>(data); };
+    g_signal_connect_data(source, "enough-data", G_CALLBACK(handleEnoughData), new std::shared_ptr<Consumer>(consumer),
+                          release, static_cast<GConnectFlags>(0));
+    g_signal_connect_data(source, "need-data", G_CALLBACK(handleNeedData), new std::shared_ptr<Consumer>(consumer),
+                          release, static_cast<GConnectFlags>(0));
+
+    std::lock_guard lock(mutex_);
+    if (caps_) {
+        g_object_set(source, "caps", caps_, nullptr);
+    }
+    auto consumers = std::make_shared<Consumers>(*consumers_);
+    consumers->push_back(std::move(consumer));
+    consumers_ = std::move(consumers);
+    LOG_INFO("Channel {}: consumer {} attached with the {} policy", name_, GST_ELEMENT_NAME(source),
+             policy == Policy::Block ? "block" : "drop");
+}
+
+std::shared_ptr<const PipelineChannel::Consumers> PipelineChannel::getConsumers() const {
+    std::lock_guard lock(mutex_);
+    return consumers_;
+}
+
+void PipelineChannel::removeConsumers(const std::vector<std::shared_ptr<Consumer>>& gone) {
+    std::lock_guard lock(mutex_);
+    auto consumers = std::make_shared<Consumers>();
+    std::copy_if(consumers_->begin(), consumers_->end(), std::back_inserter(*consumers), [&gone](const auto& consumer) {
+        return std::find(gone.begin(), gone.end(), consumer) == gone.end();
+    });
+    consumers_ = std::move(consumers);
+    LOG_DEBUG("Channel {}: {} consumers left, {} remain", name_, gone.size(), consumers_->size());
+}
+
+GstPadProbeReturn PipelineChannel::handleProducerProbe(GstPad*, GstPadProbeInfo* info, gpointer data) {
+    const auto channel = static_cast<PipelineChannel*>(data);
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        channel->push(GST_PAD_PROBE_INFO_BUFFER(info));
+    } else if (const auto event = GST_PAD_PROBE_INFO_EVENT(info); GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+        GstCaps* caps;
+        gst_event_parse_caps(event, &caps);
+        channel->setCaps(caps);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+void PipelineChannel::handleEnoughData(GstElement*, gpointer data) {
+    (*static_cast<std::shared_ptr<Consumer>*>(data))->full = true;
+}
+
+void PipelineChannel::handleNeedData(GstElement* source, guint, gpointer data) {
+    const auto& consumer = *static_cast<std::shared_ptr<Consumer>*>(data);
+    if (consumer->full.exchange(false)) {
+        if (const auto dropped = consumer->dropped.exchange(0)) {
+            LOG_WARN("Channel consumer {} dropped {} buffers while it was behind", GST_ELEMENT_NAME(source), dropped);
+        }
+    }
+}
+
+// Runs on the producer streaming thread for every buffer
+void PipelineChannel::push(GstBuffer* buffer) {
+    const auto consumers = getConsumers();
+    std::vector<std::shared_ptr<Consumer>> gone;
+    for (const auto& consumer: *consumers) {
+        const auto source = static_cast<GstElement*>(g_weak_ref_get(&consumer->source));
+        if (!source) {
+            gone.push_back(consumer);
+            continue;
+        }
+        // Stopped, standby and paused consumers neither get buffers nor hold the producer back
+        if (GST_STATE(source) != GST_STATE_PLAYING) {
+            gst_object_unref(source);
+            continue;
+        }
+        if (consumer->policy == Policy::Drop && consumer->full) {
+            ++consumer->dropped;
+            gst_object_unref(source);
+            continue;
+        }
+
+        // Shares the memory of the buffer, only the metadata is copied so each consumer stamps its own
+        const auto copy = gst_buffer_copy(buffer);
+        GST_BUFFER_PTS(copy) = GST_CLOCK_TIME_NONE;
+        GST_BUFFER_DTS(copy) = GST_CLOCK_TIME_NONE;
+        GstFlowReturn flow_return;
+        g_signal_emit_by_name(source, "push-buffer", copy, &flow_return);
+        gst_buffer_unref(copy);
+        gst_object_unref(source);
+    }
+
+    if (!gone.empty()) {
+        removeConsumers(gone);
+    }
+}
+
+void PipelineChannel::setCaps(GstCaps* caps) {
+    std::lock_guard lock(mutex_);
+    gst_caps_replace(&caps_, caps);
+    for (const auto& consumer: *consumers_) {
+        if (const auto source = g_weak_ref_get(&consumer->source)) {
+            g_object_set(source, "caps", caps_, nullptr);
+            g_object_unref(source);
+        }
+    }
+}
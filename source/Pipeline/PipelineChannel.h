@@ -0,0 +1,66 @@
+#ifndef PIPELINECHANNEL_H
+#define PIPELINECHANNEL_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <gst/gst.h>
+
+// Named channel passing the buffers of one pipeline to other pipelines of the same process. The producer is a
+// "channel-out" element, a fakesink whose sink pad is probed, each consumer a "channel-in" element, an appsrc.
+// Consumers get shallow copies sharing the memory of the buffer, so a frame is captured and encoded once. Each
+// consumer picks what happens when it falls behind: "drop" skips buffers while its appsrc queue is full, "block"
+// waits for room and so slows the producer down. Consumers are referenced weakly and leave the channel when their
+// appsrc is destroyed, a consumer pipeline that is stopped or torn down never stalls the producer.
+// The "frame-export" element, exporting frames to other processes (see FrameExport), is handled along with them.
+class PipelineChannel {
+public:
+    enum class Policy {
+        Drop,
+        Block
+    };
+    // The channel of a name, created on first use by either side
+    static std::shared_ptr<PipelineChannel> get(const std::string& name);
+    static bool isChannelElement(const std::string& element_name);
+    // Factory of the element a channel element is made of, the element name for any other element
+    static std::string getFactoryName(const std::string& element_name);
+    // Properties of channel elements that configure the channel instead of the GStreamer element
+    static bool isChannelProperty(const std::string& element_name, const std::string& key);
+    // Connects a channel element to the channel named by its "channel" property, other elements are left alone
+    static std::error_code attach(const std::string& element_name, const std::map<std::string, std::string>& properties,
+                                  GstElement* gst_element);
+
+    explicit PipelineChannel(std::string name);
+    ~PipelineChannel();
+    PipelineChannel(const PipelineChannel&) = delete;
+    PipelineChannel& operator=(const PipelineChannel&) = delete;
+    void addProducer(GstElement* sink);
+    void addConsumer(GstElement* source, Policy policy);
+
+private:
+    struct Consumer {
+        GWeakRef source;
+        Policy policy{Policy::Drop};
+        std::atomic<bool> full{false};
+        std::atomic<uint64_t> dropped{0};
+        ~Consumer() { g_weak_ref_clear(&source); }
+    };
+    using Consumers = std::vector<std::shared_ptr<Consumer>>;
+    static GstPadProbeReturn handleProducerProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+    static void handleEnoughData(GstElement* source, gpointer data);
+    static void handleNeedData(GstElement* source, guint length, gpointer data);
+    std::shared_ptr<const Consumers> getConsumers() const;
+    void removeConsumers(const std::vector<std::shared_ptr<Consumer>>& gone);
+    void push(GstBuffer* buffer);
+    void setCaps(GstCaps* caps);
+    const std::string name_;
+    mutable std::mutex mutex_;
+    std::shared_ptr<const Consumers> consumers_; // Replaced as a whole, pushing works on a snapshot
+    GstCaps* caps_{nullptr};
+};
+
+#endif //PIPELINECHANNEL_H
@@ -1,4 +1,60 @@
 #include "PipelineCommands.h"
+#include <charconv>
+#include <fmt/format.h>
+
+namespace {
+// The response is sent once the probe applied the change, a requester giving up removes the probe.
+// Frame triggered changes report the timestamps of the buffer they took effect on.
+PipelineManager::AsyncCompletion respondOnCompletion(const std::shared_ptr<InputInterface::Requester>& requester) {
+    return {[requester](const std::error_code ec, const PipelineManager::AppliedFrame* frame) {
+                if (ec || !frame) {
+                    requester->source->sendResponse(requester, ec ? "Nack" : "Ack");
+                    return;
+                }
+                fmt::memory_buffer response;
+                fmt::format_to(std::back_inserter(response), "Ack pts={} running_time={}",
+                               static_cast<int64_t>(frame->pts), static_cast<int64_t>(frame->running_time));
+                requester->source->sendResponse(requester, std::string_view(response.data(), response.size()));
+            },
+            [requester](std::function<void()> handler) { requester->source->onAbandon(requester, std::move(handler)); }};
+}
+
+bool parseFrameTrigger(const CommandArguments& arguments, PipelineManager::FrameTrigger& trigger) {
+    if (arguments.size() != 1) {
+        return false;
+    }
+
+    const auto argument = arguments[0];
+    if (argument == "keyframe") {
+        trigger = {PipelineManager::FrameTrigger::Kind::NextKeyframe, GST_CLOCK_TIME_NONE};
+        return true;
+    }
+
+    std::string_view value;
+    if (constexpr std::string_view pts_prefix = "pts="; argument.substr(0, pts_prefix.size()) == pts_prefix) {
+        trigger.kind = PipelineManager::FrameTrigger::Kind::Pts;
+        value = argument.substr(pts_prefix.size());
+    } else if (constexpr std::string_view running_time_prefix = "running_time=";
+               argument.substr(0, running_time_prefix.size()) == running_time_prefix) {
+        trigger.kind = PipelineManager::FrameTrigger::Kind::RunningTime;
+        value = argument.substr(running_time_prefix.size());
+    } else {
+        return false;
+    }
+
+    uint64_t time = 0;
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), time);
+    if (ec != std::errc() || end != value.data() + value.size() || !GST_CLOCK_TIME_IS_VALID(time)) {
+        return false;
+    }
+    trigger.time = time;
+    return true;
+}
+
+bool isSameTrigger(const PipelineManager::FrameTrigger& trigger, const PipelineManager::FrameTrigger& other) {
+    return trigger.kind == other.kind && trigger.time == other.time;
+}
+}
 
 void EnableOptionalElementCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
     std::string response = "Ack";
@@ -8,28 +64,62 @@ void EnableOptionalElementCommand::execute(const std::shared_ptr<InputInterface:
     requester->source->sendResponse(requester, response);
 }
 
+std::shared_ptr<CommandInterface> EnableOptionalElementCommand::withArguments(const CommandArguments& arguments) const {
+    PipelineManager::FrameTrigger trigger;
+    if (!parseFrameTrigger(arguments, trigger)) {
+        return nullptr;
+    }
+    return std::make_shared<EnableOptionalElementAtFrameCommand>(component_, element_name_, trigger);
+}
+
 void DisableOptionalElementCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
-    std::string response = "Ack";
-    if (component_->disableOptionalPipelineElement(element_name_)) {
-        response = "Nack";
+    if (component_->disableOptionalPipelineElement(element_name_, respondOnCompletion(requester))) {
+        requester->source->sendResponse(requester, "Nack");
     }
-    requester->source->sendResponse(requester, response);
+}
+
+std::shared_ptr<CommandInterface> DisableOptionalElementCommand::withArguments(const CommandArguments& arguments) const {
+    PipelineManager::FrameTrigger trigger;
+    if (!parseFrameTrigger(arguments, trigger)) {
+        return nullptr;
+    }
+    return std::make_shared<DisableOptionalElementAtFrameCommand>(component_, element_name_, trigger);
+}
+
+void EnableOptionalElementAtFrameCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    if (component_->enableOptionalPipelineElementAt(element_name_, trigger_, respondOnCompletion(requester))) {
+        requester->source->sendResponse(requester, "Nack");
+    }
+}
+
+bool EnableOptionalElementAtFrameCommand::isSameCommand(const CommandInterface& other) const {
+    const auto* command = dynamic_cast<const EnableOptionalElementAtFrameCommand*>(&other);
+    return command && command->component_ == component_ && command->element_name_ == element_name_ &&
+           isSameTrigger(command->trigger_, trigger_);
+}
+
+void DisableOptionalElementAtFrameCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    if (component_->disableOptionalPipelineElementAt(element_name_, trigger_, respondOnCompletion(requester))) {
+        requester->source->sendResponse(requester, "Nack");
+    }
+}
+
+bool DisableOptionalElementAtFrameCommand::isSameCommand(const CommandInterface& other) const {
+    const auto* command = dynamic_cast<const DisableOptionalElementAtFrameCommand*>(&other);
+    return command && command->component_ == component_ && command->element_name_ == element_name_ &&
+           isSameTrigger(command->trigger_, trigger_);
 }
 
 void EnableOptionalBranchCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
-    std::string response = "Ack";
-    if (component_->enableOptionalPipelineBranch(branch_name_)) {
-        response = "Nack";
+    if (component_->enableOptionalPipelineBranch(branch_name_, respondOnCompletion(requester))) {
+        requester->source->sendResponse(requester, "Nack");
     }
-    requester->source->sendResponse(requester, response);
 }
 
 void DisableOptionalBranchCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
-    std::string response = "Ack";
-    if (component_->disableOptionalPipelineBranch(branch_name_)) {
-        response = "Nack";
+    if (component_->disableOptionalPipelineBranch(branch_name_, respondOnCompletion(requester))) {
+        requester->source->sendResponse(requester, "Nack");
     }
-    requester->source->sendResponse(requester, response);
 }
 
 void EnableAllOptionalElementsCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
@@ -64,6 +154,31 @@ void DisableAllOptionalBranchesCommand::execute(const std::shared_ptr<InputInter
     requester->source->sendResponse(requester, response);
 }
 
+void ReloadPipelineCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    PipelineManager::ReloadResult result;
+    const auto ec = component_->reloadPipeline(result);
+    if (on_reloaded_) {
+        on_reloaded_(); // Also after a failure, the element list may have been replaced before it
+    }
+    if (ec) {
+        requester->source->sendResponse(requester, "Nack");
+        return;
+    }
+
+    // e.g. "Ack properties=2 rebuilt=branch1,branch2 cancelled=0", "Ack properties=0 rebuilt=pipeline cancelled=1"
+    fmt::memory_buffer response;
+    fmt::format_to(std::back_inserter(response), "Ack properties={} rebuilt=", result.updated_properties);
+    if (result.rebuilt_pipeline) {
+        fmt::format_to(std::back_inserter(response), "pipeline");
+    } else if (result.rebuilt_branches.empty()) {
+        fmt::format_to(std::back_inserter(response), "none");
+    } else {
+        fmt::format_to(std::back_inserter(response), "{}", fmt::join(result.rebuilt_branches, ","));
+    }
+    fmt::format_to(std::back_inserter(response), " cancelled={}", result.cancelled_changes);
+    requester->source->sendResponse(requester, std::string_view(response.data(), response.size()));
+}
+
 void StopPipelineCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
     requester->source->sendResponse(requester, "Ack");
     component_->stop();
@@ -1,107 +1,166 @@
 #ifndef PERIPHERY_MANAGER_PIPELINECOMMANDS_H
 #define PERIPHERY_MANAGER_PIPELINECOMMANDS_H
 
+#include <cstdint>
+#include <functional>
 #include <utility>
 
 #include "TasksManager/CommandInterface.h"
 #include "PipelineManager.h"
 
-class EnableOptionalElementCommand : public CommandInterface {
+// Commands acting on the same pipeline share a strand, so they execute one at a time and in order
+class PipelineCommand : public CommandInterface {
+public:
+    explicit PipelineCommand(std::shared_ptr<PipelineManager> pipeline) : component_(std::move(pipeline)) {}
+    size_t getStrandKey() const override { return component_->getStrandKey(); }
+
+protected:
+    std::shared_ptr<PipelineManager> component_;
+};
+
+class EnableOptionalElementCommand : public PipelineCommand {
 public:
     explicit EnableOptionalElementCommand(std::shared_ptr<PipelineManager> sensor, const std::string& element_name)
-        : component_(std::move(sensor)), element_name_(std::move(element_name)) {}
+        : PipelineCommand(std::move(sensor)), element_name_(element_name) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    // Accepts a frame trigger: keyframe, pts=<ns> or running_time=<ns>
+    std::shared_ptr<CommandInterface> withArguments(const CommandArguments& arguments) const override;
+    std::string_view getCoalesceTarget() const override { return element_name_; }
     ~EnableOptionalElementCommand() override = default;
 
 private:
-    std::shared_ptr<PipelineManager> component_;
     std::string element_name_;
 };
 
-class DisableOptionalElementCommand : public CommandInterface {
+class DisableOptionalElementCommand : public PipelineCommand {
 public:
     explicit DisableOptionalElementCommand(std::shared_ptr<PipelineManager> sensor, const std::string& element_name)
-        : component_(std::move(sensor)), element_name_(std::move(element_name)) {}
+        : PipelineCommand(std::move(sensor)), element_name_(element_name) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    // Accepts a frame trigger: keyframe, pts=<ns> or running_time=<ns>
+    std::shared_ptr<CommandInterface> withArguments(const CommandArguments& arguments) const override;
+    std::string_view getCoalesceTarget() const override { return element_name_; }
     ~DisableOptionalElementCommand() override = default;
 
 private:
-    std::shared_ptr<PipelineManager> component_;
     std::string element_name_;
 };
 
-class EnableOptionalBranchCommand : public CommandInterface {
+// Applies the change in the streaming thread on the first buffer matching the trigger
+class EnableOptionalElementAtFrameCommand : public PipelineCommand {
+public:
+    explicit EnableOptionalElementAtFrameCommand(std::shared_ptr<PipelineManager> sensor, const std::string& element_name,
+                                                 const PipelineManager::FrameTrigger trigger)
+        : PipelineCommand(std::move(sensor)), element_name_(element_name), trigger_(trigger) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    std::string_view getCoalesceTarget() const override { return element_name_; }
+    bool isSameCommand(const CommandInterface& other) const override;
+    ~EnableOptionalElementAtFrameCommand() override = default;
+
+private:
+    std::string element_name_;
+    PipelineManager::FrameTrigger trigger_;
+};
+
+class DisableOptionalElementAtFrameCommand : public PipelineCommand {
+public:
+    explicit DisableOptionalElementAtFrameCommand(std::shared_ptr<PipelineManager> sensor, const std::string& element_name,
+                                                  const PipelineManager::FrameTrigger trigger)
+        : PipelineCommand(std::move(sensor)), element_name_(element_name), trigger_(trigger) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    std::string_view getCoalesceTarget() const override { return element_name_; }
+    bool isSameCommand(const CommandInterface& other) const override;
+    ~DisableOptionalElementAtFrameCommand() override = default;
+
+private:
+    std::string element_name_;
+    PipelineManager::FrameTrigger trigger_;
+};
+
+class EnableOptionalBranchCommand : public PipelineCommand {
 public:
     explicit EnableOptionalBranchCommand(std::shared_ptr<PipelineManager> sensor, const std::string& branch_name)
-        : component_(std::move(sensor)), branch_name_(std::move(branch_name)) {}
+        : PipelineCommand(std::move(sensor)), branch_name_(branch_name) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    std::string_view getCoalesceTarget() const override { return branch_name_; }
     ~EnableOptionalBranchCommand() override = default;
 
 private:
-    std::shared_ptr<PipelineManager> component_;
     std::string branch_name_;
 };
 
-class DisableOptionalBranchCommand : public CommandInterface {
+class DisableOptionalBranchCommand : public PipelineCommand {
 public:
     explicit DisableOptionalBranchCommand(std::shared_ptr<PipelineManager> sensor, const std::string& branch_name)
-        : component_(std::move(sensor)), branch_name_(std::move(branch_name)) {}
+        : PipelineCommand(std::move(sensor)), branch_name_(branch_name) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    std::string_view getCoalesceTarget() const override { return branch_name_; }
     ~DisableOptionalBranchCommand() override = default;
 
 private:
-    std::shared_ptr<PipelineManager> component_;
     std::string branch_name_;
 };
 
-class EnableAllOptionalElementsCommand : public CommandInterface {
+class EnableAllOptionalElementsCommand : public PipelineCommand {
 public:
-    explicit EnableAllOptionalElementsCommand(std::shared_ptr<PipelineManager> sensor) : component_(std::move(sensor)) {}
+    explicit EnableAllOptionalElementsCommand(std::shared_ptr<PipelineManager> sensor) : PipelineCommand(std::move(sensor)) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
     ~EnableAllOptionalElementsCommand() override = default;
-
-private:
-    std::shared_ptr<PipelineManager> component_;
 };
 
-class DisableAllOptionalElementsCommand : public CommandInterface {
+class DisableAllOptionalElementsCommand : public PipelineCommand {
 public:
-    explicit DisableAllOptionalElementsCommand(std::shared_ptr<PipelineManager> sensor) : component_(std::move(sensor)) {}
+    explicit DisableAllOptionalElementsCommand(std::shared_ptr<PipelineManager> sensor) : PipelineCommand(std::move(sensor)) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
     ~DisableAllOptionalElementsCommand() override = default;
-
-private:
-    std::shared_ptr<PipelineManager> component_;
 };
 
-class EnableAllOptionalBranchesCommand : public CommandInterface {
+class EnableAllOptionalBranchesCommand : public PipelineCommand {
 public:
-    explicit EnableAllOptionalBranchesCommand(std::shared_ptr<PipelineManager> sensor) : component_(std::move(sensor)) {}
+    explicit EnableAllOptionalBranchesCommand(std::shared_ptr<PipelineManager> sensor) : PipelineCommand(std::move(sensor)) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
     ~EnableAllOptionalBranchesCommand() override = default;
-
-private:
-    std::shared_ptr<PipelineManager> component_;
 };
 
-class DisableAllOptionalBranchesCommand : public CommandInterface {
+class DisableAllOptionalBranchesCommand : public PipelineCommand {
 public:
-    explicit DisableAllOptionalBranchesCommand(std::shared_ptr<PipelineManager> sensor) : component_(std::move(sensor)) {}
+    explicit DisableAllOptionalBranchesCommand(std::shared_ptr<PipelineManager> sensor) : PipelineCommand(std::move(sensor)) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
     ~DisableAllOptionalBranchesCommand() override = default;
+};
+
+// Applies the changes of the pipeline file to the running pipeline, on_reloaded then refreshes what
+// depends on the element list (e.g. the registered element commands)
+class ReloadPipelineCommand : public PipelineCommand {
+public:
+    ReloadPipelineCommand(std::shared_ptr<PipelineManager> sensor, std::function<void()> on_reloaded)
+        : PipelineCommand(std::move(sensor)), on_reloaded_(std::move(on_reloaded)) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    ~ReloadPipelineCommand() override = default;
 
 private:
-    std::shared_ptr<PipelineManager> component_;
+    std::function<void()> on_reloaded_;
 };
 
-class StopPipelineCommand : public CommandInterface {
+class StopPipelineCommand : public PipelineCommand {
 public:
-    explicit StopPipelineCommand(std::shared_ptr<PipelineManager> sensor) : component_(std::move(sensor)) {}
+    explicit StopPipelineCommand(std::shared_ptr<PipelineManager> sensor) : PipelineCommand(std::move(sensor)) {}
     void execute(std::shared_ptr<InputInterface::Requester> requester) override;
     ~StopPipelineCommand() override = default;
+};
+
+// Work a pipeline posts onto its own strand, e.g. a failover, runs without a requester
+class PipelineTaskCommand : public CommandInterface {
+public:
+    PipelineTaskCommand(const size_t strand_key, std::function<void()> task)
+        : strand_key_(strand_key), task_(std::move(task)) {}
+    void execute(std::shared_ptr<InputInterface::Requester>) override { task_(); }
+    size_t getStrandKey() const override { return strand_key_; }
+    ~PipelineTaskCommand() override = default;
 
 private:
-    std::shared_ptr<PipelineManager> component_;
+    size_t strand_key_;
+    std::function<void()> task_;
 };
 
 #endif //PERIPHERY_MANAGER_PIPELINECOMMANDS_H
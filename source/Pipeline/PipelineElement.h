@@ -22,6 +22,12 @@ public:
     bool is_initialized {false};
     bool is_linked {false};
     GstElement* gst_element {nullptr};
+    // Name commands address an optional element by, set when the elements list is built
+    std::string target_name {};
+    // Resolved while building the pipeline, kept in the plan cache
+    bool properties_validated {false};
+    std::string src_pad_template {};
+    std::string sink_pad_template {};
 
     std::string toString() const;
 };
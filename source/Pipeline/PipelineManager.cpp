@@ -1,23 +1,120 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <tuple>
 #include <utility>
 #include <sstream>
+#include <unordered_map>
 #include <unordered_set>
+#include <unistd.h>
+#include "EventLog/EventLog.h"
+#include "Pipeline/PipelineChannel.h"
 #include "Pipeline/PipelineParser.h"
 #include "PipelineElement.h"
 #include "PipelineManager.h"
 
 
-PipelineManager::PipelineManager(std::string pipeline_file) : pipeline_file_(std::move(pipeline_file)) {
+PipelineManager::PipelineManager(std::string pipeline_file, std::string instance_name, PipelineStartupOptions options)
+    : pipeline_file_(std::move(pipeline_file)), instance_name_(std::move(instance_name)),
+      use_launch_description_(options.use_launch_description), standby_options_(options),
+      standby_state_(options.standby_state), standby_max_memory_(options.standby_max_memory_mb << 20),
+      on_playing_(std::move(options.on_playing)), strand_executor_(std::move(options.strand_executor)),
+      source_recovery_options_(options.source_recovery) {
     LOG_TRACE("Pipeline constructor");
-    LOG_DEBUG("Init gstreamer");
-
-    gst_init(nullptr, nullptr);
+    probe_owner_ = std::make_shared<ProbeOwner>();
+    probe_owner_->manager = this;
+    // A standby is built like this pipeline but without plugin preloading and a standby of its own. It is built on
+    // another thread while the pipeline runs, so it leaves the registry, which is configured through the environment
+    // and may be rescanned, to this pipeline.
+    standby_options_.registry_file.clear();
+    standby_options_.preload_plugins = false;
+    standby_options_.standby_state = GST_STATE_VOID_PENDING;
+    standby_options_.on_playing = nullptr;
+    standby_options_.strand_executor = nullptr;
+    initGstreamer(options.registry_file);
 
     gst_pipeline_ = std::shared_ptr<GstElement>(gst_pipeline_new("runtime-control-pipeline"), gst_object_unref);
     if (!GST_IS_ELEMENT(gst_pipeline_.get())) {
         LOG_ERROR("Failed to create pipeline");
     }
 
-    createElementsList(pipeline_file_);
+    if (!options.plan_cache_directory.empty()) {
+        plan_cache_ = std::make_unique<PlanCache>(std::move(options.plan_cache_directory));
+    }
+    const auto element_list_start = std::chrono::steady_clock::now();
+    createElementsList(pipeline_file_, instance_name_);
+    startup_timing_.element_list = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - element_list_start);
+
+    if (!registry_update_skipped_ && !options.preload_plugins) {
+        return;
+    }
+    const auto factory_names = getFactoryNames();
+    // A registry kept from before plugins were installed lacks their factories, scan the plugin directories once
+    if (registry_update_skipped_ && std::any_of(factory_names.begin(), factory_names.end(), [](const std::string& name) {
+            return !gst_registry_check_feature_version(gst_registry_get(), name.c_str(), 0, 0, 0);
+        })) {
+        LOG_INFO("GStreamer registry lacks element factories of the pipeline, updating it");
+        gst_update_registry();
+    }
+    if (options.preload_plugins) {
+        plugin_preloader_.start(factory_names);
+    }
+}
+
+bool PipelineManager::configureRegistry(const std::filesystem::path& registry_file) {
+    // Read by gst_init, while the private registry exists it is loaded without scanning the plugin directories
+    std::error_code ec;
+    if (registry_file.has_parent_path()) {
+        std::filesystem::create_directories(registry_file.parent_path(), ec);
+    }
+    setenv("GST_REGISTRY", registry_file.c_str(), 1);
+    const auto update_skipped = std::filesystem::exists(registry_file, ec);
+    if (update_skipped) {
+        setenv("GST_REGISTRY_UPDATE", "no", 1);
+    } else {
+        LOG_INFO("Building GStreamer registry {}", registry_file.string());
+    }
+    return update_skipped;
+}
+
+void PipelineManager::initGstreamer(const std::filesystem::path& registry_file) {
+    const auto start_time = std::chrono::steady_clock::now();
+    if (!registry_file.empty()) {
+        registry_update_skipped_ = configureRegistry(registry_file);
+    }
+
+    LOG_DEBUG("Init gstreamer");
+    gst_init(nullptr, nullptr);
+    startup_timing_.init = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+}
+
+std::vector<std::string> PipelineManager::getFactoryNames() const {
+    std::vector<std::string> factory_names;
+    for (const auto& element: pipeline_elements_) {
+        factory_names.push_back(PipelineChannel::getFactoryName(element.name));
+    }
+    std::sort(factory_names.begin(), factory_names.end());
+    factory_names.erase(std::unique(factory_names.begin(), factory_names.end()), factory_names.end());
+    return factory_names;
+}
+
+void PipelineManager::reportStartupTiming() {
+    if (startup_timing_.reported) {
+        return;
+    }
+    startup_timing_.reported = true;
+    LOG_INFO("Startup: gst_init {}us, element list {}us, plugin preload {}us (waited {}us), pipeline creation {}us, "
+             "PLAYING after {}us", startup_timing_.init.count(), startup_timing_.element_list.count(),
+             startup_timing_.plugin_preload.count(), startup_timing_.plugin_preload_wait.count(),
+             startup_timing_.pipeline_creation.count(),
+             std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now() - startup_timing_.start_time).count());
+    if (on_playing_) {
+        on_playing_();
+    }
 }
 
 std::error_code PipelineManager::linkElements(PipelineElement& source, PipelineElement& destination) {
@@ -47,6 +144,24 @@ std::error_code PipelineManager::linkElements(PipelineElement& source, PipelineE
 
 PipelineManager::~PipelineManager() {
     LOG_TRACE("Pipeline destructor");
+    {
+        std::lock_guard lock(probe_owner_->mutex);
+        probe_owner_->manager = nullptr;
+    }
+    {
+        std::unique_lock lock(mutex_);
+        cancelProbes();
+        waitForAppliedProbes(lock);
+    }
+    detachSourceRecoveries();
+    // A standby that never took over is still held in READY or PAUSED
+    if (gst_pipeline_) {
+        gst_element_set_state(gst_pipeline_.get(), GST_STATE_NULL);
+    }
+    // A pipeline stopped by a command keeps its bus watch, which must not be dispatched into a destroyed manager
+    if (const auto bus_watch = bus_watch_id_ ? g_main_context_find_source_by_id(nullptr, bus_watch_id_) : nullptr) {
+        g_source_destroy(bus_watch);
+    }
 }
 
 std::error_code PipelineManager::enableAllOptionalPipelineBranches() {
@@ -60,25 +175,34 @@ std::error_code PipelineManager::disableAllOptionalPipelineBranches() {
 }
 
 GstPadProbeReturn PipelineManager::connectGstElementProbeCallback(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
-    const auto element = static_cast<PipelineElement*>(data);
+    insertGstElement(pad, *static_cast<PipelineElement*>(data));
+
+    return GST_PAD_PROBE_REMOVE;
+}
 
-    auto peer = std::shared_ptr<GstPad>(gst_pad_get_peer(pad), gst_object_unref);
+// Inserts the element between the pad and its current peer
+std::error_code PipelineManager::insertGstElement(GstPad* src_pad, PipelineElement& element) {
+    auto peer = std::shared_ptr<GstPad>(gst_pad_get_peer(src_pad), gst_object_unref);
     if (peer == nullptr) {
         LOG_ERROR("Failed to get peer pad");
-        return GST_PAD_PROBE_REMOVE;
+        return std::make_error_code(std::errc::no_such_device);
     }
 
     /* Unlink pads */
-    gst_pad_unlink(pad, peer.get());
-    gst_element_sync_state_with_parent(element->gst_element);
+    gst_pad_unlink(src_pad, peer.get());
+    gst_element_sync_state_with_parent(element.gst_element);
 
     /* Connect new element */
-    gst_element_link_pads(GST_ELEMENT(GST_OBJECT_PARENT(pad)), GST_OBJECT_NAME(pad),
-                          element->gst_element, nullptr);
-    gst_element_link_pads(element->gst_element, nullptr, GST_ELEMENT(GST_OBJECT_PARENT (peer.get())),
-                          GST_OBJECT_NAME(peer.get()));
+    if (!gst_element_link_pads(GST_ELEMENT(GST_OBJECT_PARENT(src_pad)), GST_OBJECT_NAME(src_pad),
+                               element.gst_element, nullptr) ||
+        !gst_element_link_pads(element.gst_element, nullptr, GST_ELEMENT(GST_OBJECT_PARENT(peer.get())),
+                               GST_OBJECT_NAME(peer.get()))) {
+        LOG_ERROR("Failed to insert element {}", element.toString());
+        return std::make_error_code(std::errc::io_error);
+    }
 
-    return GST_PAD_PROBE_REMOVE;
+    element.is_linked = true;
+    return {};
 }
 
 std::error_code PipelineManager::linkGstElement(PipelineElement& current_element) {
@@ -143,10 +267,11 @@ std::string PipelineManager::generateGstElementUniqueName(const PipelineElement&
     return {unique_name};
 }
 
-void PipelineManager::validateGstElementProperties(PipelineElement& element) const {
+void PipelineManager::validateGstElementProperties(PipelineElement& element, GObjectClass* element_class) const {
         for (auto property_it = element.properties.begin(); property_it != element.properties.end();) {
             const auto& [key, value] = *property_it;
-            if(!g_object_class_find_property(G_OBJECT_GET_CLASS(element.gst_element), key.c_str())) {
+            if (!PipelineChannel::isChannelProperty(element.name, key) &&
+                !g_object_class_find_property(element_class, key.c_str())) {
                 element.properties.erase(property_it++);
                 LOG_WARN("Property {} not found for gst element {}. Earsing property from element", key, element.name.c_str());
             } else {
@@ -157,6 +282,9 @@ void PipelineManager::validateGstElementProperties(PipelineElement& element) con
 
 void PipelineManager::setGstElementProperty(PipelineElement& element) const {
     for (const auto& [key, value] : element.properties) {
+        if (PipelineChannel::isChannelProperty(element.name, key)) {
+            continue;
+        }
         gst_util_set_object_arg(G_OBJECT(element.gst_element), key.c_str(), value.c_str());
         LOG_TRACE("Set property {} with value {} for element {}", key, value, element.name.c_str());
     }
@@ -182,7 +310,8 @@ std::error_code PipelineManager::createGstElement(PipelineElement& element) cons
     auto unique_gst_element_name = generateGstElementUniqueName(element);
 
     if(!isGstElementInPipeline(unique_gst_element_name)) {
-        element.gst_element = gst_element_factory_make(element.name.c_str(), unique_gst_element_name.c_str());
+        element.gst_element = gst_element_factory_make(PipelineChannel::getFactoryName(element.name).c_str(),
+                                                       unique_gst_element_name.c_str());
         if (!element.gst_element) {
             LOG_ERROR("Failed to create pipeline element {}", element.toString());
             return {errno, std::generic_category()};
@@ -192,8 +321,14 @@ std::error_code PipelineManager::createGstElement(PipelineElement& element) cons
             return {errno, std::generic_category()};
         }
 
-        validateGstElementProperties(element);
+        if (!element.properties_validated) {
+            validateGstElementProperties(element, G_OBJECT_GET_CLASS(element.gst_element));
+            element.properties_validated = true;
+        }
         setGstElementProperty(element);
+        if (auto ec = PipelineChannel::attach(element.name, element.properties, element.gst_element)) {
+            return ec;
+        }
 
         if (!gst_bin_add(GST_BIN(gst_pipeline_.get()), element.gst_element)) {
             LOG_ERROR("Failed to add element {} to pipeline", element.toString());
@@ -237,17 +372,467 @@ std::error_code PipelineManager::createGstPipeline(std::vector<PipelineElement>&
     return {};
 }
 
+namespace {
+// Quoted value of a launch description property, the parser deserializes it by the property type
+std::string quoteLaunchValue(const std::string& value) {
+    std::string quoted {"\""};
+    for (const auto c: value) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+}
+
+std::error_code PipelineManager::generateLaunchDescription(std::vector<PipelineElement>& pipeline,
+                                                           std::string& description) const {
+    std::ostringstream launch;
+    std::unordered_set<std::string> defined_names;
+    const PipelineElement* previous_element {};
+    auto chain_closed = false;
+    for (auto& element: pipeline) {
+        if (element.is_optional) {
+            continue;
+        }
+        const auto unique_name = generateGstElementUniqueName(element);
+
+        if (!previous_element) {
+            // The first element starts the description
+        } else if (previous_element->branch != element.branch) {
+            // Like linkGstElement, the first element of a branch is fed by the tee of the branch
+            const auto tee = std::find_if(pipeline.begin(), pipeline.end(), [&element](const PipelineElement& candidate) {
+                return candidate.name == "tee" && !candidate.is_optional && candidate.type == element.branch;
+            });
+            if (tee == pipeline.end()) {
+                LOG_DEBUG("No tee feeds branch {}", element.branch);
+                return std::make_error_code(std::errc::not_supported);
+            }
+            launch << "  " << generateGstElementUniqueName(*tee) << ". ! ";
+        } else if (chain_closed) {
+            LOG_DEBUG("Elements after the mux reference {} can't be described", unique_name);
+            return std::make_error_code(std::errc::not_supported);
+        } else {
+            launch << " ! ";
+        }
+        previous_element = &element;
+        chain_closed = false;
+
+        // A mux shared by branches is defined once and referenced by name, optionally with its sink pad
+        if (defined_names.count(unique_name)) {
+            if (element.type != "mux") {
+                LOG_DEBUG("Element name {} is not unique", unique_name);
+                return std::make_error_code(std::errc::not_supported);
+            }
+            launch << unique_name << '.' << element.sink_pad_name;
+            chain_closed = true;
+            continue;
+        }
+        if (!element.sink_pad_name.empty()) {
+            LOG_DEBUG("Explicit sink pad {} of {} can't be described", element.sink_pad_name, unique_name);
+            return std::make_error_code(std::errc::not_supported);
+        }
+        defined_names.insert(unique_name);
+
+        // The parser treats unknown properties as errors, drop them like createGstElement does
+        if (!element.properties_validated) {
+            const auto factory = gst_element_factory_find(PipelineChannel::getFactoryName(element.name).c_str());
+            if (!factory) {
+                LOG_DEBUG("No element factory {}", element.name);
+                return std::make_error_code(std::errc::not_supported);
+            }
+            const auto loaded_factory = gst_plugin_feature_load(GST_PLUGIN_FEATURE(factory));
+            gst_object_unref(factory);
+            if (!loaded_factory) {
+                LOG_DEBUG("Failed to load element factory {}", element.name);
+                return std::make_error_code(std::errc::not_supported);
+            }
+            const auto element_class = static_cast<GObjectClass*>(
+                g_type_class_ref(gst_element_factory_get_element_type(GST_ELEMENT_FACTORY(loaded_factory))));
+            validateGstElementProperties(element, element_class);
+            g_type_class_unref(element_class);
+            gst_object_unref(loaded_factory);
+            element.properties_validated = true;
+        }
+
+        launch << PipelineChannel::getFactoryName(element.name) << " name=" << unique_name;
+        for (const auto& [key, value]: element.properties) {
+            if (key != "name" && !PipelineChannel::isChannelProperty(element.name, key)) {
+                launch << ' ' << key << '=' << quoteLaunchValue(value);
+            }
+        }
+    }
+
+    description = launch.str();
+    return description.empty() ? std::make_error_code(std::errc::not_supported) : std::error_code {};
+}
+
+std::error_code PipelineManager::createGstPipelineFromDescription(std::vector<PipelineElement>& pipeline) {
+    std::string description;
+    if (auto ec = generateLaunchDescription(pipeline, description)) {
+        return ec;
+    }
+    LOG_DEBUG("Launch description: {}", description);
+
+    GError* error {};
+    const auto launched = gst_parse_launch_full(description.c_str(), nullptr,
+                                                static_cast<GstParseFlags>(GST_PARSE_FLAG_FATAL_ERRORS |
+                                                                           GST_PARSE_FLAG_PLACE_IN_BIN), &error);
+    const auto launched_pipeline = launched ? std::shared_ptr<GstElement>(GST_ELEMENT(gst_object_ref_sink(launched)),
+                                                                          gst_object_unref)
+                                            : nullptr;
+    if (error || !launched_pipeline || !GST_IS_PIPELINE(launched_pipeline.get())) {
+        LOG_WARN("Failed to create pipeline from launch description: {}", error ? error->message : "not a pipeline");
+        if (error) {
+            g_error_free(error);
+        }
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    std::vector<GstElement*> gst_elements;
+    for (const auto& element: pipeline) {
+        if (element.is_optional) {
+            continue;
+        }
+        const auto unique_name = generateGstElementUniqueName(element);
+        const auto gst_element = gst_bin_get_by_name(GST_BIN(launched_pipeline.get()), unique_name.c_str());
+        if (!gst_element) {
+            LOG_WARN("Launch description did not create element {}", unique_name);
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+        // The pipeline holds the element for as long as it is part of it
+        gst_object_unref(gst_element);
+        if (auto ec = PipelineChannel::attach(element.name, element.properties, gst_element)) {
+            return ec;
+        }
+        gst_elements.push_back(gst_element);
+    }
+
+    auto gst_element = gst_elements.begin();
+    for (auto& element: pipeline) {
+        if (!element.is_optional) {
+            element.gst_element = *gst_element++;
+            element.is_initialized = true;
+            element.is_linked = true;
+        }
+    }
+
+    gst_object_set_name(GST_OBJECT(launched_pipeline.get()), GST_ELEMENT_NAME(gst_pipeline_.get()));
+    gst_pipeline_ = launched_pipeline;
+    return {};
+}
+
+// Optional elements are always handled dynamically, the rest is built in one go when it can be described
+std::error_code PipelineManager::buildGstPipeline(bool& from_description) {
+    from_description = use_launch_description_ && !createGstPipelineFromDescription(pipeline_elements_);
+    if (from_description) {
+        return {};
+    }
+    return createGstPipeline(pipeline_elements_);
+}
+
+std::error_code PipelineManager::prepareStandby(const GstState state) {
+    auto from_description = false;
+    if (auto ec = buildGstPipeline(from_description)) {
+        return ec;
+    }
+    if (gst_element_set_state(gst_pipeline_.get(), state) == GST_STATE_CHANGE_FAILURE) {
+        LOG_ERROR("Failed to set the standby pipeline to {}", gst_element_state_get_name(state));
+        return std::make_error_code(std::errc::io_error);
+    }
+    return {};
+}
+
+namespace {
+// An optional branch has only optional elements and is fed by a tee, so it can be rebuilt on its own
+bool isOptionalBranch(const std::vector<PipelineElement>& elements, const std::string& branch_name) {
+    auto has_elements = false;
+    auto has_tee = false;
+    for (const auto& element: elements) {
+        if (element.branch == branch_name) {
+            if (!element.is_optional) {
+                return false;
+            }
+            has_elements = true;
+        }
+        has_tee = has_tee || (element.name == "tee" && element.type == branch_name);
+    }
+    return has_elements && has_tee;
+}
+
+size_t getResidentMemory() {
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (std::ifstream statm("/proc/self/statm"); !(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+}
+
+// Replaces the standby in the background, waits for a build still in progress
+void PipelineManager::startStandbyBuild() {
+    std::lock_guard build_lock(standby_build_mutex_);
+    if (standby_build_.valid()) {
+        standby_build_.wait();
+    }
+    {
+        std::lock_guard lock(standby_mutex_);
+        standby_.reset();
+    }
+
+    standby_build_ = std::async(std::launch::async, [this] {
+        const auto start_time = std::chrono::steady_clock::now();
+        const auto memory_before = getResidentMemory();
+        std::unique_ptr<PipelineManager> standby;
+        try {
+            standby = std::make_unique<PipelineManager>(pipeline_file_, instance_name_, standby_options_);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to build the standby pipeline: {}", e.what());
+            return;
+        }
+        if (auto ec = standby->prepareStandby(standby_state_)) {
+            LOG_ERROR("Failed to build the standby pipeline: {}", ec.message());
+            return;
+        }
+
+        // Approximate, the running pipeline allocates concurrently
+        const auto memory_after = getResidentMemory();
+        const auto memory_overhead = memory_after > memory_before ? memory_after - memory_before : 0;
+        if (memory_overhead > standby_max_memory_) {
+            LOG_WARN("Dropping the standby pipeline, it takes {} MB, more than the {} MB allowed", memory_overhead >> 20,
+                     standby_max_memory_ >> 20);
+            return;
+        }
+        LOG_INFO("Standby pipeline held in {} after {}ms, about {} MB", gst_element_state_get_name(standby_state_),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count(),
+                 memory_overhead >> 20);
+        std::lock_guard lock(standby_mutex_);
+        standby_ = std::move(standby);
+    });
+}
+
+// Source elements of the running pipeline, channel consumers excepted, are restarted when they fail
+void PipelineManager::attachSourceRecoveries() {
+    if (!source_recovery_options_.enabled) {
+        return;
+    }
+    std::vector<std::shared_ptr<SourceRecovery>> source_recoveries;
+    for (const auto& element: pipeline_elements_) {
+        if (!element.is_initialized || !element.gst_element || PipelineChannel::isChannelElement(element.name) ||
+            !GST_OBJECT_FLAG_IS_SET(element.gst_element, GST_ELEMENT_FLAG_SOURCE)) {
+            continue;
+        }
+        auto source_recovery = std::make_shared<SourceRecovery>(gst_pipeline_.get(), element.gst_element,
+                                                                source_recovery_options_);
+        source_recovery->init();
+        source_recoveries.push_back(std::move(source_recovery));
+    }
+    LOG_INFO("Restarting {} sources when they fail", source_recoveries.size());
+    std::lock_guard lock(source_recoveries_mutex_);
+    source_recoveries_ = std::move(source_recoveries);
+}
+
+// Stops the fillers before the elements they feed go away
+void PipelineManager::detachSourceRecoveries() {
+    std::vector<std::shared_ptr<SourceRecovery>> source_recoveries;
+    {
+        std::lock_guard lock(source_recoveries_mutex_);
+        source_recoveries.swap(source_recoveries_);
+    }
+}
+
+// Bus thread. False when the failed object belongs to no recovered source
+bool PipelineManager::recoverSource(GstObject* failed_object, const std::string& reason) {
+    std::shared_ptr<SourceRecovery> source_recovery;
+    {
+        std::lock_guard lock(source_recoveries_mutex_);
+        const auto it = std::find_if(source_recoveries_.begin(), source_recoveries_.end(),
+                                     [failed_object](const auto& recovery) { return recovery->owns(failed_object); });
+        if (it == source_recoveries_.end()) {
+            return false;
+        }
+        source_recovery = *it;
+    }
+    source_recovery->handleFailure(reason);
+    return true;
+}
+
+// Bus thread, on an error no source recovery handled. Posts the failover onto the strand of the pipeline commands,
+// or runs it right away without an executor. False if there is no standby to take over.
+bool PipelineManager::postFailOver() {
+    {
+        std::lock_guard lock(standby_mutex_);
+        if (!standby_) {
+            return false;
+        }
+    }
+    // Errors the failed pipeline posts until it is stopped belong to the same failure
+    if (failover_pending_.exchange(true)) {
+        return true;
+    }
+    failover_start_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // Critical, so it runs ahead of the queued commands, which then apply to the standby
+    if (strand_executor_ && strand_executor_(getStrandKey(), [owner = probe_owner_] {
+            std::lock_guard owner_lock(owner->mutex);
+            if (owner->manager && !owner->manager->failOver()) {
+                owner->manager->stopped_on_error_ = true;
+                owner->manager->stop();
+            }
+        })) {
+        return true;
+    }
+    if (strand_executor_) {
+        LOG_WARN("Failed to queue the failover, running it on the bus thread");
+    }
+    if (!failOver()) {
+        failover_pending_ = false;
+        return false;
+    }
+    return true;
+}
+
+// Bus thread, a failover may swap the pipeline meanwhile
+bool PipelineManager::isCurrentPipeline(const GstObject* object) const {
+    std::lock_guard lock(mutex_);
+    return object == GST_OBJECT(gst_pipeline_.get());
+}
+
+// Sets the sources of the pipeline to NULL and keeps them there, so devices they opened are released before
+// the standby opens them
+void PipelineManager::stopSources(GstElement* pipeline) {
+    const auto iterator = gst_bin_iterate_sources(GST_BIN(pipeline));
+    GValue item = G_VALUE_INIT;
+    while (gst_iterator_next(iterator, &item) == GST_ITERATOR_OK) {
+        const auto source = GST_ELEMENT(g_value_get_object(&item));
+        gst_element_set_locked_state(source, TRUE);
+        gst_element_set_state(source, GST_STATE_NULL);
+        g_value_unset(&item);
+    }
+    gst_iterator_free(iterator);
+}
+
+// Runs on the pipeline strand, so no command or reload changes the pipeline meanwhile. The sources of the failed
+// pipeline are stopped, then the standby takes over its elements list and is set to PLAYING. The rest of the failed
+// pipeline is stopped on another thread and optional elements and branches that were enabled are enabled on the
+// new one. False if there is no standby to take over or changes already being applied did not finish in time.
+bool PipelineManager::failOver() {
+    std::unique_ptr<PipelineManager> standby;
+    {
+        std::lock_guard lock(standby_mutex_);
+        standby = std::move(standby_);
+    }
+    if (!standby) {
+        failover_pending_ = false;
+        return false;
+    }
+    detachSourceRecoveries();
+    if (const auto bus_watch = bus_watch_id_ ? g_main_context_find_source_by_id(nullptr, bus_watch_id_) : nullptr) {
+        g_source_destroy(bus_watch);
+    }
+
+    std::shared_ptr<GstElement> failed_pipeline;
+    std::vector<PipelineElement> failed_elements;
+    {
+        // Pending changes target the failed pipeline, the enabled state is carried over below instead. Probes that
+        // claimed their change before they could be cancelled apply it to the failed elements before the swap.
+        std::unique_lock lock(mutex_);
+        cancelProbes();
+        if (!waitForAppliedProbes(lock)) {
+            LOG_ERROR("Not failing over while changes are still being applied to the failed pipeline");
+            lock.unlock();
+            std::lock_guard standby_lock(standby_mutex_);
+            standby_ = std::move(standby);
+            failover_pending_ = false;
+            return false;
+        }
+        failed_pipeline = std::move(gst_pipeline_);
+        failed_elements = std::move(pipeline_elements_);
+        gst_pipeline_ = std::move(standby->gst_pipeline_);
+        pipeline_elements_ = std::move(standby->pipeline_elements_);
+    }
+    stopSources(failed_pipeline.get());
+    attachSourceRecoveries();
+    gst_element_set_state(gst_pipeline_.get(), GST_STATE_PLAYING);
+    const auto bus = std::shared_ptr<GstBus>(gst_element_get_bus(gst_pipeline_.get()), gst_object_unref);
+    bus_watch_id_ = gst_bus_add_watch(bus.get(), handlePupelineBusSignal, this);
+
+    std::vector<std::string> enabled_branches;
+    std::vector<std::string> enabled_elements;
+    for (const auto& element: failed_elements) {
+        if (!element.is_optional || !element.is_linked) {
+            continue;
+        }
+        if (!isOptionalBranch(failed_elements, element.branch)) {
+            enabled_elements.push_back(element.target_name);
+        } else if (std::find(enabled_branches.begin(), enabled_branches.end(), element.branch) == enabled_branches.end()) {
+            enabled_branches.push_back(element.branch);
+        }
+    }
+
+    // Probe contexts of pending changes may still point into the failed elements until the pipeline stopped
+    if (failed_pipeline_teardown_.valid()) {
+        failed_pipeline_teardown_.wait();
+    }
+    failed_pipeline_teardown_ = std::async(std::launch::async,
+        [failed_pipeline = std::move(failed_pipeline), failed_elements = std::move(failed_elements)]() mutable {
+            gst_element_set_state(failed_pipeline.get(), GST_STATE_NULL);
+            failed_pipeline.reset();
+            failed_elements.clear();
+        });
+
+    for (const auto& branch: enabled_branches) {
+        if (auto ec = enableOptionalPipelineBranch(branch)) {
+            LOG_ERROR("Failed to enable branch {} on the standby pipeline: {}", branch, ec.message());
+        }
+    }
+    for (const auto& element_name: enabled_elements) {
+        if (auto ec = enableOptionalPipelineElement(element_name)) {
+            LOG_ERROR("Failed to enable element {} on the standby pipeline: {}", element_name, ec.message());
+        }
+    }
+
+    startStandbyBuild();
+    failover_pending_ = false;
+    return true;
+}
+
 std::error_code PipelineManager::play() {
-    if (auto ec = createGstPipeline(pipeline_elements_)) {
+    const auto wait_start = std::chrono::steady_clock::now();
+    startup_timing_.plugin_preload = plugin_preloader_.wait();
+    startup_timing_.plugin_preload_wait = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - wait_start);
+
+    const auto start_time = std::chrono::steady_clock::now();
+    auto from_description = false;
+    if (auto ec = buildGstPipeline(from_description)) {
         LOG_ERROR("Failed to create pipeline: {}", ec.message());
-        return ec;
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    startup_timing_.pipeline_creation = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    LOG_INFO("Pipeline created {} in {}us", from_description ? "from a launch description" : "element by element",
+             startup_timing_.pipeline_creation.count());
+
+    // Stored once the pad templates of the linked elements were chosen
+    if (plan_cache_ && !plan_loaded_) {
+        if (auto ec = plan_cache_->store(pipeline_file_, instance_name_, pipeline_file_hash_, pipeline_elements_,
+                                         startup_settings_)) {
+            LOG_WARN("Failed to store the pipeline plan: {}", ec.message());
+        }
+        plan_loaded_ = true;
     }
 
+    attachSourceRecoveries();
     LOG_DEBUG("Start playing");
     gst_element_set_state(gst_pipeline_.get(), GST_STATE_PLAYING);
 
     const auto bus = std::shared_ptr<GstBus>(gst_element_get_bus(gst_pipeline_.get()), gst_object_unref);
-    gst_bus_add_watch(bus.get(), handlePupelineBusSignal, this);
+    bus_watch_id_ = gst_bus_add_watch(bus.get(), handlePupelineBusSignal, this);
 
     gst_loop_ = std::shared_ptr<GMainLoop>(g_main_loop_new(nullptr, FALSE), g_main_loop_unref);
     if (!gst_loop_) {
@@ -255,9 +840,16 @@ std::error_code PipelineManager::play() {
         return {errno, std::generic_category()};
     }
 
+    if (standby_state_ != GST_STATE_VOID_PENDING) {
+        startStandbyBuild();
+    }
+
     // GST_DEBUG_BIN_TO_DOT_FILE(GST_BIN(gst_pipeline_.get()), GST_DEBUG_GRAPH_SHOW_ALL, "custom_pipeline");
     g_main_loop_run(gst_loop_.get());
 
+    if (stopped_on_error_) {
+        return std::make_error_code(std::errc::io_error);
+    }
     return {};
 }
 
@@ -276,17 +868,60 @@ std::error_code PipelineManager::stop() const {
 gboolean PipelineManager::handlePupelineBusSignal(GstBus*, GstMessage* message, gpointer data) {
     const auto pipeline_manager = static_cast<PipelineManager*>(data);
     switch (GST_MESSAGE_TYPE(message)) {
+        case GST_MESSAGE_STATE_CHANGED: {
+            GstState old_state;
+            GstState new_state;
+            gst_message_parse_state_changed(message, &old_state, &new_state, nullptr);
+            RECORD_EVENT(EventType::StateChange, old_state, new_state, GST_MESSAGE_SRC_NAME(message));
+            if (new_state == GST_STATE_PLAYING && pipeline_manager->isCurrentPipeline(GST_MESSAGE_SRC(message))) {
+                pipeline_manager->reportStartupTiming();
+                // From the error to the standby playing
+                if (const auto failover_start_ns = pipeline_manager->failover_start_ns_.exchange(0)) {
+                    const auto failover_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch() - std::chrono::nanoseconds(failover_start_ns));
+                    LOG_INFO("Failed over to the standby pipeline in {}us", failover_time.count());
+                    RECORD_EVENT(EventType::Failover, failover_time.count(), 0, GST_MESSAGE_SRC_NAME(message));
+                }
+            }
+            break;
+        }
         case GST_MESSAGE_EOS:
             LOG_DEBUG("End of stream");
+            RECORD_EVENT(EventType::BusMessage, GST_MESSAGE_EOS, 0, GST_MESSAGE_SRC_NAME(message));
             return pipeline_manager->stop() ? FALSE : TRUE;
         case GST_MESSAGE_ERROR:
             GError* err;
             gchar* debug;
             gst_message_parse_error(message, &err, &debug);
             LOG_ERROR("{}", err->message);
+            if (EventLog::getInstance().isEnabled()) {
+                EventLog::getInstance().record(EventType::BusMessage, GST_MESSAGE_ERROR, err->code,
+                                               fmt::format("{}: {}", GST_MESSAGE_SRC_NAME(message), err->message));
+            }
+            // A failed source is restarted on its own, the rest of the pipeline keeps running
+            if (pipeline_manager->recoverSource(GST_MESSAGE_SRC(message), err->message)) {
+                g_error_free(err);
+                g_free(debug);
+                return TRUE;
+            }
             g_error_free(err);
             g_free(debug);
+            // The failover removes the watch of the failed pipeline, the standby gets its own
+            if (pipeline_manager->postFailOver()) {
+                return TRUE;
+            }
+            pipeline_manager->stopped_on_error_ = true;
             return pipeline_manager->stop() ? FALSE : TRUE;
+        case GST_MESSAGE_WARNING: {
+            GError* warning;
+            gst_message_parse_warning(message, &warning, nullptr);
+            if (EventLog::getInstance().isEnabled()) {
+                EventLog::getInstance().record(EventType::BusMessage, GST_MESSAGE_WARNING, warning->code,
+                                               fmt::format("{}: {}", GST_MESSAGE_SRC_NAME(message), warning->message));
+            }
+            g_error_free(warning);
+            break;
+        }
         default:
             break;
     }
@@ -311,8 +946,12 @@ PipelineElement* PipelineManager::getNextEnabledElement(const PipelineElement& e
     return {};
 }
 
+// Called with mutex_ held
 std::error_code PipelineManager::enableOptionalElement(PipelineElement& element) {
-    std::lock_guard lock_guard(mutex_);
+    if (isProbePending(element.target_name)) {
+        LOG_WARN("A change of {} is still pending", element.toString());
+        return std::make_error_code(std::errc::device_or_resource_busy);
+    }
 
     if (auto ec = createGstElement(element)) {
         return ec;
@@ -322,41 +961,61 @@ std::error_code PipelineManager::enableOptionalElement(PipelineElement& element)
         return ec;
     }
 
+    RECORD_EVENT(EventType::Probe, static_cast<int64_t>(ProbeAction::ElementInserted), -1, element.target_name);
     return {};
 }
 
 GstPadProbeReturn PipelineManager::disconnectGstElementProbeCallback(GstPad* src_peer, GstPadProbeInfo* info, gpointer data) {
-    const auto pipeline_manager = static_cast<PipelineManager*>(data);
+    const auto& context = *static_cast<std::shared_ptr<ProbeContext>*>(data);
+    if (!context->claim(ProbeContext::State::Applying)) {
+        return GST_PAD_PROBE_REMOVE;
+    }
+
+    std::error_code ec;
+    {
+        const auto manager = context->manager;
+        std::lock_guard lock_guard(manager->mutex_);
+        if (!(ec = manager->disconnectGstElement(src_peer))) {
+            if (const auto element = manager->findOptionalElement(context->target)) {
+                manager->resetPipelineElement(*element);
+            }
+        }
+    }
+    context->manager->finishProbe(*context, ec);
+    return GST_PAD_PROBE_REMOVE;
+}
 
+// Removes the element downstream of the pad and links the pad to the element after it
+std::error_code PipelineManager::disconnectGstElement(GstPad* src_peer) const {
     const auto sink_pad = std::shared_ptr<GstPad>(gst_pad_get_peer(src_peer), gst_object_unref);
     if (!(sink_pad && GST_PAD_IS_SINK(sink_pad.get()))) {
         LOG_ERROR("Failed to get the sink_pad pad");
-        return GST_PAD_PROBE_REMOVE;
+        return std::make_error_code(std::errc::no_such_device);
     }
 
     const auto gst_element = std::shared_ptr<GstElement>(gst_pad_get_parent_element(sink_pad.get()), gst_object_unref);
     if (!(gst_element && GST_ELEMENT(gst_element.get()))) {
         LOG_ERROR("Failed to get element");
-        return GST_PAD_PROBE_REMOVE;
+        return std::make_error_code(std::errc::no_such_device);
     }
 
     const auto src_pad = std::shared_ptr<GstPad>(gst_element_get_static_pad(gst_element.get(), "src"), gst_object_unref);
     if (!src_pad) {
         LOG_TRACE("Element is a sink, no src pad to unlink");
         gst_element_set_state(gst_element.get(), GST_STATE_NULL);
-        gst_bin_remove(GST_BIN(pipeline_manager->gst_pipeline_.get()), gst_element.get());
-        return GST_PAD_PROBE_REMOVE;
+        gst_bin_remove(GST_BIN(gst_pipeline_.get()), gst_element.get());
+        return {};
     }
 
     if (!(src_pad && GST_PAD_IS_SRC(src_pad.get()))) {
         LOG_ERROR("Failed to get the src pad");
-        return GST_PAD_PROBE_REMOVE;
+        return std::make_error_code(std::errc::no_such_device);
     }
 
     const auto sink_peer = std::shared_ptr<GstPad>(gst_pad_get_peer(src_pad.get()), gst_object_unref);
     if (!(sink_peer && GST_PAD_IS_SINK(sink_peer.get()))) {
         LOG_ERROR("Failed to get the sink peer");
-        return GST_PAD_PROBE_REMOVE;
+        return std::make_error_code(std::errc::no_such_device);
     }
 
     gst_pad_unlink(src_peer, sink_pad.get());
@@ -365,55 +1024,206 @@ GstPadProbeReturn PipelineManager::disconnectGstElementProbeCallback(GstPad* src
     gst_pad_link(src_peer, sink_peer.get());
 
     gst_element_set_state(gst_element.get(), GST_STATE_NULL);
-    gst_bin_remove(GST_BIN(pipeline_manager->gst_pipeline_.get()), gst_element.get());
+    gst_bin_remove(GST_BIN(gst_pipeline_.get()), gst_element.get());
 
-    LOG_DEBUG("Element {} disconnected", gst_element_get_name(gst_element.get()));
-    return GST_PAD_PROBE_REMOVE;
+    LOG_DEBUG("Element {} disconnected", GST_ELEMENT_NAME(gst_element.get()));
+    RECORD_EVENT(EventType::Probe, static_cast<int64_t>(ProbeAction::ElementRemoved), -1,
+                 GST_ELEMENT_NAME(gst_element.get()));
+    return {};
 }
 
 GstPadProbeReturn PipelineManager::handleBranchDisconnectionCallback(GstPad* tee_src_pad, GstPadProbeInfo* info, gpointer data) {
-    const auto pipeline_manager = static_cast<PipelineManager*>(data);
-
-    // Get the peer pad to determine the first element of the branch
-    auto peer_sink_pad = gst_pad_get_peer(tee_src_pad);
-    if (!peer_sink_pad) {
-        LOG_ERROR("Failed to get peer pad for pad: {}", gst_pad_get_name(tee_src_pad));
+    const auto& context = *static_cast<std::shared_ptr<ProbeContext>*>(data);
+    if (!context->claim(ProbeContext::State::Applying)) {
         return GST_PAD_PROBE_REMOVE;
     }
 
-    auto first_element = gst_pad_get_parent_element(peer_sink_pad);
-    gst_object_unref(peer_sink_pad);
+    std::error_code ec;
+    {
+        const auto manager = context->manager;
+        std::lock_guard lock_guard(manager->mutex_);
+        // Get the peer pad to determine the first element of the branch
+        const auto peer_sink_pad = gst_pad_get_peer(tee_src_pad);
+        const auto first_element = peer_sink_pad ? gst_pad_get_parent_element(peer_sink_pad) : nullptr;
+        if (!peer_sink_pad) {
+            LOG_ERROR("Failed to get peer pad for pad: {}", gst_pad_get_name(tee_src_pad));
+            ec = std::make_error_code(std::errc::no_such_device);
+        } else if (!first_element) {
+            LOG_ERROR("Failed to get first element in the branch for pad: {}", gst_pad_get_name(tee_src_pad));
+            ec = std::make_error_code(std::errc::no_such_device);
+        } else {
+            LOG_DEBUG("Unlinking pad: {} from first element: {}", gst_pad_get_name(tee_src_pad), gst_element_get_name(first_element));
 
-    if (!first_element) {
-        LOG_ERROR("Failed to get first element in the branch for pad: {}", gst_pad_get_name(tee_src_pad));
+            // Unlink the pad from the first element
+            gst_element_set_state(first_element, GST_STATE_NULL);
+
+            if (!gst_pad_unlink(tee_src_pad, peer_sink_pad)) {
+                LOG_ERROR("Failed to unlink pad: {}", gst_pad_get_name(tee_src_pad));
+                ec = std::make_error_code(std::errc::io_error);
+            } else {
+                ec = manager->disconnectBranch(first_element);
+            }
+        }
+        if (first_element) {
+            gst_object_unref(first_element);
+        }
+        if (peer_sink_pad) {
+            gst_object_unref(peer_sink_pad);
+        }
+    }
+
+    context->manager->finishProbe(*context, ec);
+    return GST_PAD_PROBE_REMOVE;
+}
+
+GstPadProbeReturn PipelineManager::handleBranchConnectionCallback(GstPad* tee_sink_pad, GstPadProbeInfo* info, gpointer data) {
+    const auto& context = *static_cast<std::shared_ptr<ProbeContext>*>(data);
+    if (!context->claim(ProbeContext::State::Applying)) {
         return GST_PAD_PROBE_REMOVE;
     }
 
-    LOG_DEBUG("Unlinking pad: {} from first element: {}", gst_pad_get_name(tee_src_pad), gst_element_get_name(first_element));
+    std::error_code ec;
+    {
+        std::lock_guard lock_guard(context->manager->mutex_);
+        ec = context->manager->connectBranch(GST_PAD_PARENT(tee_sink_pad));
+    }
+    context->manager->finishProbe(*context, ec);
+    return GST_PAD_PROBE_REMOVE;
+}
 
-    // Unlink the pad from the first element
-    gst_element_set_state(first_element, GST_STATE_NULL);
+// The pad holds one reference to the context until the probe is removed
+void PipelineManager::destroyProbeContext(gpointer data) {
+    delete static_cast<std::shared_ptr<ProbeContext>*>(data);
+}
 
-    if (!gst_pad_unlink(tee_src_pad, peer_sink_pad)) {
-        LOG_ERROR("Failed to unlink pad: {}", gst_pad_get_name(tee_src_pad));
-        gst_object_unref(first_element);
-        return GST_PAD_PROBE_REMOVE;
+bool PipelineManager::isProbePending(const std::string_view target) const {
+    std::lock_guard lock(probes_mutex_);
+    return std::any_of(probes_.begin(), probes_.end(), [target](const auto& probe) { return probe->target == target; });
+}
+
+std::shared_ptr<PipelineManager::ProbeContext> PipelineManager::registerProbe(const ProbeContext::Kind kind, std::string target,
+                                                                              GstPad* pad, AsyncCompletion completion) {
+    auto context = std::make_shared<ProbeContext>(this, kind, std::move(target),
+                                                  std::shared_ptr<GstPad>(GST_PAD(gst_object_ref(pad)), gst_object_unref),
+                                                  std::move(completion));
+    std::lock_guard lock(probes_mutex_);
+    probes_.push_back(context);
+    return context;
+}
+
+// Called without mutex_ held, a requester that already gave up runs the abandon handler right away
+void PipelineManager::installProbe(const std::shared_ptr<ProbeContext>& context, const GstPadProbeType type,
+                                   const GstPadProbeCallback callback) {
+    context->probe_id = gst_pad_add_probe(context->pad.get(), type, callback,
+                                          new std::shared_ptr<ProbeContext>(context), destroyProbeContext);
+    // Cancelled before the id was known
+    if (context->state == ProbeContext::State::Cancelled) {
+        if (const auto probe_id = context->probe_id.exchange(0)) {
+            gst_pad_remove_probe(context->pad.get(), probe_id);
+        }
     }
 
-    pipeline_manager->disconnectBranch(first_element);
-    gst_object_unref(first_element);
+    context->completion.onAbandon([owner = probe_owner_, weak_context = std::weak_ptr<ProbeContext>(context)] {
+        const auto context = weak_context.lock();
+        std::lock_guard owner_lock(owner->mutex);
+        if (context && owner->manager) {
+            std::lock_guard lock(owner->manager->mutex_);
+            owner->manager->cancelProbe(*context);
+        }
+    });
+}
 
-    return GST_PAD_PROBE_REMOVE;
+void PipelineManager::unregisterProbe(const ProbeContext& context) {
+    {
+        std::lock_guard lock(probes_mutex_);
+        probes_.erase(std::remove_if(probes_.begin(), probes_.end(), [&context](const auto& probe) { return probe.get() == &context; }),
+                      probes_.end());
+    }
+    probes_condition_.notify_all();
 }
 
-GstPadProbeReturn PipelineManager::handleBranchConnectionCallback(GstPad* tee_sink_pad, GstPadProbeInfo* info, gpointer data) {
-    const auto pipeline_manager = static_cast<PipelineManager*>(data);
-    pipeline_manager->connectBranch(GST_PAD_PARENT(tee_sink_pad));
+// Streaming thread, after the probe claimed and applied the change
+void PipelineManager::finishProbe(ProbeContext& context, const std::error_code ec, const AppliedFrame* frame) {
+    unregisterProbe(context);
+    context.completion.complete(ec, frame);
+}
 
-    return GST_PAD_PROBE_REMOVE;
+// Called with mutex_ held. Removes the probe unless it already claimed the change, and removes the elements
+// created for the change again. False if the probe claimed the change first.
+bool PipelineManager::cancelProbe(ProbeContext& context) {
+    if (!context.claim(ProbeContext::State::Cancelled)) {
+        return false;
+    }
+    if (const auto probe_id = context.probe_id.exchange(0)) {
+        gst_pad_remove_probe(context.pad.get(), probe_id);
+    }
+    unregisterProbe(context);
+
+    const auto remove_unlinked = [this](PipelineElement& element) {
+        if (!element.is_initialized || element.is_linked) {
+            return;
+        }
+        // A mux is shared with other branches and stays in the pipeline
+        if (element.type != "mux") {
+            gst_element_set_state(element.gst_element, GST_STATE_NULL);
+            gst_bin_remove(GST_BIN(gst_pipeline_.get()), element.gst_element);
+        }
+        resetPipelineElement(element);
+    };
+    switch (context.kind) {
+        case ProbeContext::Kind::BranchConnection:
+            for (auto& element: pipeline_elements_) {
+                if (element.is_optional && element.branch == context.target) {
+                    remove_unlinked(element);
+                }
+            }
+            break;
+        case ProbeContext::Kind::FrameChange:
+            if (const auto element = findOptionalElement(context.target); element && context.enable) {
+                remove_unlinked(*element);
+            }
+            break;
+        case ProbeContext::Kind::ElementRemoval:
+        case ProbeContext::Kind::BranchDisconnection:
+            // Removals only change the elements once they are applied
+            break;
+    }
+
+    LOG_INFO("Removed the pending probe of {}", context.target);
+    RECORD_EVENT(EventType::Probe, static_cast<int64_t>(ProbeAction::Cancelled), -1, context.target);
+    context.completion.complete(std::make_error_code(std::errc::operation_canceled));
+    return true;
+}
+
+// Called with mutex_ held, returns the number of probes removed. Removing a probe doesn't need data to flow, so
+// changes waiting for a frame on a stalled pad are cancelled as well.
+size_t PipelineManager::cancelProbes() {
+    std::vector<std::shared_ptr<ProbeContext>> probes;
+    {
+        std::lock_guard probes_lock(probes_mutex_);
+        probes = probes_;
+    }
+    size_t cancelled = 0;
+    for (const auto& context: probes) {
+        cancelled += cancelProbe(*context) ? 1 : 0;
+    }
+    return cancelled;
+}
+
+// Called with mutex_ held. Probes that claimed their change before they could be cancelled wait for mutex_ to apply
+// it, so the lock is released until they are done. False if they did not finish in time.
+bool PipelineManager::waitForAppliedProbes(std::unique_lock<std::mutex>& lock) {
+    lock.unlock();
+    auto finished = false;
+    {
+        std::unique_lock probes_lock(probes_mutex_);
+        finished = probes_condition_.wait_for(probes_lock, BRANCH_REBUILD_TIMEOUT, [this] { return probes_.empty(); });
+    }
+    lock.lock();
+    return finished;
 }
 
-void PipelineManager::connectBranch(const GstElement* tee_element) {
+std::error_code PipelineManager::connectBranch(const GstElement* tee_element) {
     const auto tee = findPipelineElementByGstElement(tee_element);
     if (tee) {
         std::error_code ec;
@@ -430,17 +1240,20 @@ void PipelineManager::connectBranch(const GstElement* tee_element) {
             // FIXME: not reseting the elements in the branch that was created and linked
         } else {
             LOG_DEBUG("Branch {} is connected", tee->type);
+            RECORD_EVENT(EventType::Probe, static_cast<int64_t>(ProbeAction::BranchConnected), -1, tee->type);
         }
-    } else {
-        LOG_ERROR("Failed to get tee element for element: {}", gst_element_get_name(tee_element));
+        return ec;
     }
+
+    LOG_ERROR("Failed to get tee element for element: {}", gst_element_get_name(tee_element));
+    return std::make_error_code(std::errc::no_such_device);
 }
 
-void PipelineManager::disconnectBranch(const GstElement* gst_element) {
+std::error_code PipelineManager::disconnectBranch(const GstElement* gst_element) {
     auto pipeline_element = findPipelineElementByGstElement(gst_element);
     if (!pipeline_element) {
         LOG_ERROR("Failed to get pipeline element for gst element: {}", gst_element_get_name(gst_element));
-        return;
+        return std::make_error_code(std::errc::no_such_device);
     }
     for (auto element = pipeline_element; element->branch == pipeline_element->branch; element++) {
         LOG_DEBUG("Disconnecting element: {}", element->toString());
@@ -456,6 +1269,8 @@ void PipelineManager::disconnectBranch(const GstElement* gst_element) {
     }
 
     LOG_DEBUG("Branch {} is disconnected", pipeline_element->branch);
+    RECORD_EVENT(EventType::Probe, static_cast<int64_t>(ProbeAction::BranchDisconnected), -1, pipeline_element->branch);
+    return {};
 }
 
 void PipelineManager::disconnectMuxElement(PipelineElement& element) const {
@@ -510,41 +1325,8 @@ std::vector<GstPad*> PipelineManager::getLinkedSinkPads(GstElement* element) con
     return sink_pads;
 }
 
-std::error_code PipelineManager::disableOptionalElement(PipelineElement& element) const {
-    std::lock_guard lock_guard(mutex_);
-    LOG_DEBUG("Disabling element: {}", element.toString());
-
-    auto sink_pads = getLinkedSinkPads(element.gst_element);
-
-    if (sink_pads.size() == 0) {
-        LOG_ERROR("Failed to get sink pad for element {}", element.toString());
-        return {errno, std::generic_category()};
-    } else if (sink_pads.size() > 1) {
-        LOG_ERROR("Element {} has multiple sink pads ({}). This might have unexpected behaivior.", element.toString(), sink_pads.size());
-        return std::make_error_code(std::errc::invalid_argument);
-    }
-
-    auto sink_pad = sink_pads.front();
-    auto peer_pad = gst_pad_get_peer(sink_pad);
-
-    if (!peer_pad) {
-        LOG_ERROR("Failed to get src peer for element {}", element.toString());
-        return {errno, std::generic_category()};
-    }
-
-    // Add probe to disconnect element safely when idle
-    gst_pad_add_probe(peer_pad, GST_PAD_PROBE_TYPE_IDLE, disconnectGstElementProbeCallback,
-                        const_cast<PipelineManager*>(this), nullptr);
-
-    gst_object_unref(peer_pad);
-
-    element.is_initialized = false;
-    element.is_linked = false;
-
-    return {};
-}
-
 std::error_code PipelineManager::enableAllOptionalPipelineElements() {
+    std::lock_guard lock_guard(mutex_);
     for (auto& element: pipeline_elements_) {
         if (element.is_optional && !element.is_initialized && !element.is_linked) {
             if (auto ec = createGstElement(element)) {
@@ -565,88 +1347,349 @@ std::error_code PipelineManager::enableAllOptionalPipelineElements() {
 }
 
 std::error_code PipelineManager::disableAllOptionalPipelineElements() {
-    for (auto& element: pipeline_elements_) {
-        if (element.is_optional && element.is_linked) {
-            disableOptionalElement(element);
-        } else if (element.is_optional) {
-            LOG_WARN("Element {} is already disabled", element.toString());
+    std::vector<std::string> linked_elements;
+    {
+        std::lock_guard lock_guard(mutex_);
+        for (const auto& element: pipeline_elements_) {
+            if (element.is_optional && element.is_linked) {
+                linked_elements.push_back(element.target_name);
+            } else if (element.is_optional) {
+                LOG_WARN("Element {} is already disabled", element.toString());
+            }
         }
     }
+    for (const auto& element_name: linked_elements) {
+        disableOptionalPipelineElement(element_name);
+    }
     return {};
 }
 
 std::error_code PipelineManager::enableOptionalPipelineElement(const std::string& element_name) {
-    for (auto& element: pipeline_elements_) {
-        if (element.name == element_name) {
-            if (element.is_initialized && element.is_linked) {
-                LOG_WARN("Element {} is already enabled", element.toString());
-                return {errno, std::generic_category()};
-            }
-            return enableOptionalElement(element);
+    std::lock_guard lock_guard(mutex_);
+    if (const auto element = findOptionalElement(element_name)) {
+        if (element->is_initialized && element->is_linked) {
+            LOG_WARN("Element {} is already enabled", element->toString());
+            return {errno, std::generic_category()};
         }
+        return enableOptionalElement(*element);
     }
     return {errno, std::generic_category()};
 }
 
-std::error_code PipelineManager::disableOptionalPipelineElement(const std::string& element_name) {
-    for (auto& element: pipeline_elements_) {
-        if (element.name == element_name) {
-            if (!element.is_initialized && !element.is_linked) {
-                LOG_WARN("Element {} is already disabled", element.toString());
-                return {errno, std::generic_category()};
+std::error_code PipelineManager::disableOptionalPipelineElement(const std::string& element_name, AsyncCompletion completion) {
+    std::shared_ptr<ProbeContext> context;
+    {
+        std::lock_guard lock_guard(mutex_);
+        const auto element = findOptionalElement(element_name);
+        if (!element) {
+            return {errno, std::generic_category()};
+        }
+        if (!element->is_initialized && !element->is_linked) {
+            LOG_WARN("Element {} is already disabled", element->toString());
+            return {errno, std::generic_category()};
+        }
+        LOG_DEBUG("Disabling element: {}", element->toString());
+        if (isProbePending(element_name)) {
+            LOG_WARN("A change of {} is still pending", element->toString());
+            return std::make_error_code(std::errc::device_or_resource_busy);
+        }
+
+        auto sink_pads = getLinkedSinkPads(element->gst_element);
+
+        if (sink_pads.size() == 0) {
+            LOG_ERROR("Failed to get sink pad for element {}", element->toString());
+            return {errno, std::generic_category()};
+        } else if (sink_pads.size() > 1) {
+            LOG_ERROR("Element {} has multiple sink pads ({}). This might have unexpected behaivior.", element->toString(), sink_pads.size());
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+
+        auto sink_pad = sink_pads.front();
+        auto peer_pad = gst_pad_get_peer(sink_pad);
+
+        if (!peer_pad) {
+            LOG_ERROR("Failed to get src peer for element {}", element->toString());
+            return {errno, std::generic_category()};
+        }
+
+        // The element keeps its state until the probe callback removed it
+        context = registerProbe(ProbeContext::Kind::ElementRemoval, element_name, peer_pad, std::move(completion));
+        gst_object_unref(peer_pad);
+    }
+
+    // Add probe to disconnect element safely when idle
+    installProbe(context, GST_PAD_PROBE_TYPE_IDLE, disconnectGstElementProbeCallback);
+
+    return {};
+}
+
+bool PipelineManager::isFrameTriggered(GstPad* pad, GstBuffer* buffer, const FrameTrigger& trigger, AppliedFrame& frame) {
+    frame.pts = GST_BUFFER_PTS(buffer);
+    frame.running_time = GST_CLOCK_TIME_NONE;
+    if (auto segment_event = gst_pad_get_sticky_event(pad, GST_EVENT_SEGMENT, 0)) {
+        const GstSegment* segment;
+        gst_event_parse_segment(segment_event, &segment);
+        if (segment->format == GST_FORMAT_TIME && GST_CLOCK_TIME_IS_VALID(frame.pts)) {
+            frame.running_time = gst_segment_to_running_time(segment, GST_FORMAT_TIME, frame.pts);
+        }
+        gst_event_unref(segment_event);
+    }
+
+    switch (trigger.kind) {
+        case FrameTrigger::Kind::NextKeyframe:
+            return !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+        case FrameTrigger::Kind::Pts:
+            return GST_CLOCK_TIME_IS_VALID(frame.pts) && frame.pts >= trigger.time;
+        case FrameTrigger::Kind::RunningTime:
+            return GST_CLOCK_TIME_IS_VALID(frame.running_time) && frame.running_time >= trigger.time;
+    }
+
+    return false;
+}
+
+// Runs in the streaming thread for every buffer until the trigger matches, the change is then applied
+// before that buffer is pushed to the peer, so the buffer already takes the new path. The element is looked
+// up by its target under mutex_, the elements list may have been replaced since the probe was installed.
+GstPadProbeReturn PipelineManager::handleFrameTriggerCallback(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
+    const auto& context = *static_cast<std::shared_ptr<ProbeContext>*>(data);
+    if (context->state != ProbeContext::State::Pending) {
+        return GST_PAD_PROBE_REMOVE;
+    }
+
+    // A list triggers on any of its buffers, the change then applies to the whole list and reports that buffer
+    AppliedFrame frame;
+    auto triggered = false;
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        const auto buffer_list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+        const auto length = gst_buffer_list_length(buffer_list);
+        for (guint i = 0; i < length && !triggered; ++i) {
+            triggered = isFrameTriggered(pad, gst_buffer_list_get(buffer_list, i), context->trigger, frame);
+        }
+    } else if (const auto buffer = GST_PAD_PROBE_INFO_BUFFER(info)) {
+        triggered = isFrameTriggered(pad, buffer, context->trigger, frame);
+    }
+    if (!triggered) {
+        return GST_PAD_PROBE_OK;
+    }
+    if (!context->claim(ProbeContext::State::Applying)) {
+        return GST_PAD_PROBE_REMOVE;
+    }
+
+    std::error_code ec;
+    {
+        const auto manager = context->manager;
+        std::lock_guard lock_guard(manager->mutex_);
+        const auto element = manager->findOptionalElement(context->target);
+        if (!element) {
+            ec = std::make_error_code(std::errc::no_such_device);
+        } else if (context->enable) {
+            if (!(ec = insertGstElement(pad, *element))) {
+                RECORD_EVENT(EventType::Probe, static_cast<int64_t>(ProbeAction::ElementInserted),
+                             static_cast<int64_t>(frame.pts), context->target);
             }
-            return disableOptionalElement(element);
+        } else if (!(ec = manager->disconnectGstElement(pad))) {
+            manager->resetPipelineElement(*element);
         }
+        LOG_DEBUG("{} {} at pts {} running time {}", context->enable ? "Enabled" : "Disabled", context->target,
+                  frame.pts, frame.running_time);
     }
-    return {errno, std::generic_category()};
+
+    context->manager->finishProbe(*context, ec, &frame);
+    return GST_PAD_PROBE_REMOVE;
 }
 
-std::error_code PipelineManager::enableOptionalPipelineBranch(const std::string& branch_name) {
-    for (auto& element: pipeline_elements_) {
-        if (element.is_optional && !element.is_initialized && !element.is_linked && element.branch == branch_name) {
-            if (auto ec = createGstElement(element)) {
+std::error_code PipelineManager::enableOptionalPipelineElementAt(const std::string& element_name, const FrameTrigger trigger,
+                                                                 AsyncCompletion completion) {
+    std::shared_ptr<ProbeContext> context;
+    {
+        std::lock_guard lock_guard(mutex_);
+        const auto element = findOptionalElement(element_name);
+        if (!element) {
+            return std::make_error_code(std::errc::no_such_device);
+        }
+        if (isProbePending(element_name)) {
+            LOG_WARN("A change of {} is still pending", element->toString());
+            return std::make_error_code(std::errc::device_or_resource_busy);
+        }
+        if (element->is_linked) {
+            LOG_WARN("Element {} is already enabled", element->toString());
+            return std::make_error_code(std::errc::already_connected);
+        }
+
+        const auto prev_element = getPreviousEnabledElement(*element);
+        const auto next_element = getNextEnabledElement(*element);
+        if (!prev_element || !next_element || prev_element->branch != element->branch || next_element->branch != element->branch) {
+            LOG_ERROR("Frame triggered enabling of {} needs enabled elements on both sides in its branch", element->toString());
+            return std::make_error_code(std::errc::not_supported);
+        }
+
+        const auto src_pad = std::shared_ptr<GstPad>(findLinkedSrcPad(prev_element->gst_element, next_element->gst_element),
+                                                     [](GstPad* pad) { if (pad) gst_object_unref(pad); });
+        if (!src_pad) {
+            LOG_ERROR("{} is not linked to {}", prev_element->toString(), next_element->toString());
+            return std::make_error_code(std::errc::not_connected);
+        }
+
+        if (!element->is_initialized) {
+            if (auto ec = createGstElement(*element)) {
                 return ec;
             }
         }
+
+        context = registerProbe(ProbeContext::Kind::FrameChange, element_name, src_pad.get(), std::move(completion));
+        context->enable = true;
+        context->trigger = trigger;
     }
-    auto tee_element = findTeeElementForBranch(branch_name);
-    auto tee_sink_pad = findGstPadByName(tee_element.gst_element, "sink");
-    if (!tee_sink_pad) {
-        LOG_ERROR("Failed to get sink pad for tee element {}", tee_element.toString());
-        return {errno, std::generic_category()};
+
+    installProbe(context, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                 handleFrameTriggerCallback);
+
+    return {};
+}
+
+std::error_code PipelineManager::disableOptionalPipelineElementAt(const std::string& element_name, const FrameTrigger trigger,
+                                                                  AsyncCompletion completion) {
+    std::shared_ptr<ProbeContext> context;
+    {
+        std::lock_guard lock_guard(mutex_);
+        const auto element = findOptionalElement(element_name);
+        if (!element) {
+            return std::make_error_code(std::errc::no_such_device);
+        }
+        if (isProbePending(element_name)) {
+            LOG_WARN("A change of {} is still pending", element->toString());
+            return std::make_error_code(std::errc::device_or_resource_busy);
+        }
+        if (!element->is_linked) {
+            LOG_WARN("Element {} is already disabled", element->toString());
+            return std::make_error_code(std::errc::not_connected);
+        }
+
+        const auto sink_pads = getLinkedSinkPads(element->gst_element);
+        if (sink_pads.size() != 1) {
+            LOG_ERROR("Frame triggered disabling of {} needs exactly one linked sink pad, found {}", element->toString(), sink_pads.size());
+            return std::make_error_code(std::errc::not_supported);
+        }
+
+        const auto src_peer = std::shared_ptr<GstPad>(gst_pad_get_peer(sink_pads.front()), [](GstPad* pad) { if (pad) gst_object_unref(pad); });
+        if (!src_peer) {
+            LOG_ERROR("Failed to get src peer for element {}", element->toString());
+            return std::make_error_code(std::errc::not_connected);
+        }
+
+        context = registerProbe(ProbeContext::Kind::FrameChange, element_name, src_peer.get(), std::move(completion));
+        context->enable = false;
+        context->trigger = trigger;
+    }
+
+    installProbe(context, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                 handleFrameTriggerCallback);
+
+    return {};
+}
+
+std::error_code PipelineManager::enableOptionalPipelineBranch(const std::string& branch_name, AsyncCompletion completion) {
+    std::shared_ptr<ProbeContext> context;
+    {
+        std::lock_guard lock_guard(mutex_);
+        if (isProbePending(branch_name)) {
+            LOG_WARN("A change of branch {} is still pending", branch_name);
+            return std::make_error_code(std::errc::device_or_resource_busy);
+        }
+        for (auto& element: pipeline_elements_) {
+            if (element.is_optional && !element.is_initialized && !element.is_linked && element.branch == branch_name) {
+                if (auto ec = createGstElement(element)) {
+                    return ec;
+                }
+            }
+        }
+        auto& tee_element = findTeeElementForBranch(branch_name);
+        auto tee_sink_pad = findGstPadByName(tee_element.gst_element, "sink");
+        if (!tee_sink_pad) {
+            LOG_ERROR("Failed to get sink pad for tee element {}", tee_element.toString());
+            return {errno, std::generic_category()};
+        }
+        context = registerProbe(ProbeContext::Kind::BranchConnection, branch_name, tee_sink_pad, std::move(completion));
     }
 
-    gst_pad_add_probe(tee_sink_pad, GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM, handleBranchConnectionCallback, this, nullptr);
+    installProbe(context, GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM, handleBranchConnectionCallback);
 
     return {};
 }
 
-std::error_code PipelineManager::disableOptionalPipelineBranch(const std::string& branch_name) {
+std::error_code PipelineManager::disableOptionalPipelineBranch(const std::string& branch_name, AsyncCompletion completion) {
     LOG_TRACE("Disabling branch: {}", branch_name);
-    auto tee = findTeeElementForBranch(branch_name);
-    auto first_element = findFirstElementInBranch(branch_name);
-    if (first_element.is_optional && first_element.is_linked && first_element.branch == branch_name) {
-        auto tee_src_pad = findLinkedSrcPad(tee.gst_element, first_element.gst_element);
-        gst_pad_add_probe(tee_src_pad, GST_PAD_PROBE_TYPE_IDLE, handleBranchDisconnectionCallback, this, nullptr);
-    } else {
-        LOG_WARN("Branch {} is already disabled", branch_name);
-        LOG_WARN("optional {}, linked {}, equal_branch? {}",first_element.is_optional, first_element.is_linked, first_element.branch == branch_name);
+    std::shared_ptr<ProbeContext> context;
+    {
+        std::lock_guard lock_guard(mutex_);
+        if (isProbePending(branch_name)) {
+            LOG_WARN("A change of branch {} is still pending", branch_name);
+            return std::make_error_code(std::errc::device_or_resource_busy);
+        }
+        const auto& tee = findTeeElementForBranch(branch_name);
+        const auto& first_element = findFirstElementInBranch(branch_name);
+        if (first_element.is_optional && first_element.is_linked && first_element.branch == branch_name) {
+            const auto tee_src_pad = std::shared_ptr<GstPad>(findLinkedSrcPad(tee.gst_element, first_element.gst_element),
+                                                             [](GstPad* pad) { if (pad) gst_object_unref(pad); });
+            if (!tee_src_pad) {
+                LOG_ERROR("Branch {} is not linked to {}", branch_name, tee.toString());
+                return std::make_error_code(std::errc::not_connected);
+            }
+            context = registerProbe(ProbeContext::Kind::BranchDisconnection, branch_name, tee_src_pad.get(), std::move(completion));
+        } else {
+            LOG_WARN("Branch {} is already disabled", branch_name);
+            LOG_WARN("optional {}, linked {}, equal_branch? {}",first_element.is_optional, first_element.is_linked, first_element.branch == branch_name);
+        }
+    }
+
+    if (!context) {
+        completion.complete({});
+        return {};
     }
+    installProbe(context, GST_PAD_PROBE_TYPE_IDLE, handleBranchDisconnectionCallback);
 
     return {};
 }
 
 std::vector<std::string> PipelineManager::getOptionalPipelineElementsNames() const {
+    std::lock_guard lock_guard(mutex_);
     std::vector<std::string> elements_names;
     for (const auto& element: pipeline_elements_) {
         if (element.is_optional) {
-            elements_names.push_back(element.name);
+            elements_names.push_back(element.target_name);
         }
     }
     return elements_names;
 }
 
+// Optional elements are addressed by their name, or by their unique gst name when the name is not unique
+void PipelineManager::assignTargetNames(std::vector<PipelineElement>& elements) const {
+    std::unordered_map<std::string, size_t> name_counts;
+    for (const auto& element: elements) {
+        if (element.is_optional) {
+            ++name_counts[element.name];
+        }
+    }
+    for (auto& element: elements) {
+        if (element.is_optional) {
+            element.target_name = name_counts[element.name] > 1 ? generateGstElementUniqueName(element) : element.name;
+        }
+    }
+}
+
+// Called with mutex_ held
+PipelineElement* PipelineManager::findOptionalElement(const std::string_view target_name) {
+    for (auto& element: pipeline_elements_) {
+        if (element.is_optional && element.target_name == target_name) {
+            return &element;
+        }
+    }
+    LOG_ERROR("No optional element {}", target_name);
+    return nullptr;
+}
+
 std::vector<std::string> PipelineManager::getOptionalPipelineBranchesNames() const {
+    std::lock_guard lock_guard(mutex_);
     std::vector<std::string> branches_names;
     std::unordered_set<std::string> unique_branches;
     for (const auto& element: pipeline_elements_) {
@@ -667,10 +1710,286 @@ PipelineElement* PipelineManager::findPipelineElementByGstElement(const GstEleme
     return nullptr;
 }
 
-void PipelineManager::createElementsList(const std::string& file_path) {
-    const auto pipeline_handler = std::make_unique<PipelineParser>(file_path);
-    LOG_DEBUG("Use pipeline from: {}", file_path);
-    pipeline_elements_ = pipeline_handler->getAllElements();
+void PipelineManager::createElementsList(const std::string& file_path, const std::string& instance_name) {
+    const auto start_time = std::chrono::steady_clock::now();
+    plan_loaded_ = false;
+    if (plan_cache_ && PlanCache::hashPipelineFile(file_path, instance_name, pipeline_file_hash_)) {
+        plan_loaded_ = plan_cache_->load(file_path, instance_name, pipeline_file_hash_, pipeline_elements_,
+                                         startup_settings_);
+    }
+
+    if (!plan_loaded_) {
+        const auto pipeline_handler = std::make_unique<PipelineParser>(file_path);
+        pipeline_elements_ = pipeline_handler->getAllElements(instance_name);
+        startup_settings_ = {pipeline_handler->getGstDebugThresholds(), pipeline_handler->getSchedules()};
+    }
+    assignTargetNames(pipeline_elements_);
+    LOG_DEBUG("Use pipeline from: {} {} ({} in {}us)", file_path, instance_name,
+              plan_loaded_ ? "plan cache" : "parsed",
+              std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count());
+}
+
+namespace {
+// Linked part of a branch, the tuple holds the gst name, factory, type and sink pad of each element
+using BranchSkeleton = std::vector<std::tuple<std::string, std::string, std::string, std::string>>;
+}
+
+std::error_code PipelineManager::reloadPipeline(ReloadResult& result) {
+    const auto ec = applyPipelineReload(result);
+    // The standby was built from the previous content of the file
+    if (!ec && gst_loop_ && standby_state_ != GST_STATE_VOID_PENDING) {
+        startStandbyBuild();
+    }
+    return ec;
+}
+
+std::error_code PipelineManager::applyPipelineReload(ReloadResult& result) {
+    std::vector<PipelineElement> next_elements;
+    try {
+        next_elements = PipelineParser(pipeline_file_).getAllElements(instance_name_);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to parse pipeline file {}: {}", pipeline_file_, e.what());
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    if (next_elements.empty()) {
+        LOG_ERROR("Pipeline file {} has no elements", pipeline_file_);
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    assignTargetNames(next_elements);
+
+    // Runs on the pipeline strand, so no other change starts while the lock is released below for probe callbacks
+    // and streaming threads. Pending changes target the elements being replaced and are cancelled.
+    std::unique_lock lock(mutex_);
+    result.cancelled_changes = cancelProbes();
+    if (result.cancelled_changes != 0) {
+        LOG_INFO("Cancelled {} pending changes before reloading", result.cancelled_changes);
+    }
+    if (!waitForAppliedProbes(lock)) {
+        LOG_WARN("Not reloading while changes are still being applied");
+        return std::make_error_code(std::errc::device_or_resource_busy);
+    }
+    if (!gst_loop_) {
+        pipeline_elements_ = std::move(next_elements);
+        return {};
+    }
+
+    // Match the new elements to the live ones by branch and gst name
+    std::unordered_map<std::string, PipelineElement*> live_elements;
+    for (auto& element: pipeline_elements_) {
+        if (element.is_initialized) {
+            live_elements.emplace(element.branch + '/' + generateGstElementUniqueName(element), &element);
+        }
+    }
+    std::vector<PipelineElement*> matches;
+    for (const auto& element: next_elements) {
+        const auto match = live_elements.find(element.branch + '/' + generateGstElementUniqueName(element));
+        matches.push_back(match != live_elements.end() ? match->second : nullptr);
+    }
+
+    std::vector<std::string> branches;
+    for (const auto& elements: {&pipeline_elements_, &next_elements}) {
+        for (const auto& element: *elements) {
+            if (std::find(branches.begin(), branches.end(), element.branch) == branches.end()) {
+                branches.push_back(element.branch);
+            }
+        }
+    }
+
+    // A branch keeps running if its linked elements stay the same and their property changes can be set while
+    // playing. New optional elements start disabled, so they don't change the linked part.
+    std::unordered_set<std::string> rebuilt_branches;
+    std::vector<std::vector<std::string>> property_changes(next_elements.size());
+    for (const auto& branch: branches) {
+        BranchSkeleton live_skeleton;
+        for (const auto& element: pipeline_elements_) {
+            if (element.branch == branch && element.is_initialized) {
+                live_skeleton.emplace_back(generateGstElementUniqueName(element), element.name, element.type, element.sink_pad_name);
+            }
+        }
+        BranchSkeleton next_skeleton;
+        auto properties_updatable = true;
+        for (size_t i = 0; i < next_elements.size(); ++i) {
+            const auto& element = next_elements[i];
+            if (element.branch == branch && (!element.is_optional || matches[i])) {
+                next_skeleton.emplace_back(generateGstElementUniqueName(element), element.name, element.type, element.sink_pad_name);
+                if (matches[i] && !planPropertyUpdates(*matches[i], element, property_changes[i])) {
+                    properties_updatable = false;
+                }
+            }
+        }
+
+        if (live_skeleton == next_skeleton && properties_updatable) {
+            continue;
+        }
+        if (!isOptionalBranch(pipeline_elements_, branch) || !isOptionalBranch(next_elements, branch)) {
+            LOG_INFO("Branch {} changed, rebuilding the pipeline", branch);
+            result.rebuilt_pipeline = true;
+            return rebuildGstPipeline(std::move(next_elements), lock);
+        }
+        rebuilt_branches.insert(branch);
+    }
+
+    std::vector<std::string> reconnected_branches;
+    for (const auto& branch: rebuilt_branches) {
+        LOG_INFO("Optional branch {} changed, rebuilding it", branch);
+        if (findFirstElementInBranch(branch).is_linked) {
+            reconnected_branches.push_back(branch);
+        }
+        result.rebuilt_branches.push_back(branch);
+    }
+    // The disconnection is applied by a probe callback, which takes the lock
+    lock.unlock();
+    for (const auto& branch: reconnected_branches) {
+        if (auto ec = disconnectBranchAndWait(branch)) {
+            LOG_ERROR("Failed to disconnect branch {} for rebuilding: {}", branch, ec.message());
+            return ec;
+        }
+    }
+    lock.lock();
+
+    // Live elements of the unchanged branches carry over, everything else starts disabled
+    for (size_t i = 0; i < next_elements.size(); ++i) {
+        auto& element = next_elements[i];
+        const auto live_element = matches[i];
+        if (!live_element || !live_element->is_initialized || rebuilt_branches.count(element.branch)) {
+            continue;
+        }
+        element.gst_element = live_element->gst_element;
+        element.is_initialized = live_element->is_initialized;
+        element.is_linked = live_element->is_linked;
+        updateGstElementProperties(element, live_element->properties, property_changes[i]);
+        result.updated_properties += property_changes[i].size();
+    }
+    pipeline_elements_ = std::move(next_elements);
+    lock.unlock();
+
+    for (const auto& branch: reconnected_branches) {
+        if (auto ec = enableOptionalPipelineBranch(branch)) {
+            LOG_ERROR("Failed to connect rebuilt branch {}: {}", branch, ec.message());
+            return ec;
+        }
+    }
+
+    LOG_INFO("Pipeline reloaded, {} properties updated, {} branches rebuilt", result.updated_properties,
+             result.rebuilt_branches.size());
+    return {};
+}
+
+// Collects the properties that differ (the name identifies the element), false if one of them can't be
+// changed on the live element
+bool PipelineManager::planPropertyUpdates(const PipelineElement& live_element, const PipelineElement& next_element,
+                                          std::vector<std::string>& changed_keys) const {
+    changed_keys.clear();
+    for (const auto& [key, value]: next_element.properties) {
+        const auto live_property = live_element.properties.find(key);
+        if (key != "name" && (live_property == live_element.properties.end() || live_property->second != value)) {
+            changed_keys.push_back(key);
+        }
+    }
+    for (const auto& [key, value]: live_element.properties) {
+        if (key != "name" && next_element.properties.find(key) == next_element.properties.end()) {
+            changed_keys.push_back(key);
+        }
+    }
+
+    for (const auto& key: changed_keys) {
+        const auto param_spec = g_object_class_find_property(G_OBJECT_GET_CLASS(live_element.gst_element), key.c_str());
+        if (PipelineChannel::isChannelProperty(live_element.name, key)) {
+            LOG_DEBUG("Channel of {} can't change while playing", live_element.toString());
+            return false;
+        }
+        if (!param_spec) {
+            continue; // Dropped with a warning when applied
+        }
+        const auto flags = param_spec->flags;
+        const auto only_mutable_when_stopped = (flags & (GST_PARAM_MUTABLE_READY | GST_PARAM_MUTABLE_PAUSED)) &&
+                                               !(flags & GST_PARAM_MUTABLE_PLAYING);
+        if (!(flags & G_PARAM_WRITABLE) || (flags & G_PARAM_CONSTRUCT_ONLY) || only_mutable_when_stopped) {
+            LOG_DEBUG("Property {} of {} can't change while playing", key, live_element.toString());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sets the changed properties, properties removed from the file go back to their default value
+void PipelineManager::updateGstElementProperties(PipelineElement& element,
+                                                 const std::map<std::string, std::string>& previous_properties,
+                                                 const std::vector<std::string>& changed_keys) const {
+    validateGstElementProperties(element, G_OBJECT_GET_CLASS(element.gst_element));
+    for (const auto& key: changed_keys) {
+        if (const auto property = element.properties.find(key); property != element.properties.end()) {
+            gst_util_set_object_arg(G_OBJECT(element.gst_element), key.c_str(), property->second.c_str());
+            LOG_DEBUG("Set property {} to {} for element {}", key, property->second, element.toString());
+        } else if (previous_properties.count(key)) {
+            const auto param_spec = g_object_class_find_property(G_OBJECT_GET_CLASS(element.gst_element), key.c_str());
+            GValue value = G_VALUE_INIT;
+            g_value_init(&value, G_PARAM_SPEC_VALUE_TYPE(param_spec));
+            g_param_value_set_default(param_spec, &value);
+            g_object_set_property(G_OBJECT(element.gst_element), key.c_str(), &value);
+            g_value_unset(&value);
+            LOG_DEBUG("Reset property {} for element {}", key, element.toString());
+        }
+    }
+}
+
+// Called without mutex_ held
+std::error_code PipelineManager::disconnectBranchAndWait(const std::string& branch_name) {
+    const auto disconnected = std::make_shared<std::promise<std::error_code>>();
+    auto result = disconnected->get_future();
+    if (auto ec = disableOptionalPipelineBranch(branch_name, {[disconnected](const std::error_code ec, const AppliedFrame*) {
+                                                                  disconnected->set_value(ec);
+                                                              }, {}})) {
+        return ec;
+    }
+
+    // A pending disconnection still completes later, leaving the branch disabled
+    if (result.wait_for(BRANCH_REBUILD_TIMEOUT) != std::future_status::ready) {
+        return std::make_error_code(std::errc::timed_out);
+    }
+    return result.get();
+}
+
+// Called with mutex_ held. Replaces every element of the running pipeline, the bus watch and the main loop are
+// kept. The lock is released while the pipeline changes state, which waits for its streaming threads.
+// Called with mutex_ held on the pipeline strand. The new elements are built into a pipeline of their own while the
+// running one keeps playing, so a failed build leaves it untouched. Once built, it replaces the running pipeline
+// like a standby taking over.
+std::error_code PipelineManager::rebuildGstPipeline(std::vector<PipelineElement> elements, std::unique_lock<std::mutex>& lock) {
+    auto running_pipeline = std::move(gst_pipeline_);
+    auto running_elements = std::move(pipeline_elements_);
+    gst_pipeline_ = std::shared_ptr<GstElement>(gst_pipeline_new("runtime-control-pipeline"), gst_object_unref);
+    pipeline_elements_ = std::move(elements);
+    std::error_code ec;
+    if (!GST_IS_ELEMENT(gst_pipeline_.get())) {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    } else {
+        ec = createGstPipeline(pipeline_elements_);
+    }
+    if (ec) {
+        LOG_ERROR("Failed to rebuild pipeline, keeping the running one: {}", ec.message());
+        gst_pipeline_ = std::move(running_pipeline);
+        pipeline_elements_ = std::move(running_elements);
+        return ec;
+    }
+
+    detachSourceRecoveries();
+    if (const auto bus_watch = bus_watch_id_ ? g_main_context_find_source_by_id(nullptr, bus_watch_id_) : nullptr) {
+        g_source_destroy(bus_watch);
+    }
+    lock.unlock();
+    gst_element_set_state(running_pipeline.get(), GST_STATE_NULL);
+    running_pipeline.reset();
+    running_elements.clear();
+    lock.lock();
+
+    attachSourceRecoveries();
+    const auto bus = std::shared_ptr<GstBus>(gst_element_get_bus(gst_pipeline_.get()), gst_object_unref);
+    bus_watch_id_ = gst_bus_add_watch(bus.get(), handlePupelineBusSignal, this);
+    lock.unlock();
+    gst_element_set_state(gst_pipeline_.get(), GST_STATE_PLAYING);
+    LOG_INFO("Pipeline rebuilt");
+    return {};
 }
 
 PipelineElement& PipelineManager::findTeeElementForBranch(const std::string& branch_name) {
@@ -780,7 +2099,19 @@ std::string PipelineManager::generateDynamicPadName(const GstPadTemplate* pad_te
 GstPad* PipelineManager::requestPad(PipelineElement& element, GstPadDirection direction) {
     GstPad* pad {};
 
-    auto pad_template = findSuitablePadTemplate(element, direction);
+    // The template chosen before, possibly by a previous run through the plan cache
+    auto& chosen_template = direction == GST_PAD_SRC ? element.src_pad_template : element.sink_pad_template;
+    GstPadTemplate* pad_template {};
+    if (!chosen_template.empty()) {
+        pad_template = gst_element_class_get_pad_template(GST_ELEMENT_GET_CLASS(element.gst_element),
+                                                          chosen_template.c_str());
+    }
+    if (!pad_template) {
+        pad_template = findSuitablePadTemplate(element, direction);
+    }
+    if (pad_template) {
+        chosen_template = GST_PAD_TEMPLATE_NAME_TEMPLATE(pad_template);
+    }
     std::string generatedPadName {};
 
     if (pad_template) {
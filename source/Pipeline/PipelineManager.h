@@ -1,52 +1,219 @@
 #ifndef PIPELINEMANAGER_H
 #define PIPELINEMANAGER_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
 #include <vector>
 #include <mutex>
+#include <optional>
+#include <string_view>
+#include <system_error>
 #include <gst/gst.h>
 #include "Pipeline/PipelineElement.h"
+#include "Pipeline/PlanCache.h"
+#include "Pipeline/PluginPreloader.h"
+#include "Pipeline/SourceRecovery.h"
+
+// Startup behaviour of a PipelineManager
+struct PipelineStartupOptions {
+    // The resolved element list is loaded from this cache when it is still valid, and stored after the
+    // pipeline was built otherwise
+    std::filesystem::path plan_cache_directory;
+    // Private GStreamer registry cache, once it exists plugin directories are no longer scanned
+    std::filesystem::path registry_file;
+    // Load the plugins of all elements, optional ones included, in the background while the application starts
+    bool preload_plugins{false};
+    // Create and link the mandatory elements from one generated gst_parse_launch description when they
+    // can be described, otherwise they are built element by element
+    bool use_launch_description{true};
+    // State of a prebuilt standby pipeline that takes over on a pipeline error, GST_STATE_VOID_PENDING disables
+    // it. NULL only creates and links the elements, READY also opens devices and PAUSED prerolls non-live sources
+    GstState standby_state{GST_STATE_VOID_PENDING};
+    // The standby is dropped when building it grew the resident memory by more than this
+    size_t standby_max_memory_mb{256};
+    // Called once from the bus thread when the pipeline first reached PLAYING
+    std::function<void()> on_playing;
+    // Sources that fail or end are restarted while the rest of the pipeline keeps running
+    SourceRecoveryOptions source_recovery;
+    // Runs a task on the strand of the given key, false when it could not be queued. A failover goes through it to
+    // run between the commands of the pipeline, without an executor it runs on the bus thread.
+    std::function<bool(size_t strand_key, std::function<void()> task)> strand_executor;
+};
 
 class PipelineManager {
 public:
-    explicit PipelineManager(std::string pipeline_file);
+    // Buffer at which a frame triggered change is applied
+    struct FrameTrigger {
+        enum class Kind {
+            RunningTime,
+            Pts,
+            NextKeyframe
+        };
+        Kind kind{Kind::NextKeyframe};
+        GstClockTime time{GST_CLOCK_TIME_NONE};
+    };
+    // Timestamps of the buffer a frame triggered change took effect on
+    struct AppliedFrame {
+        GstClockTime pts{GST_CLOCK_TIME_NONE};
+        GstClockTime running_time{GST_CLOCK_TIME_NONE};
+    };
+    // Outcome of a change applied later from a pad probe. Once a call accepting it returned success the
+    // completion is invoked exactly once, possibly before the call returns. The probe is handed a handler
+    // through on_abandon, a requester that gives up runs it to remove the probe and complete with
+    // operation_canceled.
+    struct AsyncCompletion {
+        std::function<void(std::error_code, const AppliedFrame*)> on_complete;
+        std::function<void(std::function<void()>)> on_abandon;
+        void complete(const std::error_code ec, const AppliedFrame* frame = nullptr) const { if (on_complete) on_complete(ec, frame); }
+        void onAbandon(std::function<void()> handler) const { if (on_abandon) on_abandon(std::move(handler)); }
+    };
+    // Changes a reload of the pipeline file applied to the running pipeline
+    struct ReloadResult {
+        size_t updated_properties{0};
+        std::vector<std::string> rebuilt_branches;
+        bool rebuilt_pipeline{false};
+        // Pending changes of the replaced elements that were cancelled
+        size_t cancelled_changes{0};
+    };
+    // The instance selects one instance of a template pipeline file
+    explicit PipelineManager(std::string pipeline_file, std::string instance_name = {}, PipelineStartupOptions options = {});
     ~PipelineManager();
+    // Blocks until the pipeline stopped. invalid_argument when it could not be built, io_error when it stopped on an
+    // error no source recovery or failover handled.
     std::error_code play();
     std::error_code stop() const;
     std::error_code enableOptionalPipelineElement(const std::string& element_name);
-    std::error_code disableOptionalPipelineElement(const std::string& element_name);
-    std::error_code enableOptionalPipelineBranch(const std::string& branch_name);
-    std::error_code disableOptionalPipelineBranch(const std::string& branch_name);
+    std::error_code disableOptionalPipelineElement(const std::string& element_name, AsyncCompletion completion = {});
+    std::error_code enableOptionalPipelineElementAt(const std::string& element_name, FrameTrigger trigger,
+                                                    AsyncCompletion completion = {});
+    std::error_code disableOptionalPipelineElementAt(const std::string& element_name, FrameTrigger trigger,
+                                                     AsyncCompletion completion = {});
+    std::error_code enableOptionalPipelineBranch(const std::string& branch_name, AsyncCompletion completion = {});
+    std::error_code disableOptionalPipelineBranch(const std::string& branch_name, AsyncCompletion completion = {});
     std::error_code enableAllOptionalPipelineElements();
     std::error_code disableAllOptionalPipelineElements();
     std::error_code enableAllOptionalPipelineBranches();
     std::error_code disableAllOptionalPipelineBranches();
     std::vector<std::string> getOptionalPipelineElementsNames() const;
     std::vector<std::string> getOptionalPipelineBranchesNames() const;
+    // gst_debug thresholds and schedules of the pipeline file, from the plan cache when it is valid
+    const PlanSettings& getStartupSettings() const { return startup_settings_; }
+    // Strand the commands of this pipeline run on
+    size_t getStrandKey() const { return reinterpret_cast<uintptr_t>(this); }
+    // Re-reads the pipeline file and applies only the difference: changed properties are set on the live
+    // elements and optional elements that are not linked are replaced. Optional branches whose linked
+    // elements changed are disconnected and connected again, any other change rebuilds the whole pipeline
+    // in place. Elements are matched by their gst name, so give elements a name property to keep them
+    // live when elements before them are added or removed.
+    std::error_code reloadPipeline(ReloadResult& result);
+    // Makes gst_init use a private registry file, true when it exists and the plugin directories won't be scanned
+    static bool configureRegistry(const std::filesystem::path& registry_file);
 
 private:
+    // Outlives the manager, so abandon handlers of its probes can run after it was destroyed
+    struct ProbeOwner {
+        std::mutex mutex;
+        PipelineManager* manager;
+    };
+    // A change waiting in a pad probe. Outstanding probes are registered so the control side can remove
+    // them, either the probe or the control side claims the change.
+    struct ProbeContext {
+        enum class Kind {
+            ElementRemoval,
+            BranchConnection,
+            BranchDisconnection,
+            FrameChange
+        };
+        enum class State {
+            Pending,
+            Applying,
+            Cancelled
+        };
+        ProbeContext(PipelineManager* manager, const Kind kind, std::string target, std::shared_ptr<GstPad> pad,
+                     AsyncCompletion completion)
+            : manager(manager), kind(kind), target(std::move(target)), pad(std::move(pad)),
+              completion(std::move(completion)) {}
+        bool claim(const State next) { auto expected = State::Pending; return state.compare_exchange_strong(expected, next); }
+        PipelineManager* const manager;
+        const Kind kind;
+        const std::string target; // Element target name or branch name
+        const std::shared_ptr<GstPad> pad;
+        AsyncCompletion completion;
+        bool enable{false};
+        FrameTrigger trigger;
+        std::atomic<gulong> probe_id{0};
+        std::atomic<State> state{State::Pending};
+    };
+    static void destroyProbeContext(gpointer data);
+    // Durations of the startup phases, reported once the pipeline reached PLAYING
+    struct StartupTiming {
+        std::chrono::steady_clock::time_point start_time{std::chrono::steady_clock::now()};
+        std::chrono::microseconds init{0};
+        std::chrono::microseconds element_list{0};
+        std::chrono::microseconds plugin_preload{0};
+        std::chrono::microseconds plugin_preload_wait{0};
+        std::chrono::microseconds pipeline_creation{0};
+        bool reported{false};
+    };
+    static constexpr std::chrono::milliseconds BRANCH_REBUILD_TIMEOUT{2000};
+    static bool isFrameTriggered(GstPad* pad, GstBuffer* buffer, const FrameTrigger& trigger, AppliedFrame& frame);
+    static GstPadProbeReturn handleFrameTriggerCallback(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+    bool isProbePending(std::string_view target) const;
+    std::shared_ptr<ProbeContext> registerProbe(ProbeContext::Kind kind, std::string target, GstPad* pad,
+                                                AsyncCompletion completion);
+    void unregisterProbe(const ProbeContext& context);
+    void installProbe(const std::shared_ptr<ProbeContext>& context, GstPadProbeType type, GstPadProbeCallback callback);
+    void finishProbe(ProbeContext& context, std::error_code ec, const AppliedFrame* frame = nullptr);
+    bool cancelProbe(ProbeContext& context);
+    size_t cancelProbes();
+    bool waitForAppliedProbes(std::unique_lock<std::mutex>& lock);
+    static std::error_code insertGstElement(GstPad* src_pad, PipelineElement& element);
+    std::error_code disconnectGstElement(GstPad* src_peer) const;
     PipelineElement& findTeeElementForBranch(const std::string& branch_name);
     PipelineElement& findFirstElementInBranch(const std::string& branch_name);
     static GstPad* findLinkedSrcPad(GstElement* upstream_element, GstElement* downstream_element);
     static GstPad* findGstPadByName(GstElement* element, const std::string& pad_name);
     PipelineElement* findPipelineElementByGstElement(const GstElement* gst_element);
+    void assignTargetNames(std::vector<PipelineElement>& elements) const;
+    PipelineElement* findOptionalElement(std::string_view target_name);
     std::error_code createGstElement(PipelineElement& element) const;
     void resetPipelineElement(PipelineElement& element) const;
     std::error_code linkGstElement(PipelineElement& current_element);
     std::error_code createGstPipeline(std::vector<PipelineElement>& pipeline);
-    void createElementsList(const std::string& file_path);
+    std::error_code generateLaunchDescription(std::vector<PipelineElement>& pipeline, std::string& description) const;
+    std::error_code createGstPipelineFromDescription(std::vector<PipelineElement>& pipeline);
+    std::error_code buildGstPipeline(bool& from_description);
+    std::error_code prepareStandby(GstState state);
+    void startStandbyBuild();
+    bool failOver();
+    bool postFailOver();
+    bool isCurrentPipeline(const GstObject* object) const;
+    static void stopSources(GstElement* pipeline);
+    void attachSourceRecoveries();
+    void detachSourceRecoveries();
+    bool recoverSource(GstObject* failed_object, const std::string& reason);
+    void createElementsList(const std::string& file_path, const std::string& instance_name);
+    void initGstreamer(const std::filesystem::path& registry_file);
+    std::vector<std::string> getFactoryNames() const;
+    void reportStartupTiming();
     PipelineElement* getPreviousEnabledElement(const PipelineElement& element);
     PipelineElement* getNextEnabledElement(const PipelineElement& element);
     static std::error_code linkElements(PipelineElement& source, PipelineElement& destination);
     std::error_code enableOptionalElement(PipelineElement& element);
-    std::error_code disableOptionalElement(PipelineElement& element) const;
     static gint handlePupelineBusSignal(GstBus* bus, GstMessage* message, gpointer data);
     static GstPadProbeReturn disconnectGstElementProbeCallback(GstPad* src_peer, GstPadProbeInfo* info, gpointer data);
     static GstPadProbeReturn connectGstElementProbeCallback(GstPad* pad, GstPadProbeInfo* info, gpointer data);
     static GstPadProbeReturn handleBranchDisconnectionCallback(GstPad* src_peer, GstPadProbeInfo* info, gpointer data);
     static GstPadProbeReturn handleBranchConnectionCallback(GstPad* tee_sink_pad, GstPadProbeInfo* info, gpointer data);
-    void connectBranch(const GstElement* gst_element);
-    void disconnectBranch(const GstElement* gst_element);
+    std::error_code connectBranch(const GstElement* gst_element);
+    std::error_code disconnectBranch(const GstElement* gst_element);
     void disconnectMuxElement(PipelineElement& element) const;
     static GstPadTemplate* findSuitablePadTemplate(PipelineElement& element, GstPadDirection direction);
     static std::string generateDynamicPadName(const GstPadTemplate* pad_template);
@@ -54,16 +221,61 @@ private:
     static GstPad* requestPad(PipelineElement& element, GstPadDirection direction);
     static GstPad* allocatePad(PipelineElement& element, GstPadDirection direction);
     std::string generateGstElementUniqueName(const PipelineElement& element) const;
-    void validateGstElementProperties(PipelineElement& element) const;
+    void validateGstElementProperties(PipelineElement& element, GObjectClass* element_class) const;
     void setGstElementProperty(PipelineElement& element) const;
     std::error_code retrieveMuxGstElement(PipelineElement& element, const std::string unique_element_name) const;
     bool isGstElementInPipeline(const std::string& element_name) const;
     std::vector<GstPad*> getLinkedSinkPads(GstElement* element) const;
+    std::error_code applyPipelineReload(ReloadResult& result);
+    bool planPropertyUpdates(const PipelineElement& live_element, const PipelineElement& next_element,
+                             std::vector<std::string>& changed_keys) const;
+    void updateGstElementProperties(PipelineElement& element, const std::map<std::string, std::string>& previous_properties,
+                                    const std::vector<std::string>& changed_keys) const;
+    std::error_code disconnectBranchAndWait(const std::string& branch_name);
+    std::error_code rebuildGstPipeline(std::vector<PipelineElement> elements, std::unique_lock<std::mutex>& lock);
     std::shared_ptr<GMainLoop> gst_loop_;
     std::shared_ptr<GstElement> gst_pipeline_;
     std::string pipeline_file_;
+    std::string instance_name_;
     std::vector<PipelineElement> pipeline_elements_;
+    PlanSettings startup_settings_;
+    std::unique_ptr<PlanCache> plan_cache_;
+    uint64_t pipeline_file_hash_{0};
+    bool plan_loaded_{false};
+    bool use_launch_description_{true};
+    bool registry_update_skipped_{false};
+    PluginPreloader plugin_preloader_;
+    StartupTiming startup_timing_;
+    guint bus_watch_id_{0};
+    PipelineStartupOptions standby_options_;
+    GstState standby_state_{GST_STATE_VOID_PENDING};
+    size_t standby_max_memory_{0};
+    // Moved out of the startup options after standby_options_ copied them
+    std::function<void()> on_playing_;
+    std::mutex standby_mutex_;
+    std::mutex standby_build_mutex_;
+    std::unique_ptr<PipelineManager> standby_;
+    std::function<bool(size_t, std::function<void()>)> strand_executor_;
+    // Set from the error until the failover task finished, further errors of the failed pipeline are ignored
+    std::atomic<bool> failover_pending_{false};
+    std::atomic<bool> stopped_on_error_{false};
+    // Steady clock time of the error in ns, 0 once the standby reported PLAYING
+    std::atomic<int64_t> failover_start_ns_{0};
+    const SourceRecoveryOptions source_recovery_options_;
+    std::mutex source_recoveries_mutex_;
+    std::vector<std::shared_ptr<SourceRecovery>> source_recoveries_;
+    // Guards the elements list, probe callbacks take it in the streaming thread. It is therefore never held while
+    // installing a probe (idle probes may run right away) or while waiting for streaming threads.
     mutable std::mutex mutex_;
+    // Taken after mutex_ when both are needed, never held while calling into GStreamer
+    mutable std::mutex probes_mutex_;
+    std::vector<std::shared_ptr<ProbeContext>> probes_;
+    // Notified whenever a probe is unregistered
+    std::condition_variable probes_condition_;
+    std::shared_ptr<ProbeOwner> probe_owner_;
+    // Last, so the threads using the members above are joined first
+    std::future<void> standby_build_;
+    std::future<void> failed_pipeline_teardown_;
 };
 
 #endif //PIPELINEMANAGER_H
\ No newline at end of file
@@ -1,41 +1,182 @@
 #include "PipelineParser.h"
 
+#include <algorithm>
+#include <stdexcept>
 #include <utility>
+#include "TasksManager/ScheduleParser.h"
 
-PipelineParser::PipelineParser(const std::string& file_name) : file_(std::make_unique<File>(file_name)) {
+PipelineParser::PipelineParser(const std::string& file_name) {
     LOG_TRACE("PipelineParser constructor");
+    const auto yaml_data = YAML::Load(File(file_name).getContent());
+    if (yaml_data["gst_debug"].IsDefined()) {
+        gst_debug_thresholds_ = yaml_data["gst_debug"].as<std::string>();
+    }
+    schedules_ = ScheduleParser::parseSchedules(yaml_data["schedules"]);
+
+    if (!yaml_data["templates"].IsDefined()) {
+        templates_.push_back(parseTemplate(yaml_data["pipeline"], {}));
+        instances_.push_back({{}, 0, {}});
+        return;
+    }
+
+    for (const auto& pipeline_template : yaml_data["templates"]) {
+        templates_.push_back(parseTemplate(pipeline_template["pipeline"], pipeline_template["name"].as<std::string>()));
+        if (pipeline_template["variables"].IsDefined()) {
+            templates_.back().default_variables = pipeline_template["variables"].as<std::map<std::string, std::string>>();
+        }
+    }
+
+    // Every variable is checked once per instance here, expanding an instance can't fail anymore
+    for (const auto& instance : yaml_data["instances"]) {
+        const auto name = instance["name"].as<std::string>();
+        const auto template_name = instance["template"].as<std::string>();
+        const auto pipeline_template = std::find_if(templates_.begin(), templates_.end(),
+                                                    [&template_name](const auto& t) { return t.name == template_name; });
+        if (pipeline_template == templates_.end()) {
+            throw std::runtime_error("Instance " + name + " uses unknown template " + template_name);
+        }
+
+        Instance parsed_instance{name, static_cast<size_t>(pipeline_template - templates_.begin()), {}};
+        if (instance["variables"].IsDefined()) {
+            parsed_instance.variables = instance["variables"].as<std::map<std::string, std::string>>();
+        }
+        for (const auto& variable : pipeline_template->variables) {
+            if (!parsed_instance.variables.count(variable) && !pipeline_template->default_variables.count(variable)) {
+                throw std::runtime_error("Instance " + name + " has no value for variable " + variable);
+            }
+        }
+        for (const auto& [variable, value] : parsed_instance.variables) {
+            if (!pipeline_template->variables.count(variable)) {
+                LOG_WARN("Variable {} of instance {} is not used by template {}", variable, name, template_name);
+            }
+        }
+        instances_.push_back(std::move(parsed_instance));
+    }
 }
 
 PipelineParser::~PipelineParser() {
     LOG_TRACE("PipelineParser destructor");
 }
 
-PipelineElement PipelineParser::deserializeElement(const YAML::detail::iterator_value& element, std::string branch, const bool branch_is_optional) {
-    static unsigned int id = 0;
-    auto name = element["name"].as<std::string>();
-    auto type = element["type"].IsDefined() ? element["type"].as<std::string>() : "unknown";
-    auto properties = element["properties"].IsDefined() ? element["properties"].as<std::map<std::string, std::string>>() : std::map<std::string, std::string>();
-    auto sink_pad = element["sinkpad"].IsDefined() ? element["sinkpad"].as<std::string>() : "";
-    auto is_optional = element["optional"].IsDefined() ? element["optional"].as<bool>() : false;
-    if (branch_is_optional) {
-        is_optional = true;
+PipelineParser::PipelineTemplate PipelineParser::parseTemplate(const YAML::Node& pipeline, std::string name) {
+    PipelineTemplate pipeline_template{std::move(name), {}, {}, {}};
+    for (const auto& branch : pipeline["branches"]) {
+        const auto branch_name = branch["name"].as<std::string>();
+        const auto branch_is_optional = branch["optional"].IsDefined() ? branch["optional"].as<bool>() : false;
+        for (const auto& element : branch["elements"]) {
+            pipeline_template.elements.push_back(deserializeElement(element, branch_name, branch_is_optional));
+            for (const auto& [key, value] : pipeline_template.elements.back().variable_properties) {
+                for (size_t i = 1; i < value.parts.size(); i += 2) {
+                    pipeline_template.variables.insert(value.parts[i]);
+                }
+            }
+        }
+    }
+    return pipeline_template;
+}
+
+PipelineParser::ElementTemplate PipelineParser::deserializeElement(const YAML::Node& element, std::string branch, const bool branch_is_optional) {
+    ElementTemplate element_template;
+    element_template.name = element["name"].as<std::string>();
+    element_template.type = element["type"].IsDefined() ? element["type"].as<std::string>() : "unknown";
+    element_template.branch = std::move(branch);
+    element_template.sink_pad_name = element["sinkpad"].IsDefined() ? element["sinkpad"].as<std::string>() : "";
+    element_template.is_optional = branch_is_optional || (element["optional"].IsDefined() && element["optional"].as<bool>());
+
+    const auto properties = element["properties"].IsDefined() ? element["properties"].as<std::map<std::string, std::string>>() : std::map<std::string, std::string>();
+    for (const auto& [key, value] : properties) {
+        auto value_template = parseValueTemplate(value);
+        if (value_template.parts.size() == 1) {
+            element_template.properties.emplace(key, std::move(value_template.parts.front()));
+        } else {
+            element_template.variable_properties.emplace_back(key, std::move(value_template));
+        }
+    }
+
+    return element_template;
+}
+
+PipelineParser::ValueTemplate PipelineParser::parseValueTemplate(const std::string& value) {
+    ValueTemplate value_template;
+    std::string literal;
+    size_t position = 0;
+    while (true) {
+        const auto begin = value.find("${", position);
+        if (begin == std::string::npos) {
+            break;
+        }
+        const auto end = value.find('}', begin);
+        if (end == std::string::npos || end == begin + 2) {
+            throw std::runtime_error("Invalid variable reference in property value " + value);
+        }
+        literal.append(value, position, begin - position);
+        value_template.parts.push_back(std::move(literal));
+        value_template.parts.push_back(value.substr(begin + 2, end - begin - 2));
+        literal.clear();
+        position = end + 1;
     }
+    literal.append(value, position, std::string::npos);
+    value_template.parts.push_back(std::move(literal));
+    return value_template;
+}
 
-    return {id++, name, type, std::move(branch), properties, sink_pad, is_optional, nullptr};
+std::string PipelineParser::expandValue(const ValueTemplate& value, const Instance& instance,
+                                        const PipelineTemplate& pipeline_template) {
+    std::string expanded = value.parts.front();
+    for (size_t i = 1; i < value.parts.size(); i += 2) {
+        const auto variable = instance.variables.find(value.parts[i]);
+        expanded += variable != instance.variables.end() ? variable->second : pipeline_template.default_variables.at(value.parts[i]);
+        expanded += value.parts[i + 1];
+    }
+    return expanded;
 }
 
-std::vector<PipelineElement> PipelineParser::getAllElements() const {
-    auto yaml_data = YAML::Load(file_->getContent());
+const PipelineParser::Instance& PipelineParser::findInstance(const std::string& instance_name) const {
+    if (instance_name.empty()) {
+        if (instances_.size() != 1) {
+            std::string names;
+            for (const auto& instance : instances_) {
+                names += (names.empty() ? "" : ", ") + instance.name;
+            }
+            throw std::runtime_error("Pipeline file has " + std::to_string(instances_.size()) + " instances, select one of: " + names);
+        }
+        return instances_.front();
+    }
 
-    std::vector<PipelineElement> all_elements;
+    const auto instance = std::find_if(instances_.begin(), instances_.end(),
+                                       [&instance_name](const auto& i) { return i.name == instance_name; });
+    if (instance == instances_.end()) {
+        throw std::runtime_error("Pipeline instance " + instance_name + " not found");
+    }
+    return *instance;
+}
 
-    for (const auto& branch : yaml_data["pipeline"]["branches"]) {
-        const auto branch_name = branch["name"].as<std::string>();
-        const auto branch_is_optional = branch["optional"].IsDefined() ? branch["optional"].as<bool>() : false;
-        for (const auto& element : branch["elements"]) {
-            all_elements.emplace_back(deserializeElement(element, branch_name, branch_is_optional));
+std::vector<PipelineElement> PipelineParser::getAllElements(const std::string& instance_name) const {
+    const auto& instance = findInstance(instance_name);
+    const auto& pipeline_template = templates_.at(instance.template_index);
+
+    std::vector<PipelineElement> all_elements;
+    all_elements.reserve(pipeline_template.elements.size());
+    for (const auto& element : pipeline_template.elements) {
+        auto properties = element.properties;
+        for (const auto& [key, value] : element.variable_properties) {
+            properties.emplace(key, expandValue(value, instance, pipeline_template));
         }
+        // Ids are positions in the list, they restart on every parse so a reloaded file gets the same ids
+        const auto id = static_cast<unsigned int>(all_elements.size());
+        all_elements.emplace_back(id, element.name, element.type, element.branch, std::move(properties),
+                                  element.sink_pad_name, element.is_optional, nullptr);
     }
 
     return all_elements;
 }
+
+std::vector<std::string> PipelineParser::getInstanceNames() const {
+    std::vector<std::string> names;
+    for (const auto& instance : instances_) {
+        if (!instance.name.empty()) {
+            names.push_back(instance.name);
+        }
+    }
+    return names;
+}
@@ -1,19 +1,62 @@
 #ifndef PIPELINEPARSER_H
 #define PIPELINEPARSER_H
 
+#include <map>
+#include <set>
+#include <string>
 #include <vector>
 #include "Pipeline/PipelineElement.h"
+#include "TasksManager/ScheduleEntry.h"
 #include <File/File.h>
 #include <yaml-cpp/yaml.h>
 
+// Reads the "pipeline" entry of a pipeline file, or the "templates" and "instances" entries of a template
+// file. Templates are parsed and validated once, instances only hold their variables and are expanded on
+// request: ${variable} in a property value is replaced by the instance value or the template default. The
+// top level "gst_debug" and "schedules" entries are read from the same document.
 class PipelineParser {
 public:
     explicit PipelineParser(const std::string& file_name);
     ~PipelineParser();
-    std::vector<PipelineElement> getAllElements() const;
+    // An empty instance name selects the pipeline entry, or the only instance of a template file
+    std::vector<PipelineElement> getAllElements(const std::string& instance_name = {}) const;
+    std::vector<std::string> getInstanceNames() const;
+    const std::string& getGstDebugThresholds() const { return gst_debug_thresholds_; }
+    const std::vector<ScheduleEntry>& getSchedules() const { return schedules_; }
 private:
-    std::unique_ptr<File> file_;
-    static PipelineElement deserializeElement(const YAML::detail::iterator_value& element, std::string branch, const bool branch_is_optional);
+    // Property value split at its variable references, the odd parts are variable names
+    struct ValueTemplate {
+        std::vector<std::string> parts;
+    };
+    struct ElementTemplate {
+        std::string name;
+        std::string type;
+        std::string branch;
+        std::string sink_pad_name;
+        bool is_optional;
+        std::map<std::string, std::string> properties; // Values without variables, shared by every instance
+        std::vector<std::pair<std::string, ValueTemplate>> variable_properties;
+    };
+    struct PipelineTemplate {
+        std::string name;
+        std::vector<ElementTemplate> elements;
+        std::map<std::string, std::string> default_variables;
+        std::set<std::string> variables; // Referenced by the elements
+    };
+    struct Instance {
+        std::string name;
+        size_t template_index;
+        std::map<std::string, std::string> variables;
+    };
+    static PipelineTemplate parseTemplate(const YAML::Node& pipeline, std::string name);
+    static ElementTemplate deserializeElement(const YAML::Node& element, std::string branch, const bool branch_is_optional);
+    static ValueTemplate parseValueTemplate(const std::string& value);
+    static std::string expandValue(const ValueTemplate& value, const Instance& instance, const PipelineTemplate& pipeline_template);
+    const Instance& findInstance(const std::string& instance_name) const;
+    std::vector<PipelineTemplate> templates_;
+    std::vector<Instance> instances_;
+    std::string gst_debug_thresholds_;
+    std::vector<ScheduleEntry> schedules_;
 };
 
 #endif //PIPELINEPARSER_H
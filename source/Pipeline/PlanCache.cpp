@@ -0,0 +1,364 @@
+#include "PlanCache.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <gst/gst.h>
+#include "Logger/Logger.h"
+
+namespace {
+// On-disk layout: PlanHeader, element_count PlanElementRecords, property_count PlanPropertyRecords,
+// schedule_count PlanScheduleRecords and strings_size bytes of string data the records point into
+constexpr char PLAN_MAGIC[8] = {'G', 'P', 'L', 'P', 'L', 'A', 'N', '\0'};
+constexpr uint32_t PLAN_VERSION {2};
+
+struct PlanString {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct PlanHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t element_count;
+    uint32_t property_count;
+    uint32_t strings_size;
+    uint64_t file_hash;    // Of the pipeline file content and the instance name
+    uint64_t registry_key; // Of the GStreamer version and the plugins providing the elements
+    uint32_t schedule_count;
+    PlanString gst_debug;
+};
+
+enum PlanElementFlags : uint32_t {
+    OPTIONAL = 1 << 0,
+    PROPERTIES_VALIDATED = 1 << 1
+};
+
+struct PlanElementRecord {
+    uint32_t id;
+    uint32_t flags;
+    PlanString name;
+    PlanString type;
+    PlanString branch;
+    PlanString sink_pad_name;
+    PlanString src_pad_template;
+    PlanString sink_pad_template;
+    uint32_t first_property;
+    uint32_t property_count;
+};
+
+struct PlanPropertyRecord {
+    PlanString key;
+    PlanString value;
+};
+
+struct PlanScheduleRecord {
+    uint32_t kind;
+    uint64_t interval_ms;
+    PlanString command;
+    PlanString cron;
+};
+
+class Fnv1aHash {
+public:
+    Fnv1aHash& add(const std::string_view data) {
+        for (const auto c: data) {
+            value_ = (value_ ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        }
+        // Separator, so consecutive strings can't run into each other
+        value_ = (value_ ^ 0xff) * 0x100000001b3ULL;
+        return *this;
+    }
+    uint64_t get() const { return value_; }
+
+private:
+    uint64_t value_ {0xcbf29ce484222325ULL};
+};
+
+class StringTable {
+public:
+    PlanString add(const std::string& text) {
+        const PlanString ref {static_cast<uint32_t>(data_.size()), static_cast<uint32_t>(text.size())};
+        data_ += text;
+        return ref;
+    }
+    const std::string& getData() const { return data_; }
+
+private:
+    std::string data_;
+};
+
+// Read-only private mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path) {
+        const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat file_stat {};
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+            const auto data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                data_ = static_cast<const char*>(data);
+                size_ = static_cast<size_t>(file_stat.st_size);
+            }
+        }
+        ::close(fd);
+    }
+    ~MappedFile() {
+        if (data_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* getData() const { return data_; }
+    size_t getSize() const { return size_; }
+
+private:
+    const char* data_ {nullptr};
+    size_t size_ {0};
+};
+}
+
+PlanCache::PlanCache(std::filesystem::path directory) : directory_(std::move(directory)) {
+}
+
+bool PlanCache::hashPipelineFile(const std::filesystem::path& pipeline_file, const std::string& instance_name,
+                                 uint64_t& file_hash) {
+    std::ifstream file(pipeline_file, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    const std::string content {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    file_hash = Fnv1aHash().add(content).add(instance_name).get();
+    return true;
+}
+
+std::filesystem::path PlanCache::getPlanPath(const std::filesystem::path& pipeline_file,
+                                             const std::string& instance_name) const {
+    std::error_code ec;
+    auto absolute_path = std::filesystem::weakly_canonical(pipeline_file, ec);
+    if (ec) {
+        absolute_path = pipeline_file;
+    }
+    char file_name[32];
+    std::snprintf(file_name, sizeof(file_name), "plan-%016" PRIx64 ".bin",
+                  Fnv1aHash().add(absolute_path.string()).add(instance_name).get());
+    return directory_ / file_name;
+}
+
+uint64_t PlanCache::getRegistryKey(const std::vector<std::string>& factory_names) {
+    guint major, minor, micro, nano;
+    gst_version(&major, &minor, &micro, &nano);
+    Fnv1aHash hash;
+    hash.add(std::to_string(major) + '.' + std::to_string(minor) + '.' + std::to_string(micro) + '.' + std::to_string(nano));
+
+    // Only the registry entries are read, no plugin gets loaded
+    for (const auto& factory_name: factory_names) {
+        hash.add(factory_name);
+        const auto factory = gst_element_factory_find(factory_name.c_str());
+        if (!factory) {
+            hash.add("-");
+            continue;
+        }
+        if (const auto plugin = gst_plugin_feature_get_plugin(GST_PLUGIN_FEATURE(factory))) {
+            const auto filename = gst_plugin_get_filename(plugin);
+            hash.add(gst_plugin_get_name(plugin)).add(gst_plugin_get_version(plugin)).add(filename ? filename : "");
+            gst_object_unref(plugin);
+        }
+        gst_object_unref(factory);
+    }
+    return hash.get();
+}
+
+bool PlanCache::load(const std::filesystem::path& pipeline_file, const std::string& instance_name,
+                     const uint64_t file_hash, std::vector<PipelineElement>& elements, PlanSettings& settings) const {
+    const auto plan_path = getPlanPath(pipeline_file, instance_name);
+    const MappedFile plan(plan_path);
+    if (!plan.getData() || plan.getSize() < sizeof(PlanHeader)) {
+        LOG_DEBUG("No pipeline plan in {}", plan_path.string());
+        return false;
+    }
+
+    PlanHeader header;
+    std::memcpy(&header, plan.getData(), sizeof(header));
+    if (std::memcmp(header.magic, PLAN_MAGIC, sizeof(PLAN_MAGIC)) != 0 || header.version != PLAN_VERSION) {
+        LOG_DEBUG("Pipeline plan {} has an unsupported format", plan_path.string());
+        return false;
+    }
+    if (header.file_hash != file_hash) {
+        LOG_DEBUG("Pipeline plan {} is outdated, the pipeline file changed", plan_path.string());
+        return false;
+    }
+
+    const auto elements_offset = sizeof(PlanHeader);
+    const auto properties_offset = elements_offset + header.element_count * sizeof(PlanElementRecord);
+    const auto schedules_offset = properties_offset + header.property_count * sizeof(PlanPropertyRecord);
+    const auto strings_offset = schedules_offset + header.schedule_count * sizeof(PlanScheduleRecord);
+    if (strings_offset + header.strings_size != plan.getSize()) {
+        LOG_WARN("Pipeline plan {} is truncated or corrupt", plan_path.string());
+        return false;
+    }
+
+    const std::string_view strings {plan.getData() + strings_offset, header.strings_size};
+    auto corrupt = false;
+    const auto getString = [&](const PlanString& ref) {
+        if (static_cast<size_t>(ref.offset) + ref.size > strings.size()) {
+            corrupt = true;
+            return std::string {};
+        }
+        return std::string(strings.substr(ref.offset, ref.size));
+    };
+
+    std::vector<PipelineElement> plan_elements;
+    plan_elements.reserve(header.element_count);
+    std::vector<std::string> factory_names;
+    for (uint32_t i = 0; i < header.element_count; ++i) {
+        PlanElementRecord record;
+        std::memcpy(&record, plan.getData() + elements_offset + i * sizeof(record), sizeof(record));
+        if (static_cast<uint64_t>(record.first_property) + record.property_count > header.property_count) {
+            corrupt = true;
+            break;
+        }
+
+        std::map<std::string, std::string> properties;
+        for (uint32_t j = record.first_property; j < record.first_property + record.property_count; ++j) {
+            PlanPropertyRecord property;
+            std::memcpy(&property, plan.getData() + properties_offset + j * sizeof(property), sizeof(property));
+            properties.emplace(getString(property.key), getString(property.value));
+        }
+
+        auto& element = plan_elements.emplace_back(record.id, getString(record.name), getString(record.type),
+                                                   getString(record.branch), std::move(properties),
+                                                   getString(record.sink_pad_name), record.flags & OPTIONAL, nullptr);
+        element.properties_validated = record.flags & PROPERTIES_VALIDATED;
+        element.src_pad_template = getString(record.src_pad_template);
+        element.sink_pad_template = getString(record.sink_pad_template);
+        factory_names.push_back(element.name);
+    }
+
+    PlanSettings plan_settings;
+    plan_settings.gst_debug = getString(header.gst_debug);
+    for (uint32_t i = 0; i < header.schedule_count && !corrupt; ++i) {
+        PlanScheduleRecord record;
+        std::memcpy(&record, plan.getData() + schedules_offset + i * sizeof(record), sizeof(record));
+        if (record.kind > static_cast<uint32_t>(ScheduleEntry::Kind::Cron)) {
+            corrupt = true;
+            break;
+        }
+        plan_settings.schedules.push_back({getString(record.command), static_cast<ScheduleEntry::Kind>(record.kind),
+                                           std::chrono::milliseconds(record.interval_ms), getString(record.cron)});
+    }
+    if (corrupt) {
+        LOG_WARN("Pipeline plan {} is truncated or corrupt", plan_path.string());
+        return false;
+    }
+
+    std::sort(factory_names.begin(), factory_names.end());
+    factory_names.erase(std::unique(factory_names.begin(), factory_names.end()), factory_names.end());
+    if (header.registry_key != getRegistryKey(factory_names)) {
+        LOG_DEBUG("Pipeline plan {} is outdated, the installed plugins changed", plan_path.string());
+        return false;
+    }
+
+    elements = std::move(plan_elements);
+    settings = std::move(plan_settings);
+    return true;
+}
+
+std::error_code PlanCache::store(const std::filesystem::path& pipeline_file, const std::string& instance_name,
+                                 const uint64_t file_hash, const std::vector<PipelineElement>& elements,
+                                 const PlanSettings& settings) const {
+    PlanHeader header {};
+    std::memcpy(header.magic, PLAN_MAGIC, sizeof(header.magic));
+    header.version = PLAN_VERSION;
+    header.file_hash = file_hash;
+
+    StringTable strings;
+    std::vector<PlanElementRecord> element_records;
+    std::vector<PlanPropertyRecord> property_records;
+    std::vector<std::string> factory_names;
+    for (const auto& element: elements) {
+        PlanElementRecord record {};
+        record.id = element.id;
+        record.flags = (element.is_optional ? static_cast<uint32_t>(OPTIONAL) : uint32_t{0}) |
+                       (element.properties_validated ? static_cast<uint32_t>(PROPERTIES_VALIDATED) : uint32_t{0});
+        record.name = strings.add(element.name);
+        record.type = strings.add(element.type);
+        record.branch = strings.add(element.branch);
+        record.sink_pad_name = strings.add(element.sink_pad_name);
+        record.src_pad_template = strings.add(element.src_pad_template);
+        record.sink_pad_template = strings.add(element.sink_pad_template);
+        record.first_property = static_cast<uint32_t>(property_records.size());
+        record.property_count = static_cast<uint32_t>(element.properties.size());
+        for (const auto& [key, value]: element.properties) {
+            property_records.push_back({strings.add(key), strings.add(value)});
+        }
+        element_records.push_back(record);
+        factory_names.push_back(element.name);
+    }
+    std::sort(factory_names.begin(), factory_names.end());
+    factory_names.erase(std::unique(factory_names.begin(), factory_names.end()), factory_names.end());
+
+    std::vector<PlanScheduleRecord> schedule_records;
+    for (const auto& schedule: settings.schedules) {
+        PlanScheduleRecord record {};
+        record.kind = static_cast<uint32_t>(schedule.kind);
+        record.interval_ms = static_cast<uint64_t>(schedule.interval.count());
+        record.command = strings.add(schedule.command);
+        record.cron = strings.add(schedule.cron);
+        schedule_records.push_back(record);
+    }
+    header.schedule_count = static_cast<uint32_t>(schedule_records.size());
+    header.gst_debug = strings.add(settings.gst_debug);
+
+    header.element_count = static_cast<uint32_t>(element_records.size());
+    header.property_count = static_cast<uint32_t>(property_records.size());
+    header.strings_size = static_cast<uint32_t>(strings.getData().size());
+    header.registry_key = getRegistryKey(factory_names);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    if (ec) {
+        return ec;
+    }
+
+    // Written aside and renamed, so a concurrent start never maps a partially written plan
+    const auto plan_path = getPlanPath(pipeline_file, instance_name);
+    auto temporary_path = plan_path;
+    temporary_path += ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(element_records.data()),
+                   static_cast<std::streamsize>(element_records.size() * sizeof(PlanElementRecord)));
+        file.write(reinterpret_cast<const char*>(property_records.data()),
+                   static_cast<std::streamsize>(property_records.size() * sizeof(PlanPropertyRecord)));
+        file.write(reinterpret_cast<const char*>(schedule_records.data()),
+                   static_cast<std::streamsize>(schedule_records.size() * sizeof(PlanScheduleRecord)));
+        file.write(strings.getData().data(), static_cast<std::streamsize>(strings.getData().size()));
+        if (!file) {
+            std::filesystem::remove(temporary_path, ec);
+            return std::make_error_code(std::errc::io_error);
+        }
+    }
+
+    std::filesystem::rename(temporary_path, plan_path, ec);
+    if (ec) {
+        std::error_code remove_ec;
+        std::filesystem::remove(temporary_path, remove_ec);
+        return ec;
+    }
+    LOG_DEBUG("Stored pipeline plan of {} elements in {}", elements.size(), plan_path.string());
+    return {};
+}
@@ -0,0 +1,44 @@
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "Pipeline/PipelineElement.h"
+#include "TasksManager/ScheduleEntry.h"
+
+// Top level entries of the pipeline file applied at startup next to the elements
+struct PlanSettings {
+    std::string gst_debug;
+    std::vector<ScheduleEntry> schedules;
+};
+
+// Binary cache of the resolved element list of a pipeline file instance: elements in link order with
+// their branch topology, the properties left after validation against the element classes and the pad
+// templates chosen for linking, along with the startup settings of the file. A plan is stored per file and instance (plan-<key>.bin) and is only
+// used while the file content and the version of GStreamer and of every plugin providing one of the
+// elements are unchanged, so a start with a valid plan skips the YAML parsing and the pad template
+// discovery. Plans are written to a temporary file and renamed, and are memory-mapped to be loaded.
+class PlanCache {
+public:
+    explicit PlanCache(std::filesystem::path directory);
+    // Identifies the content a plan was resolved from, hash before parsing so a concurrent edit of the
+    // file can't be stored under the hash of the new content
+    static bool hashPipelineFile(const std::filesystem::path& pipeline_file, const std::string& instance_name,
+                                 uint64_t& file_hash);
+    // False if there is no valid plan, the elements and settings are only replaced when loading succeeded
+    bool load(const std::filesystem::path& pipeline_file, const std::string& instance_name, uint64_t file_hash,
+              std::vector<PipelineElement>& elements, PlanSettings& settings) const;
+    std::error_code store(const std::filesystem::path& pipeline_file, const std::string& instance_name,
+                          uint64_t file_hash, const std::vector<PipelineElement>& elements,
+                          const PlanSettings& settings) const;
+
+private:
+    std::filesystem::path getPlanPath(const std::filesystem::path& pipeline_file, const std::string& instance_name) const;
+    static uint64_t getRegistryKey(const std::vector<std::string>& factory_names);
+    std::filesystem::path directory_;
+};
+
+#endif //PLANCACHE_H
@@ -0,0 +1,48 @@
+#include "PluginPreloader.h"
+#include <set>
+#include <gst/gst.h>
+#include "Logger/Logger.h"
+
+PluginPreloader::~PluginPreloader() {
+    if (loader_thread_.joinable()) {
+        loader_thread_.join();
+    }
+}
+
+void PluginPreloader::start(std::vector<std::string> factory_names) {
+    wait();
+    loader_thread_ = std::thread([this, factory_names = std::move(factory_names)] {
+        load(factory_names);
+    });
+}
+
+std::chrono::microseconds PluginPreloader::wait() {
+    if (loader_thread_.joinable()) {
+        loader_thread_.join();
+    }
+    return duration_;
+}
+
+void PluginPreloader::load(const std::vector<std::string>& factory_names) {
+    const auto start_time = std::chrono::steady_clock::now();
+    std::set<std::string> plugin_names;
+    for (const auto& factory_name: factory_names) {
+        const auto factory = gst_element_factory_find(factory_name.c_str());
+        if (!factory) {
+            LOG_WARN("No element factory {} to preload", factory_name);
+            continue;
+        }
+        if (const auto loaded_factory = gst_plugin_feature_load(GST_PLUGIN_FEATURE(factory))) {
+            if (const auto plugin_name = gst_plugin_feature_get_plugin_name(loaded_factory)) {
+                plugin_names.insert(plugin_name);
+            }
+            gst_object_unref(loaded_factory);
+        } else {
+            LOG_WARN("Failed to load the plugin of element factory {}", factory_name);
+        }
+        gst_object_unref(factory);
+    }
+    duration_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time);
+    LOG_DEBUG("Preloaded {} plugins for {} element factories in {}us", plugin_names.size(), factory_names.size(),
+              duration_.count());
+}
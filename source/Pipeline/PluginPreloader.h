@@ -0,0 +1,29 @@
+#ifndef PLUGINPRELOADER_H
+#define PLUGINPRELOADER_H
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads the plugins providing a set of element factories on a background thread, so their shared
+// libraries are mapped and initialized while the rest of the application starts instead of on the
+// first gst_element_factory_make. GStreamer serializes plugin loading internally, one thread is enough.
+class PluginPreloader {
+public:
+    PluginPreloader() = default;
+    ~PluginPreloader();
+    PluginPreloader(const PluginPreloader&) = delete;
+    PluginPreloader& operator=(const PluginPreloader&) = delete;
+
+    void start(std::vector<std::string> factory_names);
+    // Blocks until loading finished, returns how long loading took
+    std::chrono::microseconds wait();
+
+private:
+    void load(const std::vector<std::string>& factory_names);
+    std::thread loader_thread_;
+    std::chrono::microseconds duration_ {0};
+};
+
+#endif //PLUGINPRELOADER_H
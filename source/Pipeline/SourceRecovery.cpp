@@ -0,0 +1,408 @@
+#include "SourceRecovery.h"
+#include <algorithm>
+#include <cstring>
+#include "EventLog/EventLog.h"
+#include "Logger/Logger.h"
+
+namespace {
+constexpr std::chrono::milliseconds DEFAULT_FRAME_INTERVAL {40};
+
+void deleteWeakRecoveryNotify(gpointer data) {
+    delete static_cast<std::weak_ptr<SourceRecovery>*>(data);
+}
+
+size_t alignUp(const size_t value, const size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Fills a frame laid out with the default GStreamer strides with black, false for formats it doesn't know
+bool fillBlack(const std::string& format, const int width, const int height, guint8* data, const size_t size) {
+    if (format == "I420" || format == "YV12" || format == "NV12" || format == "NV21") {
+        const auto luma_size = std::min(size, alignUp(width, 4) * alignUp(height, 2));
+        std::memset(data, 16, luma_size);
+        std::memset(data + luma_size, 128, size - luma_size);
+        return true;
+    }
+    if (format == "YUY2" || format == "YVYU" || format == "UYVY") {
+        const guint8 luma = 16;
+        const guint8 chroma = 128;
+        const auto first = format == "UYVY" ? chroma : luma;
+        const auto second = format == "UYVY" ? luma : chroma;
+        for (size_t i = 0; i + 1 < size; i += 2) {
+            data[i] = first;
+            data[i + 1] = second;
+        }
+        return true;
+    }
+    if (format == "GRAY8" || format == "RGB" || format == "BGR" || format == "RGBx" || format == "BGRx" ||
+        format == "xRGB" || format == "xBGR" || format == "RGB16" || format == "BGR16") {
+        std::memset(data, 0, size);
+        return true;
+    }
+    if (format == "RGBA" || format == "BGRA" || format == "ARGB" || format == "ABGR") {
+        std::memset(data, 0, size);
+        const auto alpha = format == "RGBA" || format == "BGRA" ? 3 : 0;
+        for (size_t i = alpha; i < size; i += 4) {
+            data[i] = 255;
+        }
+        return true;
+    }
+    return false;
+}
+}
+
+SourceRecovery::SourceRecovery(GstElement* pipeline, GstElement* source, SourceRecoveryOptions options)
+    : pipeline_(GST_ELEMENT(gst_object_ref(pipeline))), source_(GST_ELEMENT(gst_object_ref(source))),
+      source_name_(GST_ELEMENT_NAME(source)), options_(options) {
+}
+
+SourceRecovery::~SourceRecovery() {
+    stopFiller();
+    if (retry_source_id_) {
+        if (const auto retry_source = g_main_context_find_source_by_id(nullptr, retry_source_id_)) {
+            g_source_destroy(retry_source);
+        }
+    }
+    cancelWatchdog();
+    for (const auto pad: filler_pads_) {
+        gst_object_unref(pad);
+    }
+    if (last_frame_) {
+        gst_buffer_unref(last_frame_);
+    }
+    if (caps_) {
+        gst_caps_unref(caps_);
+    }
+    gst_object_unref(source_);
+    gst_object_unref(pipeline_);
+}
+
+void SourceRecovery::init() {
+    const auto iterator = gst_element_iterate_src_pads(source_);
+    GValue item = G_VALUE_INIT;
+    while (gst_iterator_next(iterator, &item) == GST_ITERATOR_OK) {
+        probePad(GST_PAD(g_value_get_object(&item)));
+        g_value_unset(&item);
+    }
+    gst_iterator_free(iterator);
+
+    // Sources with sometimes pads create them again on every restart
+    g_signal_connect_data(source_, "pad-added", G_CALLBACK(handlePadAdded), new WeakRecovery(weak_from_this()),
+                          deleteWeakRecovery, static_cast<GConnectFlags>(0));
+    LOG_DEBUG("Source {} is restarted when it fails", source_name_);
+}
+
+bool SourceRecovery::owns(GstObject* object) const {
+    return object == GST_OBJECT(source_) || gst_object_has_as_ancestor(object, GST_OBJECT(source_));
+}
+
+void SourceRecovery::deleteWeakRecovery(gpointer data, GClosure*) {
+    deleteWeakRecoveryNotify(data);
+}
+
+void SourceRecovery::probePad(GstPad* pad) {
+    gst_pad_add_probe(pad, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                      handleSourceProbe, new WeakRecovery(weak_from_this()), deleteWeakRecoveryNotify);
+}
+
+void SourceRecovery::handlePadAdded(GstElement*, GstPad* pad, gpointer data) {
+    if (const auto recovery = static_cast<WeakRecovery*>(data)->lock(); recovery && GST_PAD_IS_SRC(pad)) {
+        recovery->probePad(pad);
+    }
+}
+
+// Streaming thread of the source
+GstPadProbeReturn SourceRecovery::handleSourceProbe(GstPad*, GstPadProbeInfo* info, gpointer data) {
+    const auto recovery = static_cast<WeakRecovery*>(data)->lock();
+    if (!recovery) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        if (recovery->options_.filler != SourceFiller::None) {
+            std::lock_guard lock(recovery->frame_mutex_);
+            gst_buffer_replace(&recovery->last_frame_, GST_PAD_PROBE_INFO_BUFFER(info));
+        }
+        // The restarted source produces, the filler stops before its first buffer reaches the sink pads
+        if (recovery->recovering_ && !recovery->recovered_pending_.exchange(true)) {
+            {
+                std::lock_guard lock(recovery->filler_mutex_);
+                recovery->filling_ = false;
+            }
+            recovery->filler_condition_.notify_all();
+            g_idle_add_full(G_PRIORITY_DEFAULT, handleRecovered, new WeakRecovery(recovery), deleteWeakRecoveryNotify);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    const auto event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+        GstCaps* caps;
+        gst_event_parse_caps(event, &caps);
+        std::lock_guard lock(recovery->frame_mutex_);
+        gst_caps_replace(&recovery->caps_, caps);
+    } else if (GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
+        // Ending the stream would stop the encoders and sinks downstream
+        if (!recovery->end_of_stream_pending_.exchange(true)) {
+            g_idle_add_full(G_PRIORITY_DEFAULT, handleEndOfStream, new WeakRecovery(recovery), deleteWeakRecoveryNotify);
+        }
+        return GST_PAD_PROBE_DROP;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+gboolean SourceRecovery::handleEndOfStream(gpointer data) {
+    if (const auto recovery = static_cast<WeakRecovery*>(data)->lock()) {
+        recovery->end_of_stream_pending_ = false;
+        recovery->handleFailure("end of stream");
+    }
+    return G_SOURCE_REMOVE;
+}
+
+gboolean SourceRecovery::handleRecovered(gpointer data) {
+    if (const auto recovery = static_cast<WeakRecovery*>(data)->lock()) {
+        recovery->recovered();
+    }
+    return G_SOURCE_REMOVE;
+}
+
+gboolean SourceRecovery::handleRetry(gpointer data) {
+    if (const auto recovery = static_cast<WeakRecovery*>(data)->lock()) {
+        recovery->retry_source_id_ = 0;
+        recovery->retry();
+    }
+    return G_SOURCE_REMOVE;
+}
+
+gboolean SourceRecovery::handleWatchdog(gpointer data) {
+    if (const auto recovery = static_cast<WeakRecovery*>(data)->lock()) {
+        recovery->watchdog_source_id_ = 0;
+        // A buffer arrived, recovered() is already queued
+        if (recovery->recovered_pending_) {
+            return G_SOURCE_REMOVE;
+        }
+        recovery->handleFailure(fmt::format("no data for {}ms", recovery->options_.no_data_timeout.count()));
+    }
+    return G_SOURCE_REMOVE;
+}
+
+void SourceRecovery::handleFailure(const std::string& reason) {
+    cancelWatchdog();
+    if (!recovering_.exchange(true)) {
+        outage_start_ = std::chrono::steady_clock::now();
+        attempts_ = 0;
+        backoff_ = options_.initial_backoff;
+        LOG_WARN("Source {} lost: {}", source_name_, reason);
+        RECORD_EVENT(EventType::Source, 0, 0, fmt::format("{}: {}", source_name_, reason));
+    } else {
+        LOG_WARN("Source {} restart {} failed: {}", source_name_, attempts_, reason);
+    }
+    // Also when the failed restart already produced a buffer
+    recovered_pending_ = false;
+
+    // Sometimes pads are gone once the source is stopped
+    std::vector<GstPad*> filler_pads;
+    const auto iterator = gst_element_iterate_src_pads(source_);
+    GValue item = G_VALUE_INIT;
+    while (gst_iterator_next(iterator, &item) == GST_ITERATOR_OK) {
+        if (const auto peer = gst_pad_get_peer(GST_PAD(g_value_get_object(&item)))) {
+            filler_pads.push_back(peer);
+        }
+        g_value_unset(&item);
+    }
+    gst_iterator_free(iterator);
+    if (!filler_pads.empty()) {
+        std::lock_guard lock(filler_mutex_);
+        for (const auto pad: filler_pads_) {
+            gst_object_unref(pad);
+        }
+        filler_pads_ = std::move(filler_pads);
+    }
+
+    gst_element_set_locked_state(source_, TRUE);
+    gst_element_set_state(source_, GST_STATE_NULL);
+    startFiller();
+    scheduleRetry();
+}
+
+void SourceRecovery::scheduleRetry() {
+    if (retry_source_id_) {
+        return;
+    }
+    LOG_INFO("Restarting source {} in {}ms", source_name_, backoff_.count());
+    retry_source_id_ = g_timeout_add_full(G_PRIORITY_DEFAULT, static_cast<guint>(backoff_.count()), handleRetry,
+                                          new WeakRecovery(weak_from_this()), deleteWeakRecoveryNotify);
+    backoff_ = std::min(backoff_ * 2, options_.max_backoff);
+}
+
+void SourceRecovery::retry() {
+    if (!recovering_) {
+        return;
+    }
+    ++attempts_;
+    gst_element_set_locked_state(source_, FALSE);
+    // Sources that connect asynchronously report a failure on the bus later, or never deliver
+    if (!gst_element_sync_state_with_parent(source_)) {
+        handleFailure("state change failed");
+        return;
+    }
+    armWatchdog();
+}
+
+// Fails the attempt unless the first buffer of the source arrives in time
+void SourceRecovery::armWatchdog() {
+    cancelWatchdog();
+    watchdog_source_id_ = g_timeout_add_full(G_PRIORITY_DEFAULT, static_cast<guint>(options_.no_data_timeout.count()),
+                                             handleWatchdog, new WeakRecovery(weak_from_this()), deleteWeakRecoveryNotify);
+}
+
+void SourceRecovery::cancelWatchdog() {
+    if (watchdog_source_id_) {
+        if (const auto watchdog_source = g_main_context_find_source_by_id(nullptr, watchdog_source_id_)) {
+            g_source_destroy(watchdog_source);
+        }
+        watchdog_source_id_ = 0;
+    }
+}
+
+void SourceRecovery::recovered() {
+    if (!recovering_ || !recovered_pending_) {
+        return;
+    }
+    recovering_ = false;
+    recovered_pending_ = false;
+    cancelWatchdog();
+    stopFiller();
+    if (retry_source_id_) {
+        g_source_remove(retry_source_id_);
+        retry_source_id_ = 0;
+    }
+
+    const auto outage = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - outage_start_);
+    LOG_INFO("Source {} recovered in {}ms after {} restart attempts", source_name_, outage.count() / 1000, attempts_);
+    RECORD_EVENT(EventType::Source, attempts_, outage.count(), fmt::format("{}: recovered", source_name_));
+}
+
+void SourceRecovery::startFiller() {
+    if (options_.filler == SourceFiller::None) {
+        return;
+    }
+    {
+        std::lock_guard lock(filler_mutex_);
+        if (filling_) {
+            return;
+        }
+    }
+    // Stopped by a buffer of a restart that failed again
+    if (filler_thread_.joinable()) {
+        filler_thread_.join();
+    }
+
+    GstBuffer* frame;
+    GstCaps* caps;
+    {
+        std::lock_guard lock(frame_mutex_);
+        frame = last_frame_ ? gst_buffer_ref(last_frame_) : nullptr;
+        caps = caps_ ? gst_caps_ref(caps_) : nullptr;
+    }
+    if (!frame || !caps) {
+        LOG_WARN("Source {} produced no frame, the outage is not filled", source_name_);
+        if (frame) {
+            gst_buffer_unref(frame);
+        }
+        if (caps) {
+            gst_caps_unref(caps);
+        }
+        return;
+    }
+
+    if (options_.filler == SourceFiller::Black) {
+        frame = makeBlackFrame(frame, caps);
+    }
+    std::chrono::nanoseconds interval = DEFAULT_FRAME_INTERVAL;
+    gint numerator;
+    gint denominator;
+    if (gst_structure_get_fraction(gst_caps_get_structure(caps, 0), "framerate", &numerator, &denominator) &&
+        numerator > 0 && denominator > 0) {
+        interval = std::chrono::nanoseconds(GST_SECOND * denominator / numerator);
+    }
+    gst_caps_unref(caps);
+
+    {
+        std::lock_guard lock(filler_mutex_);
+        filling_ = true;
+    }
+    filler_thread_ = std::thread(&SourceRecovery::fill, this, frame, interval);
+}
+
+void SourceRecovery::stopFiller() {
+    {
+        std::lock_guard lock(filler_mutex_);
+        filling_ = false;
+    }
+    filler_condition_.notify_all();
+    if (filler_thread_.joinable()) {
+        filler_thread_.join();
+    }
+}
+
+// Filler thread, stamps the frames with the running time of the pipeline like a live source does
+void SourceRecovery::fill(GstBuffer* frame, const std::chrono::nanoseconds interval) {
+    LOG_DEBUG("Filling the outage of source {} every {}us", source_name_,
+              std::chrono::duration_cast<std::chrono::microseconds>(interval).count());
+    auto next_time = std::chrono::steady_clock::now();
+    auto discont = true;
+    std::unique_lock lock(filler_mutex_);
+    while (filling_) {
+        // Shares the memory of the frame
+        const auto buffer = gst_buffer_copy(frame);
+        GST_BUFFER_PTS(buffer) = GST_CLOCK_TIME_NONE;
+        GST_BUFFER_DTS(buffer) = GST_CLOCK_TIME_NONE;
+        GST_BUFFER_DURATION(buffer) = interval.count();
+        if (const auto clock = gst_element_get_clock(pipeline_)) {
+            const auto now = gst_clock_get_time(clock);
+            const auto base_time = gst_element_get_base_time(pipeline_);
+            GST_BUFFER_PTS(buffer) = now > base_time ? now - base_time : 0;
+            gst_object_unref(clock);
+        }
+        if (std::exchange(discont, false)) {
+            GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DISCONT);
+        }
+        for (const auto pad: filler_pads_) {
+            gst_pad_chain(pad, gst_buffer_ref(buffer));
+        }
+        gst_buffer_unref(buffer);
+
+        next_time += interval;
+        filler_condition_.wait_until(lock, next_time, [this] { return !filling_; });
+    }
+    gst_buffer_unref(frame);
+}
+
+GstBuffer* SourceRecovery::makeBlackFrame(GstBuffer* frame, const GstCaps* caps) const {
+    const auto structure = gst_caps_get_structure(caps, 0);
+    const auto format = gst_structure_get_string(structure, "format");
+    gint width = 0;
+    gint height = 0;
+    if (!gst_structure_has_name(structure, "video/x-raw") || !format ||
+        !gst_structure_get_int(structure, "width", &width) || !gst_structure_get_int(structure, "height", &height)) {
+        LOG_WARN("Source {} frames can't be blackened, repeating the last one", source_name_);
+        return frame;
+    }
+
+    const auto black_frame = gst_buffer_copy_deep(frame);
+    GstMapInfo map;
+    if (!gst_buffer_map(black_frame, &map, GST_MAP_WRITE)) {
+        gst_buffer_unref(black_frame);
+        return frame;
+    }
+    const auto filled = fillBlack(format, width, height, map.data, map.size);
+    gst_buffer_unmap(black_frame, &map);
+    if (!filled) {
+        LOG_WARN("Source {} frames in {} can't be blackened, repeating the last one", source_name_, format);
+        gst_buffer_unref(black_frame);
+        return frame;
+    }
+    gst_buffer_unref(frame);
+    return black_frame;
+}
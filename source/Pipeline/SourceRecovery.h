@@ -0,0 +1,98 @@
+#ifndef SOURCERECOVERY_H
+#define SOURCERECOVERY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gst/gst.h>
+
+enum class SourceFiller {
+    None,
+    Last,  // Repeats the last frame of the source
+    Black  // Black frame in the format of the last frame, the last frame for formats that can't be blackened
+};
+
+struct SourceRecoveryOptions {
+    // Restart sources that fail or end instead of stopping the pipeline
+    bool enabled{false};
+    std::chrono::milliseconds initial_backoff{500};
+    std::chrono::milliseconds max_backoff{10000};
+    // A restart after which the source delivers no buffer for this long failed
+    std::chrono::milliseconds no_data_timeout{5000};
+    SourceFiller filler{SourceFiller::Last};
+};
+
+// Keeps the elements downstream of a source running while the source is restarted. An error posted by the source, or
+// one of its children, and an end of stream reaching its src pads isolate it: the end of stream is dropped, the source
+// state is locked and set to NULL and restarting it is retried with an exponential backoff. Meanwhile a filler thread
+// chains filler frames, timestamped in running time at the framerate of the source, straight into the sink pads the
+// source is linked to, so encoders and network sinks keep their clients. The first buffer of the restarted source ends
+// the outage, a restart that brings no buffer within the no data timeout failed. Created on the bus thread and driven
+// by it, probes and the filler only hand over to it.
+class SourceRecovery : public std::enable_shared_from_this<SourceRecovery> {
+public:
+    SourceRecovery(GstElement* pipeline, GstElement* source, SourceRecoveryOptions options);
+    ~SourceRecovery();
+    SourceRecovery(const SourceRecovery&) = delete;
+    SourceRecovery& operator=(const SourceRecovery&) = delete;
+    // Probes the src pads of the source, the ones it adds later included
+    void init();
+    // Whether the object is the source or one of its children
+    bool owns(GstObject* object) const;
+    // Bus thread, isolates the source and schedules the next attempt to restart it
+    void handleFailure(const std::string& reason);
+
+private:
+    using WeakRecovery = std::weak_ptr<SourceRecovery>;
+    static GstPadProbeReturn handleSourceProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+    static void handlePadAdded(GstElement* source, GstPad* pad, gpointer data);
+    static gboolean handleRetry(gpointer data);
+    static gboolean handleWatchdog(gpointer data);
+    static gboolean handleEndOfStream(gpointer data);
+    static gboolean handleRecovered(gpointer data);
+    static void deleteWeakRecovery(gpointer data, GClosure* = nullptr);
+    void probePad(GstPad* pad);
+    void scheduleRetry();
+    void retry();
+    void armWatchdog();
+    void cancelWatchdog();
+    void recovered();
+    void startFiller();
+    void stopFiller();
+    void fill(GstBuffer* frame, std::chrono::nanoseconds interval);
+    GstBuffer* makeBlackFrame(GstBuffer* frame, const GstCaps* caps) const;
+
+    GstElement* pipeline_;
+    GstElement* source_;
+    const std::string source_name_;
+    const SourceRecoveryOptions options_;
+
+    // Bus thread
+    std::chrono::steady_clock::time_point outage_start_;
+    unsigned int attempts_{0};
+    std::chrono::milliseconds backoff_{0};
+    guint retry_source_id_{0};
+    guint watchdog_source_id_{0};
+    std::atomic<bool> recovering_{false};
+    std::atomic<bool> end_of_stream_pending_{false};
+    std::atomic<bool> recovered_pending_{false};
+
+    // Last frame and caps seen on the src pads, kept for the filler
+    mutable std::mutex frame_mutex_;
+    GstBuffer* last_frame_{nullptr};
+    GstCaps* caps_{nullptr};
+
+    // Serializes filler frames with the first buffer of the restarted source
+    std::mutex filler_mutex_;
+    std::condition_variable filler_condition_;
+    bool filling_{false};
+    std::vector<GstPad*> filler_pads_;
+    std::thread filler_thread_;
+};
+
+#endif //SOURCERECOVERY_H
@@ -0,0 +1,300 @@
+#include "CommandCoalescer.h"
+#include <atomic>
+
+// Most targets and bursts fit, larger ones grow their entry once
+constexpr size_t TARGET_CAPACITY {32};
+constexpr size_t REQUESTER_CAPACITY {8};
+
+// Scheduled in place of the merged commands, runs whatever command is latest when a worker picks it up
+class CommandCoalescer::CoalescedCommand : public CommandInterface {
+public:
+    CoalescedCommand(std::weak_ptr<CommandCoalescer> coalescer, PendingCommand* pending)
+        : coalescer_(std::move(coalescer)), pending_(pending) {}
+    void execute(std::shared_ptr<InputInterface::Requester>) override {
+        if (const auto coalescer = coalescer_.lock()) {
+            coalescer->execute(*pending_);
+        }
+    }
+    size_t getStrandKey() const override { return pending_->strand_key; }
+
+private:
+    std::weak_ptr<CommandCoalescer> coalescer_;
+    PendingCommand* pending_;
+};
+
+// Forwards the single response of the executed command to the requesters that asked for it. The
+// command may answer from another thread while it registers for abandonment, hence the lock.
+class CommandCoalescer::CoalescedResponder : public InputInterface {
+public:
+    CoalescedResponder() {
+        requesters_.reserve(REQUESTER_CAPACITY);
+        responding_.reserve(REQUESTER_CAPACITY);
+    }
+    void add(std::shared_ptr<Requester> requester) {
+        std::lock_guard lock(mutex_);
+        requesters_.push_back(std::move(requester));
+    }
+    void clear() {
+        std::lock_guard lock(mutex_);
+        requesters_.clear();
+    }
+    void sendResponse(std::shared_ptr<Requester>, const std::string_view response) override {
+        {
+            std::lock_guard lock(mutex_);
+            responding_.swap(requesters_);
+        }
+        for (const auto& requester: responding_) {
+            if (requester) {
+                requester->source->sendResponse(requester, response);
+            }
+        }
+        responding_.clear();
+    }
+    // The merged command is given up once every requester waiting for it gave up
+    void onAbandon(std::shared_ptr<Requester>, std::function<void()> handler) override {
+        std::vector<std::shared_ptr<Requester>> requesters;
+        {
+            std::lock_guard lock(mutex_);
+            requesters = requesters_;
+        }
+        if (requesters.empty()) {
+            return;
+        }
+        const auto remaining = std::make_shared<std::atomic<size_t>>(requesters.size());
+        const auto shared_handler = std::make_shared<std::function<void()>>(std::move(handler));
+        for (const auto& requester: requesters) {
+            const auto abandon = [remaining, shared_handler] {
+                if (remaining->fetch_sub(1) == 1) {
+                    (*shared_handler)();
+                }
+            };
+            if (requester) {
+                requester->source->onAbandon(requester, abandon);
+            } else {
+                abandon();
+            }
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Requester>> requesters_;
+    std::vector<std::shared_ptr<Requester>> responding_;
+};
+
+CommandCoalescer::CommandCoalescer(std::shared_ptr<Scheduler> scheduler, const std::chrono::milliseconds debounce_window)
+    : scheduler_(std::move(scheduler)), debounce_window_(debounce_window) {}
+
+CommandCoalescer::~CommandCoalescer() {
+    deinit();
+}
+
+void CommandCoalescer::init() {
+    stop_ = false;
+    if (debounce_window_.count() > 0) {
+        timer_thread_ = std::thread(&CommandCoalescer::runTimer, this);
+    }
+}
+
+void CommandCoalescer::deinit() {
+    std::vector<std::shared_ptr<InputInterface::Requester>> requesters;
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+        // Entries already queued in the scheduler find themselves answered and do nothing
+        for (const auto& entry: entries_) {
+            if (!entry->pending) {
+                continue;
+            }
+            entry->pending = false;
+            entry->command.reset();
+            for (auto& requester: entry->requesters) {
+                requesters.push_back(std::move(requester.first));
+            }
+            entry->requesters.clear();
+        }
+    }
+    timer_condition_.notify_all();
+    if (timer_thread_.joinable()) {
+        timer_thread_.join();
+    }
+
+    for (const auto& requester: requesters) {
+        if (requester) {
+            requester->source->sendResponse(requester, "Nack");
+        }
+    }
+
+    if (coalesced_count_ > 0) {
+        LOG_DEBUG("Coalesced {} commands", coalesced_count_);
+    }
+}
+
+CommandCoalescer::PendingCommand* CommandCoalescer::findPending(const size_t strand_key, const std::string_view target) {
+    for (const auto& entry: entries_) {
+        if (entry->pending && entry->strand_key == strand_key && entry->target == target) {
+            return entry.get();
+        }
+    }
+    return nullptr;
+}
+
+CommandCoalescer::PendingCommand& CommandCoalescer::acquireEntry() {
+    // The entry holds one reference to its command and responder requester, another one means the
+    // command is still queued or its response has not been sent yet
+    for (const auto& entry: entries_) {
+        if (!entry->pending && entry->scheduled_command.use_count() == 1 && entry->responder_requester.use_count() == 1) {
+            return *entry;
+        }
+    }
+
+    auto entry = std::make_unique<PendingCommand>();
+    entry->target.reserve(TARGET_CAPACITY);
+    entry->requesters.reserve(REQUESTER_CAPACITY);
+    entry->superseded.reserve(REQUESTER_CAPACITY);
+    entry->scheduled_command = std::make_shared<CoalescedCommand>(weak_from_this(), entry.get());
+    entry->responder = std::make_shared<CoalescedResponder>();
+    entry->responder_requester = std::make_shared<InputInterface::Requester>(entry->responder, -1);
+    entries_.push_back(std::move(entry));
+
+    return *entries_.back();
+}
+
+bool CommandCoalescer::submit(std::shared_ptr<InputInterface::Requester> requester,
+                              const std::shared_ptr<CommandInterface>& command, const CommandPriority priority) {
+    PendingCommand* pending;
+    {
+        std::lock_guard lock(mutex_);
+        if (stop_) {
+            return false;
+        }
+
+        const auto strand_key = command->getStrandKey();
+        const auto target = command->getCoalesceTarget();
+        if ((pending = findPending(strand_key, target))) {
+            LOG_DEBUG("Coalescing command on target '{}'", target);
+            pending->command = command;
+            pending->priority = std::min(pending->priority, priority);
+            pending->requesters.emplace_back(std::move(requester), command);
+            // Each command restarts the window, the target is scheduled once it went quiet
+            if (!pending->scheduled) {
+                pending->deadline = Clock::now() + debounce_window_;
+            }
+            ++coalesced_count_;
+            return true;
+        }
+
+        pending = &acquireEntry();
+        pending->strand_key = strand_key;
+        pending->target.assign(target.data(), target.size());
+        pending->command = command;
+        pending->priority = priority;
+        pending->requesters.emplace_back(std::move(requester), command);
+        pending->deadline = Clock::now() + debounce_window_;
+        pending->scheduled = debounce_window_.count() == 0;
+        pending->pending = true;
+    }
+
+    if (debounce_window_.count() > 0) {
+        timer_condition_.notify_one();
+        return true;
+    }
+
+    return schedule(*pending, priority);
+}
+
+bool CommandCoalescer::schedule(PendingCommand& pending, const CommandPriority priority) {
+    if (scheduler_->enqueueTask(pending.scheduled_command, priority)) {
+        return true;
+    }
+
+    std::vector<std::shared_ptr<InputInterface::Requester>> requesters;
+    {
+        std::lock_guard lock(mutex_);
+        pending.pending = false;
+        pending.command.reset();
+        for (auto& requester: pending.requesters) {
+            requesters.push_back(std::move(requester.first));
+        }
+        pending.requesters.clear();
+    }
+    for (const auto& requester: requesters) {
+        if (requester) {
+            requester->source->sendResponse(requester, "Nack");
+        }
+    }
+
+    return false;
+}
+
+void CommandCoalescer::execute(PendingCommand& pending) {
+    // The entry cannot be reused while its scheduled command runs, so it is safe to use unlocked
+    // once it stopped accepting merges
+    std::shared_ptr<CommandInterface> command;
+    {
+        std::lock_guard lock(mutex_);
+        if (!pending.pending) {
+            return;
+        }
+        // From here on new commands on the target start a new entry
+        pending.pending = false;
+        command = std::move(pending.command);
+        pending.responder->clear();
+        for (auto& [requester, requested_command]: pending.requesters) {
+            // Commands bound to arguments are separate instances even when they were requested the same way
+            if (requested_command == command || requested_command->isSameCommand(*command)) {
+                pending.responder->add(std::move(requester));
+            } else {
+                pending.superseded.push_back(std::move(requester));
+            }
+        }
+        pending.requesters.clear();
+    }
+
+    for (const auto& requester: pending.superseded) {
+        if (requester) {
+            requester->source->sendResponse(requester, SUPERSEDED_RESPONSE);
+        }
+    }
+    pending.superseded.clear();
+
+    command->execute(pending.responder_requester);
+}
+
+void CommandCoalescer::runTimer() {
+    std::unique_lock lock(mutex_);
+    while (!stop_) {
+        auto next_deadline = Clock::time_point::max();
+        const auto now = Clock::now();
+        // Only grows with the entries, so collecting the due ones below never reallocates
+        due_.reserve(entries_.size());
+        for (const auto& entry: entries_) {
+            if (!entry->pending || entry->scheduled) {
+                continue;
+            }
+            if (entry->deadline <= now) {
+                entry->scheduled = true;
+                due_.push_back(entry.get());
+            } else {
+                next_deadline = std::min(next_deadline, entry->deadline);
+            }
+        }
+
+        if (!due_.empty()) {
+            for (const auto pending: due_) {
+                const auto priority = pending->priority;
+                lock.unlock();
+                schedule(*pending, priority);
+                lock.lock();
+            }
+            due_.clear();
+            continue;
+        }
+
+        if (next_deadline == Clock::time_point::max()) {
+            timer_condition_.wait(lock);
+        } else {
+            timer_condition_.wait_until(lock, next_deadline);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef PERIPHERY_MANAGER_COMMANDCOALESCER_H
+#define PERIPHERY_MANAGER_COMMANDCOALESCER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "TasksManager/CommandInterface.h"
+#include "TasksManager/Scheduler.h"
+#include "AppInputs/InputInterface.h"
+
+// Collapses bursts of commands on the same target (e.g. enable X/disable X storms) into the last
+// requested one. A target stays mergeable from its first command until a worker starts executing
+// it. With a debounce window it is held back until no command arrived for the window. Requesters
+// of the executed command receive its response, the others are answered "Superseded".
+class CommandCoalescer : public std::enable_shared_from_this<CommandCoalescer> {
+public:
+    static constexpr std::string_view SUPERSEDED_RESPONSE {"Superseded"};
+    CommandCoalescer(std::shared_ptr<Scheduler> scheduler, std::chrono::milliseconds debounce_window);
+    ~CommandCoalescer();
+    void init();
+    void deinit();
+    bool submit(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command,
+                CommandPriority priority);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    class CoalescedCommand;
+    class CoalescedResponder;
+    // Entries are reused once their scheduled command and responder are no longer referenced, so
+    // merging and scheduling allocate nothing in the steady state
+    struct PendingCommand {
+        size_t strand_key{CommandInterface::NO_STRAND_KEY};
+        std::string target;
+        std::shared_ptr<CommandInterface> command;
+        CommandPriority priority{CommandPriority::Reconfigure};
+        // Every requester with the command it asked for
+        std::vector<std::pair<std::shared_ptr<InputInterface::Requester>, std::shared_ptr<CommandInterface>>> requesters;
+        std::vector<std::shared_ptr<InputInterface::Requester>> superseded;
+        Clock::time_point deadline;
+        bool pending{false};
+        bool scheduled{false};
+        std::shared_ptr<CoalescedCommand> scheduled_command;
+        std::shared_ptr<CoalescedResponder> responder;
+        std::shared_ptr<InputInterface::Requester> responder_requester;
+    };
+    PendingCommand* findPending(size_t strand_key, std::string_view target);
+    PendingCommand& acquireEntry();
+    bool schedule(PendingCommand& pending, CommandPriority priority);
+    void execute(PendingCommand& pending);
+    void runTimer();
+    std::shared_ptr<Scheduler> scheduler_;
+    std::chrono::milliseconds debounce_window_;
+    std::vector<std::unique_ptr<PendingCommand>> entries_;
+    std::vector<PendingCommand*> due_; // Only used by the timer thread
+    std::mutex mutex_;
+    std::condition_variable timer_condition_;
+    std::thread timer_thread_;
+    bool stop_{false};
+    uint64_t coalesced_count_{0};
+};
+
+#endif //PERIPHERY_MANAGER_COMMANDCOALESCER_H
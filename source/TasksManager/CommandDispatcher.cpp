@@ -1,41 +1,240 @@
 #include "CommandDispatcher.h"
+#include <algorithm>
+#include <tuple>
 #include <utility>
+#include "EventLog/EventLog.h"
+#include "TasksManager/Operation.h"
 
-CommandDispatcher::CommandDispatcher(std::shared_ptr<Scheduler> scheduler) : scheduler_(std::move(scheduler)) {
+namespace {
+// Scheduled and internally dispatched commands have no client waiting for them, their responses are logged
+class CommandResponseLogger : public InputInterface {
+public:
+    explicit CommandResponseLogger(std::string command_name) : command_name_(std::move(command_name)) {}
+    void sendResponse(std::shared_ptr<Requester>, const std::string_view response) override {
+        LOG_INFO("Command '{}' answered: {}", command_name_, response);
+        if (EventLog::getInstance().isEnabled()) {
+            EventLog::getInstance().record(EventType::CommandResult, 0, 0, fmt::format("{}: {}", command_name_, response));
+        }
+    }
+
+private:
+    std::string command_name_;
+};
+
+bool isSpace(const char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Splits off the next whitespace separated word, returns an empty view at the end of the text
+std::string_view nextWord(std::string_view& text) {
+    size_t begin = 0;
+    while (begin < text.size() && isSpace(text[begin])) {
+        ++begin;
+    }
+    size_t end = begin;
+    while (end < text.size() && !isSpace(text[end])) {
+        ++end;
+    }
+    const auto word = text.substr(begin, end - begin);
+    text.remove_prefix(end);
+    return word;
+}
+}
+
+CommandDispatcher::CommandDispatcher(std::shared_ptr<Scheduler> scheduler, std::shared_ptr<CommandCoalescer> coalescer,
+                                     std::shared_ptr<OperationTracker> operation_tracker)
+    : command_table_(std::make_unique<CommandTable>()), scheduler_(std::move(scheduler)), coalescer_(std::move(coalescer)),
+      operation_tracker_(std::move(operation_tracker)) {
 }
 
-void CommandDispatcher::registerCommand(const std::string& command_name,
-                                        const std::shared_ptr<CommandInterface>& command) {
-    std::lock_guard lock(map_mutex_);
-    if (command_map_.find(command_name) == command_map_.end()) {
-        command_map_[command_name] = command;
-    } else {
-        LOG_ERROR("Command '{}' is already registered", command_name);
+const CommandDispatcher::RegisteredCommand* CommandDispatcher::CommandTable::find(const std::string_view verb,
+                                                                                  const std::string_view target) const {
+    const auto it = std::lower_bound(entries.begin(), entries.end(), std::pair(verb, target),
+                                     [](const Entry& entry, const std::pair<std::string_view, std::string_view>& key) {
+                                         return std::pair<std::string_view, std::string_view>(entry.verb, entry.target) < key;
+                                     });
+    if (it != entries.end() && it->verb == verb && it->target == target) {
+        return &it->registered_command;
     }
+    return nullptr;
 }
 
-void CommandDispatcher::dispatchCommand(std::shared_ptr<InputInterface::Requester> requester,
-                                        const std::string& command_name) {
-    {
-        std::lock_guard lock(map_mutex_);
-        if (const auto it = command_map_.find(command_name); it != command_map_.end()) {
-            LOG_INFO("Command '{}' received", command_name);
-            scheduler_->enqueueTask(std::move(requester), it->second);
-        } else {
-            requester->source->sendResponse(requester, "Nack");
-            LOG_ERROR("Unknown command received");
+void CommandDispatcher::registerCommand(const std::string& verb, const std::shared_ptr<CommandInterface>& command,
+                                        const CommandPriority priority) {
+    registerCommand(verb, {}, command, priority);
+}
+
+void CommandDispatcher::registerCommand(const std::string& verb, const std::string& target,
+                                        const std::shared_ptr<CommandInterface>& command, const CommandPriority priority) {
+    std::lock_guard lock(registration_mutex_);
+    auto table = command_table_.read([](const CommandTable& current) { return std::make_unique<CommandTable>(current); });
+    if (table->find(verb, target)) {
+        LOG_ERROR("Command '{} {}' is already registered", verb, target);
+        return;
+    }
+
+    const auto position = std::lower_bound(table->entries.begin(), table->entries.end(), std::pair(verb, target),
+                                           [](const CommandTable::Entry& entry, const std::pair<std::string, std::string>& key) {
+                                               return std::tie(entry.verb, entry.target) < std::tie(key.first, key.second);
+                                           });
+    table->entries.insert(position, {verb, target, {command, priority}});
+    command_table_.update(std::move(table));
+}
+
+bool CommandDispatcher::unregisterCommand(const std::string& verb, const std::string& target) {
+    std::lock_guard lock(registration_mutex_);
+    auto table = command_table_.read([](const CommandTable& current) { return std::make_unique<CommandTable>(current); });
+    const auto entry = std::find_if(table->entries.begin(), table->entries.end(), [&](const CommandTable::Entry& entry) {
+        return entry.verb == verb && entry.target == target;
+    });
+    if (entry == table->entries.end()) {
+        return false;
+    }
+
+    table->entries.erase(entry);
+    command_table_.update(std::move(table));
+    return true;
+}
+
+// Runs on every received message: the words are views into the message and the table is read
+// without locking, so nothing is allocated unless the command binds arguments
+std::error_code CommandDispatcher::resolveCommand(const std::string_view message, RegisteredCommand& registered_command) const {
+    auto remaining = message;
+    const auto verb = nextWord(remaining);
+    CommandArguments words;
+    for (auto word = nextWord(remaining); !word.empty(); word = nextWord(remaining)) {
+        if (!words.push(word)) {
+            LOG_ERROR("Command '{}' has more than {} arguments", verb, CommandArguments::MAX_ARGUMENTS);
+            return std::make_error_code(std::errc::argument_list_too_long);
         }
     }
+
+    // A command registered with a target takes the words after it as arguments,
+    // a command registered without one takes every word after the verb
+    const auto target = words.empty() ? std::string_view{} : words[0];
+    size_t first_argument = 0;
+    const auto found = command_table_.read([&](const CommandTable& table) {
+        if (const auto exact = table.find(verb, target); exact && !target.empty()) {
+            registered_command = *exact;
+            first_argument = 1;
+            return true;
+        }
+        if (const auto verb_only = table.find(verb, {})) {
+            registered_command = *verb_only;
+            return true;
+        }
+        return false;
+    });
+    if (!found) {
+        LOG_ERROR("Unknown command '{}'", message);
+        return std::make_error_code(std::errc::function_not_supported);
+    }
+
+    if (first_argument < words.size()) {
+        CommandArguments arguments;
+        for (auto i = first_argument; i < words.size(); ++i) {
+            arguments.push(words[i]);
+        }
+        auto bound_command = registered_command.command->withArguments(arguments);
+        if (!bound_command) {
+            LOG_ERROR("Invalid arguments '{}' for command '{}'", words.join(first_argument), verb);
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+        registered_command.command = std::move(bound_command);
+    }
+
+    return {};
+}
+
+bool CommandDispatcher::scheduleCommand(std::shared_ptr<InputInterface::Requester> requester,
+                                        const RegisteredCommand& registered_command) {
+    const auto& [command, priority] = registered_command;
+    if (coalescer_ && priority != CommandPriority::Critical && !command->getCoalesceTarget().empty()) {
+        return coalescer_->submit(std::move(requester), command, priority);
+    }
+
+    return scheduler_->enqueueTask(std::move(requester), command, priority);
+}
+
+void CommandDispatcher::dispatchCommand(std::shared_ptr<InputInterface::Requester> requester, const std::string_view message) {
+    RegisteredCommand registered_command;
+    const auto ec = resolveCommand(message, registered_command);
+
+    // From here on the command answers through its operation, which adds the id and the duration to the
+    // response and enforces the deadline. Rejected commands get an operation too, so every response is framed alike.
+    Operation* operation = nullptr;
+    uint64_t operation_id = 0;
+    if (operation_tracker_) {
+        requester = operation_tracker_->start(std::move(requester));
+        operation = &static_cast<Operation&>(*requester->source);
+        operation_id = operation->getId();
+    }
+    if (ec) {
+        RECORD_EVENT(EventType::Command, -1, operation_id, message);
+        requester->source->sendResponse(requester, "Nack");
+        return;
+    }
+
+    LOG_INFO("Command '{}' received, operation {}", message, operation_id);
+    RECORD_EVENT(EventType::Command, static_cast<int64_t>(registered_command.priority), operation_id, message);
+    // The id has to reach the requester before the command can answer
+    if (operation) {
+        operation->accept();
+    }
+    if (!scheduleCommand(requester, registered_command)) {
+        requester->source->sendResponse(requester, "Nack");
+    }
 }
 
-void CommandDispatcher::dispatchCommand(const std::string& command_name) {
-    {
-        std::lock_guard lock(map_mutex_);
-        if (const auto it = command_map_.find(command_name); it != command_map_.end()) {
-            LOG_INFO("Command '{}' received", command_name);
-            scheduler_->enqueueTask(it->second);
-        } else {
-            LOG_ERROR("Unknown command");
+void CommandDispatcher::dispatchCommand(const std::string_view message) {
+    RegisteredCommand registered_command;
+    if (resolveCommand(message, registered_command)) {
+        RECORD_EVENT(EventType::Command, -1, 0, message);
+        return;
+    }
+
+    LOG_INFO("Command '{}' received", message);
+    RECORD_EVENT(EventType::Command, static_cast<int64_t>(registered_command.priority), 0, message);
+    scheduleCommand(std::make_shared<InputInterface::Requester>(std::make_shared<CommandResponseLogger>(std::string(message)), -1),
+                    registered_command);
+}
+
+std::error_code CommandDispatcher::addSchedule(const ScheduleEntry& entry, Scheduler::TimerId& timer_id) {
+    RegisteredCommand registered_command;
+    if (auto ec = resolveCommand(entry.command, registered_command)) {
+        LOG_ERROR("Cannot schedule command '{}'", entry.command);
+        return ec;
+    }
+
+    const auto& [command, priority] = registered_command;
+    timer_id = Scheduler::INVALID_TIMER;
+    auto requester = std::make_shared<InputInterface::Requester>(std::make_shared<CommandResponseLogger>(entry.command), -1);
+    switch (entry.kind) {
+        case ScheduleEntry::Kind::Once:
+            timer_id = scheduler_->scheduleOnce(entry.interval, std::move(requester), command, priority);
+            break;
+        case ScheduleEntry::Kind::Every:
+            timer_id = scheduler_->scheduleEvery(entry.interval, std::move(requester), command, priority);
+            break;
+        case ScheduleEntry::Kind::Cron: {
+            CronSchedule schedule;
+            if (auto ec = CronSchedule::parse(entry.cron, schedule)) {
+                LOG_ERROR("Invalid cron expression '{}' for command '{}': {}", entry.cron, entry.command, ec.message());
+                return ec;
+            }
+            timer_id = scheduler_->scheduleCron(schedule, std::move(requester), command, priority);
+            break;
         }
     }
+
+    if (timer_id == Scheduler::INVALID_TIMER) {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    LOG_INFO("Command '{}' scheduled as timer {}", entry.command, timer_id);
+    return {};
+}
+
+bool CommandDispatcher::removeSchedule(const Scheduler::TimerId timer_id) {
+    return scheduler_->cancelTimer(timer_id);
 }
@@ -1,24 +1,60 @@
 #ifndef PERIPHERY_MANAGER_COMMANDDISPATCHER_H
 #define PERIPHERY_MANAGER_COMMANDDISPATCHER_H
 
-#include <unordered_map>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <vector>
 #include "TasksManager/CommandInterface.h"
 #include "TasksManager/Scheduler.h"
+#include "TasksManager/CommandCoalescer.h"
+#include "TasksManager/OperationTracker.h"
+#include "TasksManager/RcuPointer.h"
+#include "TasksManager/ScheduleEntry.h"
 #include "AppInputs/InputInterface.h"
 
+// Resolves messages of the form "verb [target] [arguments...]" against the registered commands.
+// A command registered without a target receives every word after the verb as arguments.
 class CommandDispatcher {
 public:
-    explicit CommandDispatcher(std::shared_ptr<Scheduler> scheduler);
+    explicit CommandDispatcher(std::shared_ptr<Scheduler> scheduler, std::shared_ptr<CommandCoalescer> coalescer = nullptr,
+                               std::shared_ptr<OperationTracker> operation_tracker = nullptr);
     ~CommandDispatcher() = default;
-    void registerCommand(const std::string& command_name, const std::shared_ptr<CommandInterface>& command);
-    void dispatchCommand(const std::string& command_name);
-    void dispatchCommand(std::shared_ptr<InputInterface::Requester> requester, const std::string& command_name);
+    void registerCommand(const std::string& verb, const std::shared_ptr<CommandInterface>& command,
+                         CommandPriority priority = CommandPriority::Reconfigure);
+    void registerCommand(const std::string& verb, const std::string& target, const std::shared_ptr<CommandInterface>& command,
+                         CommandPriority priority = CommandPriority::Reconfigure);
+    // Commands already being executed finish normally
+    bool unregisterCommand(const std::string& verb, const std::string& target = {});
+    // Dispatches an internally generated command, its response is logged
+    void dispatchCommand(std::string_view message);
+    void dispatchCommand(std::shared_ptr<InputInterface::Requester> requester, std::string_view message);
+    std::error_code addSchedule(const ScheduleEntry& entry, Scheduler::TimerId& timer_id);
+    bool removeSchedule(Scheduler::TimerId timer_id);
 private:
-    std::unordered_map<std::string, std::shared_ptr<CommandInterface>> command_map_;
+    struct RegisteredCommand {
+        std::shared_ptr<CommandInterface> command;
+        CommandPriority priority{CommandPriority::Reconfigure};
+    };
+    // Immutable once published, registering builds a new table and swaps it in
+    struct CommandTable {
+        struct Entry {
+            std::string verb;
+            std::string target;
+            RegisteredCommand registered_command;
+        };
+        std::vector<Entry> entries; // Sorted by verb, then target
+        const RegisteredCommand* find(std::string_view verb, std::string_view target) const;
+    };
+    std::error_code resolveCommand(std::string_view message, RegisteredCommand& registered_command) const;
+    bool scheduleCommand(std::shared_ptr<InputInterface::Requester> requester, const RegisteredCommand& registered_command);
+    RcuPointer<CommandTable> command_table_;
     std::shared_ptr<Scheduler> scheduler_;
-    std::mutex map_mutex_;
+    std::shared_ptr<CommandCoalescer> coalescer_;
+    std::shared_ptr<OperationTracker> operation_tracker_;
+    std::mutex registration_mutex_;
 };
 
 #endif //PERIPHERY_MANAGER_COMMANDDISPATCHER_H
@@ -1,13 +1,82 @@
 #ifndef PERIPHERY_MANAGER_COMMANDINTERFACE_H
 #define PERIPHERY_MANAGER_COMMANDINTERFACE_H
 
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string_view>
 #include "Logger/Logger.h"
 #include "AppInputs/InputInterface.h"
 
+// Urgency class a command is registered with. Every class gets its own queue. Workers take critical
+// tasks first, and on a strand they run ahead of the tasks queued earlier. The other classes share
+// the workers by weight.
+enum class CommandPriority {
+    Critical,
+    Reconfigure,
+    Query,
+    Background
+};
+
+inline const char* toString(const CommandPriority priority) {
+    switch (priority) {
+        case CommandPriority::Critical:
+            return "critical";
+        case CommandPriority::Reconfigure:
+            return "reconfigure";
+        case CommandPriority::Query:
+            return "query";
+        case CommandPriority::Background:
+            return "background";
+        default:
+            return "unknown";
+    }
+}
+
+// Whitespace separated words following the command target. The views point into the received
+// message and are only valid while the command is being resolved.
+class CommandArguments {
+public:
+    static constexpr size_t MAX_ARGUMENTS {16};
+    bool push(const std::string_view argument) {
+        if (count_ == MAX_ARGUMENTS) {
+            return false;
+        }
+        values_[count_++] = argument;
+        return true;
+    }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    std::string_view operator[](const size_t index) const { return values_[index]; }
+    // The original text spanning the arguments from the given index to the last one
+    std::string_view join(const size_t from) const {
+        if (from >= count_) {
+            return {};
+        }
+        const auto end = values_[count_ - 1].data() + values_[count_ - 1].size();
+        return {values_[from].data(), static_cast<size_t>(end - values_[from].data())};
+    }
+
+private:
+    std::array<std::string_view, MAX_ARGUMENTS> values_{};
+    size_t count_{0};
+};
+
 class CommandInterface {
 public:
+    static constexpr size_t NO_STRAND_KEY {0};
     virtual ~CommandInterface() = default;
     virtual void execute(std::shared_ptr<InputInterface::Requester> requester) = 0;
+    // Commands accepting arguments return a command bound to them, or nullptr if the arguments are invalid.
+    // Registered commands are shared, so arguments must not be stored in this instance.
+    virtual std::shared_ptr<CommandInterface> withArguments(const CommandArguments&) const { return nullptr; }
+    // Commands returning the same key are executed serially in submission order, others run in parallel
+    virtual size_t getStrandKey() const { return NO_STRAND_KEY; }
+    // Pending commands sharing a strand and a non-empty coalesce target collapse into the latest one
+    virtual std::string_view getCoalesceTarget() const { return {}; }
+    // Whether the other command has the same verb, target and arguments. Registered commands are shared instances,
+    // so only commands bound to arguments need to compare more than the instance.
+    virtual bool isSameCommand(const CommandInterface& other) const { return this == &other; }
 };
 
 class CommandFake : public CommandInterface {
@@ -0,0 +1,152 @@
+#include "CronSchedule.h"
+#include <charconv>
+#include <ctime>
+#include <vector>
+
+namespace {
+// Four years of days reach every valid date including February 29th, impossible ones like "30 2" never match
+constexpr int MAX_SEARCH_DAYS {4 * 366};
+
+bool parseNumber(const std::string_view text, unsigned int& value) {
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+std::vector<std::string_view> split(std::string_view text, const char delimiter) {
+    std::vector<std::string_view> parts;
+    while (true) {
+        const auto pos = text.find(delimiter);
+        parts.push_back(text.substr(0, pos));
+        if (pos == std::string_view::npos) {
+            return parts;
+        }
+        text.remove_prefix(pos + 1);
+    }
+}
+}
+
+std::error_code CronSchedule::parseField(const std::string_view field, const unsigned int min, const unsigned int max,
+                                         std::bitset<60>& values) {
+    for (const auto item: split(field, ',')) {
+        auto range = item;
+        unsigned int step = 1;
+        if (const auto slash = item.find('/'); slash != std::string_view::npos) {
+            range = item.substr(0, slash);
+            if (!parseNumber(item.substr(slash + 1), step) || step == 0) {
+                return std::make_error_code(std::errc::invalid_argument);
+            }
+        }
+
+        unsigned int first = min;
+        unsigned int last = max;
+        if (range != "*") {
+            const auto dash = range.find('-');
+            if (!parseNumber(range.substr(0, dash), first)) {
+                return std::make_error_code(std::errc::invalid_argument);
+            }
+            last = first;
+            if (dash != std::string_view::npos && !parseNumber(range.substr(dash + 1), last)) {
+                return std::make_error_code(std::errc::invalid_argument);
+            }
+        }
+        if (first < min || last > max || first > last) {
+            return std::make_error_code(std::errc::result_out_of_range);
+        }
+
+        for (auto value = first; value <= last; value += step) {
+            values.set(value);
+        }
+    }
+
+    return {};
+}
+
+std::error_code CronSchedule::parse(const std::string_view expression, CronSchedule& schedule) {
+    std::vector<std::string_view> fields;
+    for (const auto field: split(expression, ' ')) {
+        if (!field.empty()) {
+            fields.push_back(field);
+        }
+    }
+    if (fields.size() != 5) {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    CronSchedule parsed;
+    if (auto ec = parseField(fields[0], 0, 59, parsed.minutes_)) {
+        return ec;
+    }
+    if (auto ec = parseField(fields[1], 0, 23, parsed.hours_)) {
+        return ec;
+    }
+    if (auto ec = parseField(fields[2], 1, 31, parsed.days_of_month_)) {
+        return ec;
+    }
+    if (auto ec = parseField(fields[3], 1, 12, parsed.months_)) {
+        return ec;
+    }
+    if (auto ec = parseField(fields[4], 0, 7, parsed.days_of_week_)) {
+        return ec;
+    }
+    if (parsed.days_of_week_.test(7)) {
+        parsed.days_of_week_.set(0);
+    }
+    parsed.any_day_of_month_ = fields[2] == "*";
+    parsed.any_day_of_week_ = fields[4] == "*";
+    parsed.expression_ = std::string(expression);
+    schedule = std::move(parsed);
+
+    return {};
+}
+
+// As in cron, a day matches either restricted day field when both are restricted
+bool CronSchedule::matchesDay(const std::tm& time) const {
+    const auto day_of_month = days_of_month_.test(time.tm_mday);
+    const auto day_of_week = days_of_week_.test(time.tm_wday);
+    if (!any_day_of_month_ && !any_day_of_week_) {
+        return day_of_month || day_of_week;
+    }
+
+    return day_of_month && day_of_week;
+}
+
+CronSchedule::Clock::time_point CronSchedule::nextAfter(const Clock::time_point time) const {
+    // Start at the first whole minute strictly after the given time
+    auto seconds = Clock::to_time_t(time);
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    local.tm_sec = 0;
+    local.tm_min += 1;
+    local.tm_isdst = -1;
+
+    for (int days = 0; days < MAX_SEARCH_DAYS;) {
+        seconds = std::mktime(&local);
+        if (!months_.test(local.tm_mon + 1) || !matchesDay(local)) {
+            local.tm_mday += 1;
+            local.tm_hour = 0;
+            local.tm_min = 0;
+            local.tm_isdst = -1;
+            ++days;
+            continue;
+        }
+        if (!hours_.test(local.tm_hour)) {
+            local.tm_hour += 1;
+            local.tm_min = 0;
+            local.tm_isdst = -1;
+            continue;
+        }
+        if (!minutes_.test(local.tm_min)) {
+            local.tm_min += 1;
+            local.tm_isdst = -1;
+            continue;
+        }
+
+        return Clock::from_time_t(seconds);
+    }
+
+    return Clock::time_point::max();
+}
+
+const std::string& CronSchedule::toString() const {
+    return expression_;
+}
@@ -0,0 +1,32 @@
+#ifndef PERIPHERY_MANAGER_CRONSCHEDULE_H
+#define PERIPHERY_MANAGER_CRONSCHEDULE_H
+
+#include <bitset>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Five field cron expression "minute hour day-of-month month day-of-week" in local time. Fields accept
+// '*', values, ranges "a-b", lists "a,b" and steps "*/n" or "a-b/n". Day-of-week 0 and 7 are Sunday.
+class CronSchedule {
+public:
+    using Clock = std::chrono::system_clock;
+    static std::error_code parse(std::string_view expression, CronSchedule& schedule);
+    Clock::time_point nextAfter(Clock::time_point time) const;
+    const std::string& toString() const;
+
+private:
+    static std::error_code parseField(std::string_view field, unsigned int min, unsigned int max, std::bitset<60>& values);
+    bool matchesDay(const std::tm& time) const;
+    std::bitset<60> minutes_;
+    std::bitset<60> hours_;
+    std::bitset<60> days_of_month_;
+    std::bitset<60> months_;
+    std::bitset<60> days_of_week_;
+    bool any_day_of_month_{true};
+    bool any_day_of_week_{true};
+    std::string expression_;
+};
+
+#endif //PERIPHERY_MANAGER_CRONSCHEDULE_H
@@ -0,0 +1,105 @@
+#ifndef PERIPHERY_MANAGER_MPMCQUEUE_H
+#define PERIPHERY_MANAGER_MPMCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+// Bounded lock-free multi-producer multi-consumer queue (Vyukov). Items are stored inline in
+// a preallocated ring, so pushing and popping never allocate.
+template<typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity) : capacity_(roundUpToPowerOfTwo(capacity)), mask_(capacity_ - 1),
+                                          cells_(std::make_unique<Cell[]>(capacity_)) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    template<typename... Args>
+    bool tryPush(Args&&... args) {
+        Cell* cell;
+        size_t position = enqueue_position_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[position & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0) {
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false; // Full
+            } else {
+                position = enqueue_position_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->item.emplace(std::forward<Args>(args)...);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        Cell* cell;
+        size_t position = dequeue_position_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[position & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+            if (difference == 0) {
+                if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false; // Empty
+            } else {
+                position = dequeue_position_.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = std::move(*cell->item);
+        cell->item.reset();
+        cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return enqueue_position_.load(std::memory_order_acquire) == dequeue_position_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE {64};
+
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        std::optional<T> item;
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t power = 2;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_position_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_position_{0};
+};
+
+#endif //PERIPHERY_MANAGER_MPMCQUEUE_H
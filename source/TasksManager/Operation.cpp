@@ -0,0 +1,121 @@
+#include "Operation.h"
+#include <algorithm>
+#include <array>
+#include <fmt/format.h>
+#include "EventLog/EventLog.h"
+#include "Logger/Logger.h"
+#include "TasksManager/OperationTracker.h"
+
+Operation::Operation(const uint64_t id, std::shared_ptr<Requester> requester, const Clock::time_point deadline,
+                     std::weak_ptr<OperationTracker> tracker)
+    : id_(id), requester_(std::move(requester)), owner_(requester_ ? requester_->source.get() : nullptr), start_time_(Clock::now()), deadline_(deadline),
+      tracker_(std::move(tracker)) {}
+
+void Operation::sendResponse(std::shared_ptr<Requester>, const std::string_view response) {
+    finish(Status::Completed, response);
+}
+
+void Operation::onAbandon(std::shared_ptr<Requester>, std::function<void()> handler) {
+    {
+        std::lock_guard lock(abandon_mutex_);
+        if (status_ == Status::Pending) {
+            on_abandon_ = std::move(handler);
+            return;
+        }
+    }
+    if (status_ != Status::Completed) {
+        handler();
+    }
+}
+
+void Operation::accept() {
+    std::lock_guard lock(response_mutex_);
+    if (status_ != Status::Pending || !requester_) {
+        return;
+    }
+
+    std::array<char, MAX_RESPONSE_SIZE> buffer{};
+    const auto result = fmt::format_to_n(buffer.data(), buffer.size(), "Accepted id={}\n", id_);
+    requester_->source->sendResponse(requester_, std::string_view(buffer.data(), result.size));
+}
+
+bool Operation::cancel() {
+    return finish(Status::Cancelled, "Nack cancelled");
+}
+
+bool Operation::expire() {
+    return finish(Status::TimedOut, "Nack timeout");
+}
+
+namespace {
+const char* toString(const Operation::Status status) {
+    switch (status) {
+        case Operation::Status::Completed:
+            return "completed";
+        case Operation::Status::TimedOut:
+            return "timed out";
+        case Operation::Status::Cancelled:
+            return "cancelled";
+        default:
+            return "pending";
+    }
+}
+}
+
+bool Operation::finish(const Status status, const std::string_view response) {
+    auto expected = Status::Pending;
+    if (!status_.compare_exchange_strong(expected, status)) {
+        return false;
+    }
+
+    // The work behind an abandoned operation is given up before the requester hears about it
+    std::function<void()> on_abandon;
+    {
+        std::lock_guard lock(abandon_mutex_);
+        on_abandon.swap(on_abandon_);
+    }
+    if (on_abandon && status != Status::Completed) {
+        on_abandon();
+    }
+
+    const auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_time_).count();
+    {
+        std::lock_guard lock(response_mutex_);
+        if (requester_) {
+            std::array<char, MAX_RESPONSE_SIZE> buffer{};
+            const auto result = fmt::format_to_n(buffer.data(), buffer.size(), "{} id={} duration_us={}\n", response,
+                                                 id_, duration_us);
+            // A truncated response still ends the line
+            const auto size = std::min(result.size, buffer.size());
+            buffer[size - 1] = '\n';
+            requester_->source->sendResponse(requester_, std::string_view(buffer.data(), size));
+            // Only the finishing thread gets here, releasing the requester lets its connection reuse it
+            requester_.reset();
+        }
+    }
+    LOG_DEBUG("Operation {} {} in {}us: {}", id_, toString(status), duration_us, response);
+    RECORD_EVENT(EventType::CommandResult, static_cast<int64_t>(id_), duration_us,
+                 status == Status::Completed ? response : std::string_view(toString(status)));
+
+    if (const auto tracker = tracker_.lock()) {
+        tracker->finished(*this);
+    }
+
+    return true;
+}
+
+bool Operation::isDone() const {
+    return status_ != Status::Pending;
+}
+
+uint64_t Operation::getId() const {
+    return id_;
+}
+
+const InputInterface* Operation::getOwner() const {
+    return owner_;
+}
+
+Operation::Clock::time_point Operation::getDeadline() const {
+    return deadline_;
+}
@@ -0,0 +1,65 @@
+#ifndef PERIPHERY_MANAGER_OPERATION_H
+#define PERIPHERY_MANAGER_OPERATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include "AppInputs/InputInterface.h"
+
+class OperationTracker;
+
+// A received command tracked from dispatch until its single response. The command responds
+// through the operation, which forwards the first outcome (completion, timeout or cancellation)
+// to the original requester and drops anything later. The requester is told the id once the
+// command is accepted (`Accepted id=N`), the outcome carries the id and the measured duration
+// (`Ack id=N duration_us=D`, `Nack timeout id=N duration_us=D`). Both are sent as lines.
+class Operation : public InputInterface {
+public:
+    using Clock = std::chrono::steady_clock;
+    enum class Status {
+        Pending,
+        Completed,
+        TimedOut,
+        Cancelled
+    };
+    Operation(uint64_t id, std::shared_ptr<Requester> requester, Clock::time_point deadline,
+              std::weak_ptr<OperationTracker> tracker);
+    ~Operation() override = default;
+    void sendResponse(std::shared_ptr<Requester> requester, std::string_view response) override;
+    void onAbandon(std::shared_ptr<Requester> requester, std::function<void()> handler) override;
+    void accept();
+    bool cancel();
+    bool expire();
+    bool isDone() const;
+    uint64_t getId() const;
+    // The source the command came from, only valid while the operation is pending
+    const InputInterface* getOwner() const;
+    Clock::time_point getDeadline() const;
+
+private:
+    friend class OperationTracker;
+    static constexpr size_t MAX_RESPONSE_SIZE {1024};
+    bool finish(Status status, std::string_view response);
+    const uint64_t id_;
+    std::shared_ptr<Requester> requester_;
+    const InputInterface* const owner_;
+    // Keeps the acceptance ahead of the outcome when a timeout or cancellation races with it
+    std::mutex response_mutex_;
+    const Clock::time_point start_time_;
+    const Clock::time_point deadline_;
+    const std::weak_ptr<OperationTracker> tracker_;
+    std::atomic<Status> status_{Status::Pending};
+    std::mutex abandon_mutex_;
+    std::function<void()> on_abandon_;
+    // Pending operations form a list in start order, which is also deadline order. The tracker guards
+    // these with its mutex, the list owns its operations through self_.
+    Operation* previous_{nullptr};
+    Operation* next_{nullptr};
+    std::shared_ptr<Operation> self_;
+};
+
+#endif //PERIPHERY_MANAGER_OPERATION_H
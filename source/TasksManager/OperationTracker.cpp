@@ -0,0 +1,143 @@
+#include "OperationTracker.h"
+#include <vector>
+#include "Logger/Logger.h"
+
+OperationTracker::OperationTracker(const std::chrono::milliseconds default_deadline)
+    : default_deadline_(default_deadline) {}
+
+OperationTracker::~OperationTracker() {
+    deinit();
+}
+
+void OperationTracker::init() {
+    stop_ = false;
+    timer_thread_ = std::thread(&OperationTracker::runTimer, this);
+}
+
+void OperationTracker::deinit() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    timer_condition_.notify_all();
+    if (timer_thread_.joinable()) {
+        timer_thread_.join();
+    }
+
+    // The list owns the pending operations, they are dropped unanswered like the queued commands
+    std::lock_guard lock(mutex_);
+    while (oldest_) {
+        const auto operation = oldest_->self_;
+        unlink(*operation);
+    }
+}
+
+std::shared_ptr<InputInterface::Requester> OperationTracker::start(std::shared_ptr<InputInterface::Requester> requester) {
+    const auto source_id = requester ? requester->source_id : -1;
+    std::shared_ptr<Operation> operation;
+    bool earliest_deadline{false};
+    {
+        std::lock_guard lock(mutex_);
+        const auto deadline = Operation::Clock::now() + default_deadline_;
+        operation = std::allocate_shared<Operation>(PoolAllocator<Operation>(operation_pool_), next_id_++,
+                                                    std::move(requester), deadline, weak_from_this());
+        link(operation);
+        earliest_deadline = oldest_ == operation.get();
+    }
+
+    if (earliest_deadline) {
+        timer_condition_.notify_one();
+    }
+
+    return std::allocate_shared<InputInterface::Requester>(PoolAllocator<InputInterface::Requester>(requester_pool_),
+                                                           std::move(operation), source_id);
+}
+
+// Deadlines are the start time plus the same default, so appending keeps the list ordered by deadline
+void OperationTracker::link(const std::shared_ptr<Operation>& operation) {
+    operation->self_ = operation;
+    operation->previous_ = newest_;
+    operation->next_ = nullptr;
+    if (newest_) {
+        newest_->next_ = operation.get();
+    } else {
+        oldest_ = operation.get();
+    }
+    newest_ = operation.get();
+}
+
+void OperationTracker::unlink(Operation& operation) {
+    if (!operation.self_) {
+        return;
+    }
+    (operation.previous_ ? operation.previous_->next_ : oldest_) = operation.next_;
+    (operation.next_ ? operation.next_->previous_ : newest_) = operation.previous_;
+    operation.previous_ = nullptr;
+    operation.next_ = nullptr;
+    // Callers hold their own reference, so this never destroys the operation
+    operation.self_.reset();
+}
+
+void OperationTracker::finished(Operation& operation) {
+    std::lock_guard lock(mutex_);
+    unlink(operation);
+}
+
+bool OperationTracker::cancel(const uint64_t id) {
+    std::shared_ptr<Operation> operation;
+    {
+        std::lock_guard lock(mutex_);
+        for (auto pending = oldest_; pending; pending = pending->next_) {
+            if (pending->getId() == id) {
+                operation = pending->self_;
+                break;
+            }
+        }
+    }
+
+    return operation && operation->cancel();
+}
+
+size_t OperationTracker::cancelAll(const InputInterface* const owner, const uint64_t except_id) {
+    std::vector<std::shared_ptr<Operation>> operations;
+    {
+        std::lock_guard lock(mutex_);
+        for (auto pending = oldest_; pending; pending = pending->next_) {
+            if (pending->getId() != except_id && (!owner || pending->getOwner() == owner)) {
+                operations.push_back(pending->self_);
+            }
+        }
+    }
+
+    size_t cancelled{0};
+    for (const auto& operation: operations) {
+        cancelled += operation->cancel() ? 1 : 0;
+    }
+    LOG_INFO("Cancelled {} pending operations", cancelled);
+
+    return cancelled;
+}
+
+void OperationTracker::runTimer() {
+    std::unique_lock lock(mutex_);
+    while (!stop_) {
+        if (!oldest_) {
+            timer_condition_.wait(lock);
+            continue;
+        }
+
+        if (const auto deadline = oldest_->getDeadline(); deadline > Operation::Clock::now()) {
+            timer_condition_.wait_until(lock, deadline);
+            continue;
+        }
+
+        // Expiring responds and calls finished(), which needs the lock
+        const auto operation = oldest_->self_;
+        unlink(*operation);
+        lock.unlock();
+        if (operation->expire()) {
+            LOG_WARN("Operation {} timed out", operation->getId());
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef PERIPHERY_MANAGER_OPERATIONTRACKER_H
+#define PERIPHERY_MANAGER_OPERATIONTRACKER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "TasksManager/Operation.h"
+#include "TasksManager/PoolAllocator.h"
+
+// Assigns ids to operations, answers them with a timeout once their deadline passes and
+// allows cancelling the pending ones. Operations and their requesters come from a pool and every
+// operation shares the same deadline, so pending ones are kept in a list instead of an ordered
+// index and tracking a command allocates nothing in the steady state.
+class OperationTracker : public std::enable_shared_from_this<OperationTracker> {
+public:
+    explicit OperationTracker(std::chrono::milliseconds default_deadline);
+    ~OperationTracker();
+    void init();
+    void deinit();
+    std::shared_ptr<InputInterface::Requester> start(std::shared_ptr<InputInterface::Requester> requester);
+    bool cancel(uint64_t id);
+    // Cancels the pending operations of one source, or of every source if owner is nullptr
+    size_t cancelAll(const InputInterface* owner, uint64_t except_id);
+    void finished(Operation& operation);
+
+private:
+    void runTimer();
+    void link(const std::shared_ptr<Operation>& operation);
+    void unlink(Operation& operation);
+    std::chrono::milliseconds default_deadline_;
+    std::shared_ptr<BlockPool> operation_pool_{std::make_shared<BlockPool>()};
+    std::shared_ptr<BlockPool> requester_pool_{std::make_shared<BlockPool>()};
+    Operation* oldest_{nullptr};
+    Operation* newest_{nullptr};
+    uint64_t next_id_{1};
+    std::mutex mutex_;
+    std::condition_variable timer_condition_;
+    std::thread timer_thread_;
+    bool stop_{false};
+};
+
+#endif //PERIPHERY_MANAGER_OPERATIONTRACKER_H
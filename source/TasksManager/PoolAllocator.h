@@ -0,0 +1,102 @@
+#ifndef PERIPHERY_MANAGER_POOLALLOCATOR_H
+#define PERIPHERY_MANAGER_POOLALLOCATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+
+// Free list of equally sized blocks. The block size is taken from the first allocation, larger
+// requests go to the heap. Freed blocks are kept until the pool is destroyed, so a steady workload
+// stops allocating once the pool has grown to its peak.
+class BlockPool {
+public:
+    BlockPool() = default;
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    ~BlockPool() {
+        while (free_blocks_) {
+            const auto next = free_blocks_->next;
+            ::operator delete(free_blocks_);
+            free_blocks_ = next;
+        }
+    }
+
+    void* allocate(const size_t size) {
+        {
+            std::lock_guard lock(mutex_);
+            if (block_size_ == 0) {
+                block_size_ = std::max(size, sizeof(FreeBlock));
+            }
+            if (size > block_size_) {
+                return ::operator new(size);
+            }
+            if (free_blocks_) {
+                const auto block = free_blocks_;
+                free_blocks_ = block->next;
+                return block;
+            }
+        }
+        return ::operator new(block_size_);
+    }
+
+    void deallocate(void* pointer, const size_t size) noexcept {
+        {
+            std::lock_guard lock(mutex_);
+            if (size <= block_size_) {
+                free_blocks_ = new(pointer) FreeBlock{free_blocks_};
+                return;
+            }
+        }
+        ::operator delete(pointer);
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    std::mutex mutex_;
+    size_t block_size_{0};
+    FreeBlock* free_blocks_{nullptr};
+};
+
+// Allocator drawing from a shared BlockPool. Meant for std::allocate_shared, which keeps a copy of the
+// allocator in the control block, so the pool lives until the last object created from it is freed.
+template<typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Pooled blocks have the default alignment");
+
+    explicit PoolAllocator(std::shared_ptr<BlockPool> pool) noexcept : pool_(std::move(pool)) {}
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : pool_(other.pool_) {}
+
+    T* allocate(const size_t count) {
+        return static_cast<T*>(pool_->allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, const size_t count) noexcept {
+        pool_->deallocate(pointer, count * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>& other) const noexcept {
+        return pool_ == other.pool_;
+    }
+
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>& other) const noexcept {
+        return pool_ != other.pool_;
+    }
+
+private:
+    template<typename U>
+    friend class PoolAllocator;
+    std::shared_ptr<BlockPool> pool_;
+};
+
+#endif //PERIPHERY_MANAGER_POOLALLOCATOR_H
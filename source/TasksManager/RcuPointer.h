@@ -0,0 +1,59 @@
+#ifndef PERIPHERY_MANAGER_RCUPOINTER_H
+#define PERIPHERY_MANAGER_RCUPOINTER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+// Pointer to an immutable object that is replaced as a whole. Readers never lock or allocate, they
+// announce themselves on one of two counters picked by the current epoch. The writer publishes the
+// replacement, then flips the epoch twice and waits for each counter to drain, after which no reader
+// can still hold the old object. Writers must be serialized by the caller.
+template<typename T>
+class RcuPointer {
+public:
+    explicit RcuPointer(std::unique_ptr<const T> initial) : current_(initial.release()) {}
+
+    RcuPointer(const RcuPointer&) = delete;
+    RcuPointer& operator=(const RcuPointer&) = delete;
+
+    ~RcuPointer() {
+        delete current_.load();
+    }
+
+    // The object is only valid within the function, results must not refer into it
+    template<typename Function>
+    auto read(Function&& function) const {
+        auto& readers = readers_[epoch_.load() & 1];
+        readers.fetch_add(1);
+        const ReadGuard guard{readers};
+        return function(*current_.load());
+    }
+
+    void update(std::unique_ptr<const T> replacement) {
+        const auto previous = current_.exchange(replacement.release());
+        waitForReaders(epoch_.fetch_add(1));
+        waitForReaders(epoch_.fetch_add(1));
+        delete previous;
+    }
+
+private:
+    struct ReadGuard {
+        std::atomic<size_t>& readers;
+        ~ReadGuard() { readers.fetch_sub(1); }
+    };
+
+    void waitForReaders(const size_t epoch) const {
+        while (readers_[epoch & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::atomic<const T*> current_;
+    std::atomic<size_t> epoch_{0};
+    mutable std::array<std::atomic<size_t>, 2> readers_{};
+};
+
+#endif //PERIPHERY_MANAGER_RCUPOINTER_H
@@ -0,0 +1,20 @@
+#ifndef PERIPHERY_MANAGER_SCHEDULEENTRY_H
+#define PERIPHERY_MANAGER_SCHEDULEENTRY_H
+
+#include <chrono>
+#include <string>
+
+// Command line armed as a timer, from the pipeline file or the schedule command
+struct ScheduleEntry {
+    enum class Kind {
+        Once,
+        Every,
+        Cron
+    };
+    std::string command;
+    Kind kind{Kind::Once};
+    std::chrono::milliseconds interval{0};
+    std::string cron;
+};
+
+#endif //PERIPHERY_MANAGER_SCHEDULEENTRY_H
@@ -0,0 +1,32 @@
+#include "ScheduleParser.h"
+
+ScheduleParser::ScheduleParser(const std::string& file_name) : file_(std::make_unique<File>(file_name)) {}
+
+std::vector<ScheduleEntry> ScheduleParser::getAllSchedules() const {
+    return parseSchedules(YAML::Load(file_->getContent())["schedules"]);
+}
+
+std::vector<ScheduleEntry> ScheduleParser::parseSchedules(const YAML::Node& schedule_list) {
+    std::vector<ScheduleEntry> schedules;
+
+    for (const auto& schedule : schedule_list) {
+        ScheduleEntry entry;
+        entry.command = schedule["command"].as<std::string>();
+        if (schedule["cron"].IsDefined()) {
+            entry.kind = ScheduleEntry::Kind::Cron;
+            entry.cron = schedule["cron"].as<std::string>();
+        } else if (schedule["every_ms"].IsDefined()) {
+            entry.kind = ScheduleEntry::Kind::Every;
+            entry.interval = std::chrono::milliseconds(schedule["every_ms"].as<unsigned int>());
+        } else if (schedule["after_ms"].IsDefined()) {
+            entry.kind = ScheduleEntry::Kind::Once;
+            entry.interval = std::chrono::milliseconds(schedule["after_ms"].as<unsigned int>());
+        } else {
+            LOG_ERROR("Schedule for command '{}' has no timing, expected after_ms, every_ms or cron", entry.command);
+            continue;
+        }
+        schedules.push_back(std::move(entry));
+    }
+
+    return schedules;
+}
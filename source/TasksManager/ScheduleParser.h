@@ -0,0 +1,24 @@
+#ifndef PERIPHERY_MANAGER_SCHEDULEPARSER_H
+#define PERIPHERY_MANAGER_SCHEDULEPARSER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <File/File.h>
+#include <yaml-cpp/yaml.h>
+#include "TasksManager/ScheduleEntry.h"
+
+// Reads the optional top level "schedules" list, each entry holds a command line and one of
+// "after_ms", "every_ms" or "cron"
+class ScheduleParser {
+public:
+    explicit ScheduleParser(const std::string& file_name);
+    ~ScheduleParser() = default;
+    std::vector<ScheduleEntry> getAllSchedules() const;
+    // Entries of an already loaded "schedules" list
+    static std::vector<ScheduleEntry> parseSchedules(const YAML::Node& schedules);
+private:
+    std::unique_ptr<File> file_;
+};
+
+#endif //PERIPHERY_MANAGER_SCHEDULEPARSER_H
@@ -1,24 +1,62 @@
 #include "Scheduler.h"
+#include <algorithm>
 #include <utility>
 
-Scheduler::Scheduler(const size_t thread_count) : thread_count_(thread_count) {}
+// Busy polling before parking only pays off when another core can produce in the meantime
+constexpr unsigned int SPIN_ITERATIONS {2000};
+
+// Weighted pick order for the classes below critical: reconfigure 4, query 2, background 1.
+// A worker takes critical tasks first, then starts at the class picked for it and falls back to
+// the others by priority.
+constexpr std::array<CommandPriority, 7> PICK_ORDER {
+    CommandPriority::Reconfigure, CommandPriority::Query, CommandPriority::Reconfigure, CommandPriority::Background,
+    CommandPriority::Reconfigure, CommandPriority::Query, CommandPriority::Reconfigure
+};
+constexpr std::array<CommandPriority, 3> WEIGHTED_PRIORITIES {
+    CommandPriority::Reconfigure, CommandPriority::Query, CommandPriority::Background
+};
+
+Scheduler::Scheduler(const size_t thread_count, const size_t queue_capacity)
+    : strands_(std::make_unique<Strand[]>(STRAND_COUNT)), thread_count_(thread_count),
+      spin_count_(std::thread::hardware_concurrency() > 1 ? SPIN_ITERATIONS : 0) {
+    for (auto& queue: queues_) {
+        queue = std::make_unique<MpmcQueue<Task>>(queue_capacity);
+    }
+}
 
 Scheduler::~Scheduler() {
     deinit();
+
+    for (size_t i = 0; i < PRIORITY_COUNT; ++i) {
+        const auto priority = static_cast<CommandPriority>(i);
+        if (const auto stats = getQueueWaitStats(priority); stats.count > 0) {
+            LOG_DEBUG("Scheduler {} queue wait: {} tasks, avg {}us, max {}us", toString(priority), stats.count,
+                      stats.total_us / stats.count, stats.max_us);
+        }
+    }
 }
 
 void Scheduler::init() {
+    stop_ = false;
     for (size_t i = 0; i < thread_count_; ++i) {
         worker_threads_.emplace_back(&Scheduler::workerFunction, this);
     }
+    timer_thread_ = std::thread(&Scheduler::runTimers, this);
 }
 
 void Scheduler::deinit() {
     {
-        std::unique_lock lock(queue_mutex_);
+        std::lock_guard lock(park_mutex_);
         stop_ = true;
     }
     task_available_condition_.notify_all();
+    {
+        std::lock_guard lock(timer_mutex_);
+    }
+    timer_condition_.notify_all();
+    if (timer_thread_.joinable()) {
+        timer_thread_.join();
+    }
     for (auto& thread: worker_threads_) {
         if(thread.joinable()) {
             thread.join();
@@ -28,43 +66,344 @@ void Scheduler::deinit() {
     worker_threads_.clear();
 }
 
+bool Scheduler::waitForTask(Task& task) {
+    for (unsigned int i = 0; i < spin_count_; ++i) {
+        if (tryPopTask(task)) {
+            return true;
+        }
+        if (stop_.load(std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    std::unique_lock lock(park_mutex_);
+    parked_workers_.fetch_add(1);
+    // Pairs with the fence in notifyWorker: either the producer sees a parked worker, or we see its task
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    task_available_condition_.wait(lock, [this, &task] { return tryPopTask(task) || stop_; });
+    parked_workers_.fetch_sub(1);
+
+    return task.isValid();
+}
+
 void Scheduler::workerFunction() {
     while (true) {
-        std::shared_ptr<Task> task;
+        Task task;
 
-        {
-            std::unique_lock lock(queue_mutex_);
-            task_available_condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
-            if (stop_ && tasks_.empty()) {
+        if (!waitForTask(task)) {
+            if (stop_ && allQueuesEmpty()) {
                 return;
             }
-            task = tasks_.front();
-            tasks_.pop();
+            continue;
         }
 
-        task->command->execute(task->requester);
+        if (task.command) {
+            executeTask(task);
+        } else {
+            runStrand(task.strand);
+        }
     }
 }
 
-void Scheduler::enqueueTask(const std::shared_ptr<CommandInterface>& command) {
-    {
-        std::unique_lock lock(queue_mutex_);
-        const auto task = std::make_shared<Task>(nullptr, command);
-        tasks_.push(task);
+MpmcQueue<Scheduler::Task>& Scheduler::getQueue(const CommandPriority priority) {
+    return *queues_.at(static_cast<size_t>(priority));
+}
+
+bool Scheduler::tryPopTask(Task& task) {
+    if (getQueue(CommandPriority::Critical).tryPop(task)) {
+        return true;
+    }
+
+    const auto picked = PICK_ORDER.at(pick_counter_.fetch_add(1, std::memory_order_relaxed) % PICK_ORDER.size());
+    if (getQueue(picked).tryPop(task)) {
+        return true;
+    }
+
+    for (const auto priority: WEIGHTED_PRIORITIES) {
+        if (priority != picked && getQueue(priority).tryPop(task)) {
+            return true;
+        }
     }
-    task_available_condition_.notify_one();
+
+    return false;
 }
 
-void Scheduler::enqueueTask(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command) {
-    {
-        std::unique_lock lock(queue_mutex_);
-        const auto task = std::make_shared<Task>(std::move(requester), command);
-        tasks_.push(task);
+bool Scheduler::allQueuesEmpty() const {
+    for (const auto& queue: queues_) {
+        if (!queue->empty()) {
+            return false;
+        }
     }
-    task_available_condition_.notify_one();
+    return true;
+}
+
+void Scheduler::recordQueueWait(const Task& task) {
+    const auto wait_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - task.enqueue_time).count());
+    auto& stats = queue_wait_stats_.at(static_cast<size_t>(task.priority));
+    stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.total_us.fetch_add(wait_us, std::memory_order_relaxed);
+    auto max_us = stats.max_us.load(std::memory_order_relaxed);
+    while (wait_us > max_us && !stats.max_us.compare_exchange_weak(max_us, wait_us, std::memory_order_relaxed)) {}
+}
+
+void Scheduler::executeTask(Task& task) {
+    recordQueueWait(task);
+    task.command->execute(task.requester);
+}
+
+Scheduler::QueueWaitStats Scheduler::getQueueWaitStats(const CommandPriority priority) const {
+    const auto& stats = queue_wait_stats_.at(static_cast<size_t>(priority));
+    return {stats.count.load(std::memory_order_relaxed), stats.total_us.load(std::memory_order_relaxed),
+            stats.max_us.load(std::memory_order_relaxed)};
+}
+
+// A strand can have more tokens than runs, because critical tasks issue their own to get ahead of a
+// token waiting in a slower class. The claim keeps the strand on one worker: a worker failing to
+// claim drops its token, the holder checks for pending tasks again after releasing the claim.
+bool Scheduler::claimStrand(Strand& strand) {
+    while (strand.pending.load() > 0) {
+        if (strand.claimed.exchange(true)) {
+            return false;
+        }
+        if (strand.pending.load() > 0) {
+            return true;
+        }
+        strand.claimed.store(false);
+    }
+    return false;
+}
+
+void Scheduler::runStrand(const size_t strand_index) {
+    auto& strand = strands_[strand_index];
+    while (claimStrand(strand)) {
+        // Pending is only raised after a task was pushed, but an earlier producer may still be
+        // publishing its slot, so wait for the head of the strand to become visible
+        Task task;
+        while (true) {
+            if (strand.critical_tasks.tryPop(task)) {
+                strand.critical_pending.fetch_sub(1);
+                break;
+            }
+            if (strand.tasks.tryPop(task)) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+        executeTask(task);
+
+        strand.pending.fetch_sub(1);
+        strand.claimed.store(false);
+
+        // Hand the strand back to the pool so other work can interleave. The token keeps the class
+        // of the task that just ran. Critical tasks waiting on the strand run next on this worker
+        // instead, and so does everything else when the token queue is full.
+        if (strand.critical_pending.load() == 0 && strand.pending.load() > 0 && pushToken(strand_index, task.priority)) {
+            return;
+        }
+    }
+}
+
+void Scheduler::notifyWorker() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_workers_.load(std::memory_order_relaxed) > 0) {
+        { std::lock_guard lock(park_mutex_); }
+        task_available_condition_.notify_one();
+    }
+}
+
+bool Scheduler::pushToken(const size_t strand_index, const CommandPriority priority) {
+    if (!getQueue(priority).tryPush(strand_index, priority)) {
+        return false;
+    }
+
+    notifyWorker();
+    return true;
+}
+
+// Keys are mostly object addresses, whose low bits are zero from alignment. Fibonacci hashing mixes
+// the remaining bits and takes the top ones, so neighbouring objects land on different strands.
+size_t Scheduler::getStrandIndex(const size_t strand_key) {
+    return static_cast<size_t>(((static_cast<uint64_t>(strand_key) >> 4) * 0x9E3779B97F4A7C15ULL) >> (64 - STRAND_BITS));
+}
+
+bool Scheduler::pushStrandTask(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command,
+                               const CommandPriority priority) {
+    const auto strand_index = getStrandIndex(command->getStrandKey());
+    auto& strand = strands_[strand_index];
+    const bool critical = priority == CommandPriority::Critical;
+    auto& tasks = critical ? strand.critical_tasks : strand.tasks;
+    // Raised first, so the worker running the strand keeps it for this task rather than handing it back
+    if (critical) {
+        strand.critical_pending.fetch_add(1);
+    }
+    if (!tasks.tryPush(std::move(requester), command, priority)) {
+        if (critical) {
+            strand.critical_pending.fetch_sub(1);
+        }
+        LOG_ERROR("Strand {} {} queue is full ({} tasks)", strand_index, toString(priority), tasks.capacity());
+        return false;
+    }
+
+    // The producer that makes the strand non-empty issues its token. A critical task also issues one
+    // when the strand already waits in a slower class.
+    if (strand.pending.fetch_add(1) == 0 || critical) {
+        while (!pushToken(strand_index, priority)) {
+            std::this_thread::yield();
+        }
+    }
+
+    return true;
+}
+
+bool Scheduler::pushTask(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command,
+                         const CommandPriority priority) {
+    if (command->getStrandKey() != CommandInterface::NO_STRAND_KEY) {
+        return pushStrandTask(std::move(requester), command, priority);
+    }
+
+    auto& queue = getQueue(priority);
+    if (!queue.tryPush(std::move(requester), command, priority)) {
+        LOG_ERROR("Task queue {} is full ({} tasks)", toString(priority), queue.capacity());
+        return false;
+    }
+
+    notifyWorker();
+    return true;
+}
+
+bool Scheduler::enqueueTask(const std::shared_ptr<CommandInterface>& command, const CommandPriority priority) {
+    return pushTask(nullptr, command, priority);
+}
+
+bool Scheduler::enqueueTask(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command,
+                            const CommandPriority priority) {
+    return pushTask(std::move(requester), command, priority);
 }
 
 size_t Scheduler::getRunningThreadCount() const {
     return worker_threads_.size();
 }
 
+uint64_t Scheduler::toTick(const Clock::time_point time, const bool round_up) const {
+    const auto elapsed = std::max(time - timer_epoch_, Clock::duration::zero());
+    const auto ticks = elapsed / TIMER_TICK;
+    return static_cast<uint64_t>(round_up && elapsed % TIMER_TICK != Clock::duration::zero() ? ticks + 1 : ticks);
+}
+
+Scheduler::TimerId Scheduler::addTimer(Timer timer) {
+    std::lock_guard lock(timer_mutex_);
+    // An idle wheel is not ticking, move it to the present instead of replaying the idle ticks
+    if (timers_.empty()) {
+        timer_wheel_.reset(toTick(Clock::now(), false));
+    }
+
+    const auto id = next_timer_id_++;
+    timer_wheel_.insert(id, toTick(timer.expiry, true));
+    timers_.emplace(id, std::move(timer));
+    timer_condition_.notify_one();
+
+    return id;
+}
+
+Scheduler::TimerId Scheduler::scheduleOnce(const std::chrono::milliseconds delay, std::shared_ptr<InputInterface::Requester> requester,
+                                           const std::shared_ptr<CommandInterface>& command, const CommandPriority priority) {
+    return addTimer({std::move(requester), command, priority, Clock::now() + delay, {}, std::nullopt, {}});
+}
+
+Scheduler::TimerId Scheduler::scheduleEvery(const std::chrono::milliseconds period, std::shared_ptr<InputInterface::Requester> requester,
+                                            const std::shared_ptr<CommandInterface>& command, const CommandPriority priority) {
+    if (period < TIMER_TICK) {
+        LOG_ERROR("Timer period {}ms is shorter than the timer tick", period.count());
+        return INVALID_TIMER;
+    }
+
+    return addTimer({std::move(requester), command, priority, Clock::now() + period, period, std::nullopt, {}});
+}
+
+Scheduler::TimerId Scheduler::scheduleCron(const CronSchedule& schedule, std::shared_ptr<InputInterface::Requester> requester,
+                                           const std::shared_ptr<CommandInterface>& command, const CommandPriority priority) {
+    const auto wall_now = CronSchedule::Clock::now();
+    const auto cron_time = schedule.nextAfter(wall_now);
+    if (cron_time == CronSchedule::Clock::time_point::max()) {
+        LOG_ERROR("Cron schedule '{}' never fires", schedule.toString());
+        return INVALID_TIMER;
+    }
+
+    const auto expiry = Clock::now() + std::chrono::duration_cast<Clock::duration>(cron_time - wall_now);
+    return addTimer({std::move(requester), command, priority, expiry, {}, schedule, cron_time});
+}
+
+bool Scheduler::cancelTimer(const TimerId id) {
+    // The wheel entry stays behind and is dropped when it expires
+    std::lock_guard lock(timer_mutex_);
+    return timers_.erase(id) > 0;
+}
+
+// Periodic timers advance from their previous expiry rather than from the firing time, so late
+// firings under load do not shift the schedule. Periods missed entirely are skipped.
+bool Scheduler::rearmTimer(const TimerId id, Timer& timer, const Clock::time_point now) {
+    if (timer.period != Clock::duration::zero()) {
+        timer.expiry += timer.period;
+        if (timer.expiry <= now) {
+            const auto missed = (now - timer.expiry) / timer.period + 1;
+            timer.expiry += missed * timer.period;
+            LOG_WARN("Timer {} missed {} periods", id, missed);
+        }
+    } else if (timer.cron) {
+        const auto wall_now = CronSchedule::Clock::now();
+        timer.cron_time = timer.cron->nextAfter(std::max(timer.cron_time, wall_now));
+        if (timer.cron_time == CronSchedule::Clock::time_point::max()) {
+            return false;
+        }
+        timer.expiry = now + std::chrono::duration_cast<Clock::duration>(timer.cron_time - wall_now);
+    } else {
+        return false;
+    }
+
+    timer_wheel_.insert(id, toTick(timer.expiry, true));
+    return true;
+}
+
+void Scheduler::runTimers() {
+    std::vector<TimerId> expired;
+    std::vector<Task> due;
+    std::unique_lock lock(timer_mutex_);
+    while (!stop_) {
+        if (timers_.empty()) {
+            timer_condition_.wait(lock);
+            continue;
+        }
+
+        // Sleeps until the next tick that fires or cascades timers, arming a timer wakes it up to recompute.
+        // Ticks are absolute, a late wakeup catches up on the missed ticks instead of delaying the following ones.
+        if (const auto next_tick = timer_wheel_.getNextTick(); next_tick == TimerWheel::NO_TICK) {
+            timer_condition_.wait(lock);
+        } else {
+            timer_condition_.wait_until(lock, timer_epoch_ + TIMER_TICK * next_tick);
+        }
+        const auto now = Clock::now();
+        timer_wheel_.advance(toTick(now, false), expired);
+        for (const auto id: expired) {
+            const auto it = timers_.find(id);
+            if (it == timers_.end()) {
+                continue;
+            }
+            due.emplace_back(it->second.requester, it->second.command, it->second.priority);
+            if (!rearmTimer(id, it->second, now)) {
+                timers_.erase(it);
+            }
+        }
+        expired.clear();
+
+        // Pushing may wait for room in a full token queue, timers can be armed meanwhile
+        lock.unlock();
+        for (auto& task: due) {
+            if (!pushTask(std::move(task.requester), task.command, task.priority)) {
+                LOG_WARN("Dropped timer task, {} queue is full", toString(task.priority));
+            }
+        }
+        due.clear();
+        lock.lock();
+    }
+}
@@ -1,40 +1,138 @@
 #ifndef PERIPHERY_MANAGER_SCHEDULER_H
 #define PERIPHERY_MANAGER_SCHEDULER_H
 
-#include <queue>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <optional>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <memory>
 #include "TasksManager/CommandInterface.h"
+#include "TasksManager/CronSchedule.h"
+#include "TasksManager/MpmcQueue.h"
+#include "TasksManager/TimerWheel.h"
 #include "AppInputs/InputInterface.h"
 
 class Scheduler {
 public:
-    explicit Scheduler(const size_t thread_count = 1);
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY {1024};
+    static constexpr size_t PRIORITY_COUNT {4};
+    using TimerId = uint64_t;
+    static constexpr TimerId INVALID_TIMER {0};
+    static constexpr std::chrono::milliseconds TIMER_TICK {10};
+    struct QueueWaitStats {
+        uint64_t count{0};
+        uint64_t total_us{0};
+        uint64_t max_us{0};
+    };
+    explicit Scheduler(const size_t thread_count = 1, const size_t queue_capacity = DEFAULT_QUEUE_CAPACITY);
     ~Scheduler();
     void init();
     void deinit();
-    void enqueueTask(const std::shared_ptr<CommandInterface>& command);
-    void enqueueTask(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command);
+    bool enqueueTask(const std::shared_ptr<CommandInterface>& command,
+                     CommandPriority priority = CommandPriority::Reconfigure);
+    bool enqueueTask(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command,
+                     CommandPriority priority = CommandPriority::Reconfigure);
+    // Timers enqueue their command into the normal task queues when they fire. The command responds
+    // to the given requester on every run.
+    TimerId scheduleOnce(std::chrono::milliseconds delay, std::shared_ptr<InputInterface::Requester> requester,
+                         const std::shared_ptr<CommandInterface>& command, CommandPriority priority = CommandPriority::Reconfigure);
+    TimerId scheduleEvery(std::chrono::milliseconds period, std::shared_ptr<InputInterface::Requester> requester,
+                          const std::shared_ptr<CommandInterface>& command, CommandPriority priority = CommandPriority::Reconfigure);
+    TimerId scheduleCron(const CronSchedule& schedule, std::shared_ptr<InputInterface::Requester> requester,
+                         const std::shared_ptr<CommandInterface>& command, CommandPriority priority = CommandPriority::Reconfigure);
+    bool cancelTimer(TimerId id);
     size_t getRunningThreadCount() const;
+    QueueWaitStats getQueueWaitStats(CommandPriority priority) const;
 
 private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t NO_STRAND {static_cast<size_t>(-1)};
+    static constexpr unsigned int STRAND_BITS {5};
+    static constexpr size_t STRAND_COUNT {size_t{1} << STRAND_BITS};
+    static constexpr size_t STRAND_QUEUE_CAPACITY {64};
+    // A task without a command is a token granting a worker the right to run the next task of a strand
     struct Task {
         std::shared_ptr<InputInterface::Requester> requester;
         std::shared_ptr<CommandInterface> command;
-        Task(std::shared_ptr<InputInterface::Requester> cmd_requester, std::shared_ptr<CommandInterface> cmd)
-                : requester(std::move(cmd_requester)), command(std::move(cmd)) {}
+        CommandPriority priority{CommandPriority::Reconfigure};
+        Clock::time_point enqueue_time{};
+        size_t strand{NO_STRAND};
+        Task() = default;
+        Task(std::shared_ptr<InputInterface::Requester> cmd_requester, std::shared_ptr<CommandInterface> cmd,
+             const CommandPriority cmd_priority)
+                : requester(std::move(cmd_requester)), command(std::move(cmd)), priority(cmd_priority),
+                  enqueue_time(Clock::now()) {}
+        Task(const size_t strand_index, const CommandPriority token_priority)
+                : priority(token_priority), strand(strand_index) {}
+        bool isValid() const { return command != nullptr || strand != NO_STRAND; }
+    };
+    // Keys are hashed onto a fixed set of strands, colliding keys are serialized together.
+    // Critical tasks wait in their own queue, which is drained before the other tasks of the strand.
+    struct Strand {
+        MpmcQueue<Task> tasks{STRAND_QUEUE_CAPACITY};
+        MpmcQueue<Task> critical_tasks{STRAND_QUEUE_CAPACITY};
+        std::atomic<size_t> pending{0};
+        std::atomic<size_t> critical_pending{0};
+        std::atomic<bool> claimed{false};
+    };
+    struct Timer {
+        std::shared_ptr<InputInterface::Requester> requester;
+        std::shared_ptr<CommandInterface> command;
+        CommandPriority priority{CommandPriority::Reconfigure};
+        Clock::time_point expiry{};
+        Clock::duration period{}; // Zero for one-shot and cron timers
+        std::optional<CronSchedule> cron;
+        CronSchedule::Clock::time_point cron_time{};
+    };
+    struct AtomicQueueWaitStats {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_us{0};
+        std::atomic<uint64_t> max_us{0};
     };
-    std::queue<std::shared_ptr<Task>> tasks_;
-    std::mutex queue_mutex_;
+    bool pushTask(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command,
+                  CommandPriority priority);
+    bool pushStrandTask(std::shared_ptr<InputInterface::Requester> requester, const std::shared_ptr<CommandInterface>& command,
+                        CommandPriority priority);
+    bool pushToken(size_t strand_index, CommandPriority priority);
+    static size_t getStrandIndex(size_t strand_key);
+    static bool claimStrand(Strand& strand);
+    MpmcQueue<Task>& getQueue(CommandPriority priority);
+    bool tryPopTask(Task& task);
+    bool allQueuesEmpty() const;
+    void notifyWorker();
+    bool waitForTask(Task& task);
+    void executeTask(Task& task);
+    void runStrand(size_t strand_index);
+    void recordQueueWait(const Task& task);
+    TimerId addTimer(Timer timer);
+    uint64_t toTick(Clock::time_point time, bool round_up) const;
+    bool rearmTimer(TimerId id, Timer& timer, Clock::time_point now);
+    void runTimers();
+    std::array<std::unique_ptr<MpmcQueue<Task>>, PRIORITY_COUNT> queues_;
+    std::array<AtomicQueueWaitStats, PRIORITY_COUNT> queue_wait_stats_;
+    std::atomic<size_t> pick_counter_{0};
+    std::unique_ptr<Strand[]> strands_;
+    std::mutex park_mutex_;
     std::condition_variable task_available_condition_;
-    bool stop_ {false};
+    std::atomic<size_t> parked_workers_{0};
+    std::atomic<bool> stop_ {false};
     std::vector<std::thread> worker_threads_;
+    std::unordered_map<TimerId, Timer> timers_;
+    TimerWheel timer_wheel_;
+    Clock::time_point timer_epoch_{Clock::now()};
+    TimerId next_timer_id_{INVALID_TIMER + 1};
+    std::mutex timer_mutex_;
+    std::condition_variable timer_condition_;
+    std::thread timer_thread_;
     void workerFunction();
     size_t thread_count_{};
+    unsigned int spin_count_{};
 };
 
 #endif //PERIPHERY_MANAGER_SCHEDULER_H
@@ -0,0 +1,129 @@
+#include "SchedulerCommands.h"
+#include <charconv>
+#include <fmt/format.h>
+#include "EventLog/EventLog.h"
+#include "TasksManager/Operation.h"
+
+namespace {
+template<typename T>
+bool parseNumber(const std::string_view argument, T& value) {
+    const auto [end, ec] = std::from_chars(argument.data(), argument.data() + argument.size(), value);
+    return ec == std::errc() && end == argument.data() + argument.size();
+}
+}
+
+void SchedulerStatsCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    fmt::memory_buffer response;
+    for (size_t i = 0; i < Scheduler::PRIORITY_COUNT; ++i) {
+        const auto priority = static_cast<CommandPriority>(i);
+        const auto stats = scheduler_->getQueueWaitStats(priority);
+        fmt::format_to(std::back_inserter(response), "{}{} count={} avg_us={} max_us={}", i == 0 ? "" : "; ",
+                       toString(priority), stats.count, stats.count ? stats.total_us / stats.count : 0, stats.max_us);
+    }
+    requester->source->sendResponse(requester, std::string_view(response.data(), response.size()));
+}
+
+void RecordStatsEventCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    for (size_t i = 0; i < Scheduler::PRIORITY_COUNT; ++i) {
+        const auto priority = static_cast<CommandPriority>(i);
+        const auto stats = scheduler_->getQueueWaitStats(priority);
+        RECORD_EVENT(EventType::Stats, static_cast<int64_t>(stats.count), static_cast<int64_t>(stats.max_us),
+                     toString(priority));
+    }
+    if (requester) {
+        requester->source->sendResponse(requester, "Ack");
+    }
+}
+
+void CancelOperationsCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    const auto operation = std::dynamic_pointer_cast<Operation>(requester->source);
+    // Without an operation there is no connection to limit the cancellation to
+    if (!operation && !all_requesters_) {
+        requester->source->sendResponse(requester, "Nack");
+        return;
+    }
+
+    const auto owner = all_requesters_ ? nullptr : operation->getOwner();
+    const auto cancelled = tracker_->cancelAll(owner, operation ? operation->getId() : 0);
+    fmt::memory_buffer response;
+    fmt::format_to(std::back_inserter(response), "Ack cancelled={}", cancelled);
+    requester->source->sendResponse(requester, std::string_view(response.data(), response.size()));
+}
+
+std::shared_ptr<CommandInterface> CancelOperationsCommand::withArguments(const CommandArguments& arguments) const {
+    if (all_requesters_ || arguments.size() != 1) {
+        return nullptr;
+    }
+
+    uint64_t id = 0;
+    if (!parseNumber(arguments[0], id)) {
+        return nullptr;
+    }
+    return std::make_shared<CancelOperationCommand>(tracker_, id);
+}
+
+void CancelOperationCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    requester->source->sendResponse(requester, tracker_->cancel(id_) ? "Ack" : "Nack");
+}
+
+void ScheduleCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    requester->source->sendResponse(requester, "Nack");
+}
+
+std::shared_ptr<CommandInterface> ScheduleCommand::withArguments(const CommandArguments& arguments) const {
+    constexpr size_t CRON_FIELDS {5};
+    ScheduleEntry entry;
+    size_t command_index = 2;
+    if (arguments.size() < 3) {
+        return nullptr;
+    }
+    if (arguments[0] == "after" || arguments[0] == "every") {
+        uint64_t interval_ms = 0;
+        if (!parseNumber(arguments[1], interval_ms) || (arguments[0] == "every" && interval_ms == 0)) {
+            return nullptr;
+        }
+        entry.kind = arguments[0] == "after" ? ScheduleEntry::Kind::Once : ScheduleEntry::Kind::Every;
+        entry.interval = std::chrono::milliseconds(interval_ms);
+    } else if (arguments[0] == "cron" && arguments.size() > CRON_FIELDS + 1) {
+        entry.kind = ScheduleEntry::Kind::Cron;
+        const auto fields = arguments.join(1);
+        const auto last_field = arguments[CRON_FIELDS];
+        entry.cron = std::string(fields.data(), last_field.data() + last_field.size() - fields.data());
+        command_index = CRON_FIELDS + 1;
+    } else {
+        return nullptr;
+    }
+
+    entry.command = std::string(arguments.join(command_index));
+    return std::make_shared<AddScheduleCommand>(dispatcher_, std::move(entry));
+}
+
+void AddScheduleCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    Scheduler::TimerId timer_id{Scheduler::INVALID_TIMER};
+    const auto dispatcher = dispatcher_.lock();
+    if (!dispatcher || dispatcher->addSchedule(entry_, timer_id)) {
+        requester->source->sendResponse(requester, "Nack");
+        return;
+    }
+
+    fmt::memory_buffer response;
+    fmt::format_to(std::back_inserter(response), "Ack timer={}", timer_id);
+    requester->source->sendResponse(requester, std::string_view(response.data(), response.size()));
+}
+
+void UnscheduleCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    requester->source->sendResponse(requester, "Nack");
+}
+
+std::shared_ptr<CommandInterface> UnscheduleCommand::withArguments(const CommandArguments& arguments) const {
+    Scheduler::TimerId timer_id{Scheduler::INVALID_TIMER};
+    if (arguments.size() != 1 || !parseNumber(arguments[0], timer_id)) {
+        return nullptr;
+    }
+    return std::make_shared<RemoveScheduleCommand>(dispatcher_, timer_id);
+}
+
+void RemoveScheduleCommand::execute(const std::shared_ptr<InputInterface::Requester> requester) {
+    const auto dispatcher = dispatcher_.lock();
+    requester->source->sendResponse(requester, dispatcher && dispatcher->removeSchedule(timer_id_) ? "Ack" : "Nack");
+}
@@ -0,0 +1,113 @@
+#ifndef PERIPHERY_MANAGER_SCHEDULERCOMMANDS_H
+#define PERIPHERY_MANAGER_SCHEDULERCOMMANDS_H
+
+#include <cstdint>
+#include <utility>
+#include "TasksManager/CommandDispatcher.h"
+#include "TasksManager/CommandInterface.h"
+#include "TasksManager/Scheduler.h"
+#include "TasksManager/OperationTracker.h"
+
+// Replies with the queue wait statistics of every priority class
+class SchedulerStatsCommand : public CommandInterface {
+public:
+    explicit SchedulerStatsCommand(std::shared_ptr<Scheduler> scheduler) : scheduler_(std::move(scheduler)) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    ~SchedulerStatsCommand() override = default;
+
+private:
+    std::shared_ptr<Scheduler> scheduler_;
+};
+
+// Records the queue wait statistics of every priority class into the event log, runs periodically
+// without a requester
+class RecordStatsEventCommand : public CommandInterface {
+public:
+    explicit RecordStatsEventCommand(std::shared_ptr<Scheduler> scheduler) : scheduler_(std::move(scheduler)) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    ~RecordStatsEventCommand() override = default;
+
+private:
+    std::shared_ptr<Scheduler> scheduler_;
+};
+
+// Answers the pending operations of the requesting connection except itself with a cancellation, those of
+// every connection if registered for all requesters. `cancel <id>` cancels only the given one.
+class CancelOperationsCommand : public CommandInterface {
+public:
+    explicit CancelOperationsCommand(std::shared_ptr<OperationTracker> tracker, const bool all_requesters = false)
+        : tracker_(std::move(tracker)), all_requesters_(all_requesters) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    std::shared_ptr<CommandInterface> withArguments(const CommandArguments& arguments) const override;
+    ~CancelOperationsCommand() override = default;
+
+private:
+    std::shared_ptr<OperationTracker> tracker_;
+    bool all_requesters_;
+};
+
+// Cancels one pending operation, Nack if it is unknown or already answered
+class CancelOperationCommand : public CommandInterface {
+public:
+    CancelOperationCommand(std::shared_ptr<OperationTracker> tracker, const uint64_t id)
+        : tracker_(std::move(tracker)), id_(id) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    ~CancelOperationCommand() override = default;
+
+private:
+    std::shared_ptr<OperationTracker> tracker_;
+    uint64_t id_;
+};
+
+// `schedule after <ms> <command>`, `schedule every <ms> <command>` and `schedule cron <m> <h> <dom> <mon> <dow> <command>`
+// arm a timer for a registered command. The dispatcher owns its commands, so it is only referenced weakly.
+class ScheduleCommand : public CommandInterface {
+public:
+    explicit ScheduleCommand(std::weak_ptr<CommandDispatcher> dispatcher) : dispatcher_(std::move(dispatcher)) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    std::shared_ptr<CommandInterface> withArguments(const CommandArguments& arguments) const override;
+    ~ScheduleCommand() override = default;
+
+private:
+    std::weak_ptr<CommandDispatcher> dispatcher_;
+};
+
+// Arms one timer, replies with its id or Nack if the command or the cron expression is invalid
+class AddScheduleCommand : public CommandInterface {
+public:
+    AddScheduleCommand(std::weak_ptr<CommandDispatcher> dispatcher, ScheduleEntry entry)
+        : dispatcher_(std::move(dispatcher)), entry_(std::move(entry)) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    ~AddScheduleCommand() override = default;
+
+private:
+    std::weak_ptr<CommandDispatcher> dispatcher_;
+    ScheduleEntry entry_;
+};
+
+// `unschedule <id>` cancels a timer armed by `schedule` or the pipeline file
+class UnscheduleCommand : public CommandInterface {
+public:
+    explicit UnscheduleCommand(std::weak_ptr<CommandDispatcher> dispatcher) : dispatcher_(std::move(dispatcher)) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    std::shared_ptr<CommandInterface> withArguments(const CommandArguments& arguments) const override;
+    ~UnscheduleCommand() override = default;
+
+private:
+    std::weak_ptr<CommandDispatcher> dispatcher_;
+};
+
+// Cancels one timer, Nack if it is unknown or a one shot timer already fired
+class RemoveScheduleCommand : public CommandInterface {
+public:
+    RemoveScheduleCommand(std::weak_ptr<CommandDispatcher> dispatcher, const Scheduler::TimerId timer_id)
+        : dispatcher_(std::move(dispatcher)), timer_id_(timer_id) {}
+    void execute(std::shared_ptr<InputInterface::Requester> requester) override;
+    ~RemoveScheduleCommand() override = default;
+
+private:
+    std::weak_ptr<CommandDispatcher> dispatcher_;
+    Scheduler::TimerId timer_id_;
+};
+
+#endif //PERIPHERY_MANAGER_SCHEDULERCOMMANDS_H
@@ -0,0 +1,109 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(const uint64_t current_tick) : current_tick_(current_tick) {}
+
+void TimerWheel::insert(const uint64_t id, const uint64_t expiry_tick) {
+    // Expired timers fire on the next tick
+    place({id, std::max(expiry_tick, current_tick_ + 1)});
+    ++size_;
+}
+
+// Entries are placed by their absolute expiry, so a slot of level N is cascaded exactly when the current
+// tick enters the window of SLOT_COUNT^N ticks its entries expire in
+void TimerWheel::place(const Entry& entry) {
+    const auto delta = entry.expiry_tick - current_tick_;
+    const auto slot_tick = delta > MAX_TICKS ? current_tick_ + MAX_TICKS : entry.expiry_tick;
+    size_t level = 0;
+    while (level + 1 < LEVEL_COUNT && std::min(delta, MAX_TICKS) >> (LEVEL_BITS * (level + 1))) {
+        ++level;
+    }
+
+    slots_[level][(slot_tick >> (LEVEL_BITS * level)) & (SLOT_COUNT - 1)].push_back(entry);
+}
+
+void TimerWheel::cascade(const size_t level) {
+    auto& slot = slots_[level][(current_tick_ >> (LEVEL_BITS * level)) & (SLOT_COUNT - 1)];
+    auto entries = std::move(slot);
+    slot.clear();
+    for (const auto& entry: entries) {
+        place(entry);
+    }
+}
+
+void TimerWheel::advance(const uint64_t to_tick, std::vector<uint64_t>& expired) {
+    while (current_tick_ < to_tick) {
+        const auto next_tick = getNextTick();
+        if (next_tick > to_tick) {
+            current_tick_ = to_tick;
+            break;
+        }
+        current_tick_ = next_tick;
+
+        // Higher levels first, their entries may land in a lower level slot cascading on this very tick
+        size_t levels = 0;
+        while (levels + 1 < LEVEL_COUNT && (current_tick_ & ((uint64_t{1} << (LEVEL_BITS * (levels + 1))) - 1)) == 0) {
+            ++levels;
+        }
+        for (auto level = levels; level > 0; --level) {
+            cascade(level);
+        }
+
+        auto& slot = slots_[0][current_tick_ & (SLOT_COUNT - 1)];
+        for (const auto& entry: slot) {
+            expired.push_back(entry.id);
+        }
+        size_ -= slot.size();
+        slot.clear();
+    }
+}
+
+void TimerWheel::reset(const uint64_t current_tick) {
+    for (auto& level: slots_) {
+        for (auto& slot: level) {
+            slot.clear();
+        }
+    }
+    size_ = 0;
+    current_tick_ = current_tick;
+}
+
+uint64_t TimerWheel::getCurrentTick() const {
+    return current_tick_;
+}
+
+// Level 0 entries expire within the next SLOT_COUNT ticks, entries of a higher level cascade at one of the
+// next SLOT_COUNT window boundaries of their level
+uint64_t TimerWheel::getNextTick() const {
+    if (size_ == 0) {
+        return NO_TICK;
+    }
+
+    auto next_tick = NO_TICK;
+    for (auto tick = current_tick_ + 1; tick <= current_tick_ + SLOT_COUNT; ++tick) {
+        if (!slots_[0][tick & (SLOT_COUNT - 1)].empty()) {
+            next_tick = tick;
+            break;
+        }
+    }
+    for (size_t level = 1; level < LEVEL_COUNT; ++level) {
+        const auto shift = LEVEL_BITS * level;
+        const auto current_window = current_tick_ >> shift;
+        for (auto window = current_window + 1; window <= current_window + SLOT_COUNT; ++window) {
+            const auto tick = window << shift;
+            if (tick >= next_tick) {
+                break;
+            }
+            if (!slots_[level][window & (SLOT_COUNT - 1)].empty()) {
+                next_tick = tick;
+                break;
+            }
+        }
+    }
+
+    return next_tick;
+}
+
+bool TimerWheel::empty() const {
+    return size_ == 0;
+}
@@ -0,0 +1,44 @@
+#ifndef PERIPHERY_MANAGER_TIMERWHEEL_H
+#define PERIPHERY_MANAGER_TIMERWHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Hierarchical hashed timer wheel counting in abstract ticks. Inserting is O(1) and every tick costs O(1)
+// plus the timers expiring or cascading in it, independent of the number of armed timers. Ticks in which
+// nothing expires or cascades are skipped, so the caller can sleep until getNextTick(). Entries are only
+// identified by id, callers drop cancelled timers when they expire.
+class TimerWheel {
+public:
+    static constexpr unsigned int LEVEL_BITS {6};
+    static constexpr uint64_t SLOT_COUNT {1u << LEVEL_BITS};
+    static constexpr size_t LEVEL_COUNT {4};
+    // Timers further away are parked in the last slot of the top level and re-inserted when it cascades
+    static constexpr uint64_t MAX_TICKS {(uint64_t{1} << (LEVEL_BITS * LEVEL_COUNT)) - 1};
+    static constexpr uint64_t NO_TICK {std::numeric_limits<uint64_t>::max()};
+
+    explicit TimerWheel(uint64_t current_tick = 0);
+    void insert(uint64_t id, uint64_t expiry_tick);
+    void advance(uint64_t to_tick, std::vector<uint64_t>& expired);
+    void reset(uint64_t current_tick);
+    uint64_t getCurrentTick() const;
+    // First tick at which a timer expires or a slot holding timers cascades, NO_TICK when empty
+    uint64_t getNextTick() const;
+    bool empty() const;
+
+private:
+    struct Entry {
+        uint64_t id;
+        uint64_t expiry_tick;
+    };
+    void place(const Entry& entry);
+    void cascade(size_t level);
+    std::array<std::array<std::vector<Entry>, SLOT_COUNT>, LEVEL_COUNT> slots_;
+    uint64_t current_tick_;
+    size_t size_{0};
+};
+
+#endif //PERIPHERY_MANAGER_TIMERWHEEL_H
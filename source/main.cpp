@@ -1,15 +1,51 @@
+#include <algorithm>
 #include <filesystem>
 #include "Logger/Logger.h"
+#include "Logger/AsyncLogAdapter.h"
 #include "cxxopts.hpp"
 #include <gst/gst.h>
 #include "App/App.h"
+#include "App/Supervisor.h"
+#include "Pipeline/GstLogBridge.h"
 
 AppConfig parse_command_line_arguments(const int argc, const char* argv[]) {
     cxxopts::Options options(argv[0], "Gstreamer runner");
     options.add_options()
         ("i,input", "Input YAML pipeline file", cxxopts::value<std::filesystem::path>()->default_value("../resources/pipeline.yaml"))
+        ("I,instance", "Pipeline instance to run from a template pipeline file", cxxopts::value<std::string>()->default_value(""))
+        ("plan-cache", "Cache the resolved pipeline plan in this directory to speed up the next start, empty disables", cxxopts::value<std::filesystem::path>()->default_value(""))
+        ("gst-registry", "Private GStreamer registry file, plugin directories are only scanned while it doesn't exist", cxxopts::value<std::filesystem::path>()->default_value(""))
+        ("preload-plugins", "Load the plugins of the pipeline elements in the background during startup", cxxopts::value<bool>()->default_value("false"))
+        ("standby", "Keep a prebuilt standby pipeline in this state to take over on a pipeline error (none, null, ready, paused)", cxxopts::value<std::string>()->default_value("none"))
+        ("standby-max-memory", "Drop the standby pipeline when it takes more than this many MB", cxxopts::value<unsigned int>()->default_value("256"))
+        ("source-reconnect", "Restart sources that fail or end while the rest of the pipeline keeps running", cxxopts::value<bool>()->default_value("false"))
+        ("reconnect-backoff", "Delay in ms before a failed source is restarted, doubled on every failed restart", cxxopts::value<unsigned int>()->default_value("500"))
+        ("reconnect-max-backoff", "Longest delay in ms between two restarts of a failed source", cxxopts::value<unsigned int>()->default_value("10000"))
+        ("reconnect-timeout", "A restarted source that delivers no buffer within this many ms counts as a failed restart", cxxopts::value<unsigned int>()->default_value("5000"))
+        ("source-filler", "Frames fed downstream while a source is restarted (none, last, black)", cxxopts::value<std::string>()->default_value("last"))
+        ("supervise", "Run every pipeline in a supervised worker process behind one control port", cxxopts::value<bool>()->default_value("false"))
+        ("worker", "Pipeline of a supervised worker as <file>[:<instance>], repeatable, defaults to every instance of the input file", cxxopts::value<std::vector<std::string>>())
+        ("restart-backoff", "Initial delay in ms before a crashed worker is restarted, doubled on every crash up to 30 s", cxxopts::value<unsigned int>()->default_value("500"))
+        ("control-socket", "Serve commands on this unix socket instead of the TCP port, a leading @ selects the abstract namespace", cxxopts::value<std::string>()->default_value(""))
+        ("pipeline", "Pipeline run in this process next to the input one as <file>[:<instance>], repeatable, controlled as <name> start|stop|<command>", cxxopts::value<std::vector<std::string>>())
         ("p,port", "Port for TCP socket", cxxopts::value<unsigned int>()->default_value("12345"))
+        ("n,network", "Control network backend (select, io_uring)", cxxopts::value<std::string>()->default_value("select"))
+        ("t,threads", "Number of command scheduler threads", cxxopts::value<unsigned int>()->default_value("1"))
+        ("d,debounce", "Debounce window in ms for commands toggling the same target", cxxopts::value<unsigned int>()->default_value("0"))
+        ("D,deadline", "Deadline in ms after which a pending command is answered with a timeout", cxxopts::value<unsigned int>()->default_value("5000"))
         ("v,verbose", "Enable verbose logging", cxxopts::value<bool>()->default_value("false"))
+        ("w,watch", "Reload the pipeline file when it changes", cxxopts::value<bool>()->default_value("false"))
+        ("element-by-element", "Build the pipeline element by element instead of from a generated launch description", cxxopts::value<bool>()->default_value("false"))
+        ("g,gst-debug", "GStreamer debug thresholds in GST_DEBUG syntax, e.g. 2,GST_CAPS:4, overrides gst_debug of the pipeline file", cxxopts::value<std::string>()->default_value(""))
+        ("log-async", "Write the log from a dedicated thread instead of the logging one", cxxopts::value<bool>()->default_value("false"))
+        ("log-file", "Write the log to a rotating file, implies --log-async", cxxopts::value<std::filesystem::path>()->default_value(""))
+        ("log-overflow", "Asynchronous log queue overflow policy (block, drop)", cxxopts::value<std::string>()->default_value("block"))
+        ("log-max-size", "Rotate the log file once it exceeds this size in MB, 0 disables", cxxopts::value<unsigned int>()->default_value("100"))
+        ("log-rotate", "Rotate the log file after this many minutes, 0 disables", cxxopts::value<unsigned int>()->default_value("0"))
+        ("event-log", "Record a binary event timeline into this directory, empty disables", cxxopts::value<std::filesystem::path>()->default_value(""))
+        ("event-log-segment-size", "Size of an event log segment file in MB", cxxopts::value<unsigned int>()->default_value("16"))
+        ("event-log-segments", "Number of event log segment files kept", cxxopts::value<unsigned int>()->default_value("8"))
+        ("event-stats-interval", "Record the command queue statistics into the event log every this many seconds, 0 disables", cxxopts::value<unsigned int>()->default_value("10"))
         ("h,help", "Print usage");
 
     const auto result = options.parse(argc, argv);
@@ -21,70 +57,115 @@ AppConfig parse_command_line_arguments(const int argc, const char* argv[]) {
 
     AppConfig config {
         .input_file = result["input"].as<std::filesystem::path>(),
+        .instance = result["instance"].as<std::string>(),
+        .plan_cache_dir = result["plan-cache"].as<std::filesystem::path>(),
+        .gst_registry_file = result["gst-registry"].as<std::filesystem::path>(),
+        .preload_plugins = result["preload-plugins"].as<bool>(),
+        .standby = result["standby"].as<std::string>(),
+        .standby_max_memory_mb = result["standby-max-memory"].as<unsigned int>(),
+        .source_reconnect = result["source-reconnect"].as<bool>(),
+        .reconnect_backoff_ms = std::max(1u, result["reconnect-backoff"].as<unsigned int>()),
+        .reconnect_max_backoff_ms = std::max(1u, result["reconnect-max-backoff"].as<unsigned int>()),
+        .reconnect_timeout_ms = std::max(1u, result["reconnect-timeout"].as<unsigned int>()),
+        .source_filler = result["source-filler"].as<std::string>(),
+        .supervise = result["supervise"].as<bool>(),
+        .workers = result.count("worker") ? result["worker"].as<std::vector<std::string>>() : std::vector<std::string>{},
+        .restart_backoff_ms = std::max(1u, result["restart-backoff"].as<unsigned int>()),
+        .control_socket = result["control-socket"].as<std::string>(),
+        .pipelines = result.count("pipeline") ? result["pipeline"].as<std::vector<std::string>>() : std::vector<std::string>{},
         .port = result["port"].as<unsigned int>(),
-        .verbose = result["verbose"].as<bool>()
+        .network_backend = result["network"].as<std::string>(),
+        .scheduler_threads = std::max(1u, result["threads"].as<unsigned int>()),
+        .debounce_ms = result["debounce"].as<unsigned int>(),
+        .deadline_ms = result["deadline"].as<unsigned int>(),
+        .verbose = result["verbose"].as<bool>(),
+        .watch = result["watch"].as<bool>(),
+        .element_by_element = result["element-by-element"].as<bool>(),
+        .log_async = result["log-async"].as<bool>(),
+        .log_file = result["log-file"].as<std::filesystem::path>(),
+        .log_overflow = result["log-overflow"].as<std::string>(),
+        .log_max_size_mb = result["log-max-size"].as<unsigned int>(),
+        .log_rotate_minutes = result["log-rotate"].as<unsigned int>(),
+        .gst_debug = result["gst-debug"].as<std::string>(),
+        .event_log_dir = result["event-log"].as<std::filesystem::path>(),
+        .event_log_segment_size_mb = result["event-log-segment-size"].as<unsigned int>(),
+        .event_log_segments = result["event-log-segments"].as<unsigned int>(),
+        .event_stats_interval_s = result["event-stats-interval"].as<unsigned int>()
     };
 
     return config;
 }
 
-// TODO: place this function in a appropriate separate file
-void custom_log_handler(GstDebugCategory* category, GstDebugLevel level, const gchar* file, const gchar* function, gint line, GObject* object, GstDebugMessage* message, gpointer user_data) {
-    const gchar* log_message = gst_debug_message_get(message);
-    const gchar* object_name = "";
-  
-    if (object && GST_IS_PAD(object)) {
-        const gchar* parent_name = GST_OBJECT_PARENT(object) ? GST_OBJECT_NAME(GST_OBJECT_PARENT(object)) : "unknown";
-        const gchar* pad_name = GST_OBJECT_NAME(object);
-        object_name = g_strdup_printf("%s:%s", parent_name, pad_name);
+void configure_log_backend(const AppConfig& config) {
+    // GStreamer debug output is written off the streaming threads
+    if (!config.log_async && config.log_file.empty() && config.gst_debug.empty()) {
+        return;
     }
-    
-    std::string log_print = fmt::format("[{}()<{}>] {}", function, object_name, log_message);
-
-    switch (level) {
-        case GST_LEVEL_ERROR:
-            LOG_ERROR("{}", log_print);
-            break;
-        case GST_LEVEL_WARNING:
-            LOG_WARN("{}", log_print);
-            break;
-        case GST_LEVEL_INFO:
-            LOG_INFO("{}", log_print);
-            break;
-        case GST_LEVEL_DEBUG:
-            LOG_DEBUG("{}", log_print);
-            break;
-        case GST_LEVEL_TRACE:
-            LOG_TRACE("{}", log_print);
-            break;
-        default:
-            break;
+
+    constexpr size_t LOG_FILES_KEPT = 5;
+    std::unique_ptr<LogSink> sink;
+    if (config.log_file.empty()) {
+        sink = std::make_unique<StdoutLogSink>();
+    } else {
+        sink = std::make_unique<RotatingFileLogSink>(config.log_file, static_cast<size_t>(config.log_max_size_mb) << 20,
+                                                     std::chrono::minutes(config.log_rotate_minutes), LOG_FILES_KEPT);
+    }
+
+    auto overflow_policy = AsyncLogAdapter::OverflowPolicy::Block;
+    if (config.log_overflow == "drop") {
+        overflow_policy = AsyncLogAdapter::OverflowPolicy::Drop;
+    } else if (config.log_overflow != "block") {
+        LOG_WARN("Unknown log overflow policy '{}', blocking when the log queue is full", config.log_overflow);
     }
+
+    Logger::getInstance().setAdapter(std::make_shared<AsyncLogAdapter>(std::move(sink), AsyncLogAdapter::DEFAULT_CAPACITY,
+                                                                       overflow_policy));
 }
 
-// TODO: place gst debug configuration in a separate file
-void configure_logger(const bool verbose) {
-    gst_debug_add_log_function(custom_log_handler, nullptr, nullptr);
-    gst_debug_remove_log_function(gst_debug_log_default);
+void configure_logger(const AppConfig& config) {
+    configure_log_backend(config);
+    GstLogBridge::install();
+
+    if (config.verbose) {
+        SET_LOG_LEVEL(LoggerInterface::LogLevel::Debug);
+    } else {
+        SET_LOG_LEVEL(LoggerInterface::LogLevel::Info);
+    }
+}
 
-    if (verbose) {
+int run_supervisor(const AppConfig& config) {
+    // The supervisor stays single threaded so it can fork at any time, it logs synchronously to stdout and each
+    // worker sets up the configured backend and the GStreamer log bridge of its own
+    if (config.verbose) {
         SET_LOG_LEVEL(LoggerInterface::LogLevel::Debug);
-        // gst_debug_set_default_threshold(GST_LEVEL_INFO);
-        // gst_debug_set_threshold_from_string("nvmsgconv:5,GST_CAPS:4", TRUE);
     } else {
         SET_LOG_LEVEL(LoggerInterface::LogLevel::Info);
     }
+
+    Supervisor supervisor(config, [](const AppConfig& worker_config) {
+        configure_logger(worker_config);
+        return App::run(worker_config);
+    });
+    return supervisor.run();
 }
 
 int main(const int argc, const char* argv[]) {
     const AppConfig config = parse_command_line_arguments(argc, argv);
-    configure_logger(config.verbose);
+    if (config.supervise) {
+        try {
+            return run_supervisor(config);
+        } catch (const std::exception& e) {
+            LOG_ERROR("{}", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+    configure_logger(config);
 
     LOG_TRACE("{} {}.{}.{}", APP_NAME, APP_VERSION_MAJOR, APP_VERSION_MINOR, APP_VERSION_PATCH);
 
     try {
-        if (App::run(config) != EXIT_SUCCESS) {
-            return EXIT_FAILURE;
+        if (const auto status = App::run(config); status != EXIT_SUCCESS) {
+            return status;
         }
     } catch (const std::exception& e) {
         LOG_CRITICAL("{}", e.what());
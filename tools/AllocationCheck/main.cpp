@@ -0,0 +1,169 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "cxxopts.hpp"
+#include "AppInputs/MessageServer.h"
+#include "Logger/Logger.h"
+#include "Network/TcpNetworkManager.h"
+#include "TasksManager/CommandCoalescer.h"
+#include "TasksManager/CommandDispatcher.h"
+#include "TasksManager/OperationTracker.h"
+#include "TasksManager/Scheduler.h"
+
+namespace {
+std::atomic<bool> counting {false};
+std::atomic<size_t> allocations {0};
+}
+
+// Counts every heap allocation of the process while the measured round trips run
+void* operator new(const size_t size) {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+// Stands in for the pipeline toggles, which run on a strand and go through the coalescer
+class ToggleFake : public CommandFake {
+public:
+    size_t getStrandKey() const override { return reinterpret_cast<uintptr_t>(this); }
+    std::string_view getCoalesceTarget() const override { return "fake"; }
+};
+
+int connect_client(const unsigned int port) {
+    const int client_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client_socket < 0) {
+        return -1;
+    }
+
+    constexpr int no_delay = 1;
+    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    sockaddr_in server_address{};
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(port);
+    server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // The server starts listening on its own thread
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        if (connect(client_socket, reinterpret_cast<sockaddr*>(&server_address), sizeof(server_address)) == 0) {
+            return client_socket;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    close(client_socket);
+    return -1;
+}
+
+// Sends the command and waits for its outcome, which follows the acceptance line
+bool round_trip(const int client_socket, const std::string_view command) {
+    if (send(client_socket, command.data(), command.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(command.size())) {
+        return false;
+    }
+
+    char response[256];
+    size_t received {0};
+    while (received < sizeof(response)) {
+        const auto bytes_read = recv(client_socket, response + received, sizeof(response) - received, 0);
+        if (bytes_read <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(bytes_read);
+
+        std::string_view lines(response, received);
+        for (auto line_end = lines.find('\n'); line_end != std::string_view::npos; line_end = lines.find('\n')) {
+            if (lines.rfind("Accepted", 0) != 0) {
+                return lines.rfind("Ack", 0) == 0;
+            }
+            lines.remove_prefix(line_end + 1);
+        }
+    }
+    return false;
+}
+}
+
+int main(const int argc, const char* argv[]) {
+    cxxopts::Options options(argv[0], "Counts heap allocations of steady state control plane round trips, "
+                                      "alternating a plain and a coalesced strand command");
+    options.add_options()
+        ("p,port", "Loopback TCP port to serve on", cxxopts::value<unsigned int>()->default_value("23460"))
+        ("w,warmup", "Round trips before counting", cxxopts::value<unsigned int>()->default_value("1000"))
+        ("n,iterations", "Counted round trips", cxxopts::value<unsigned int>()->default_value("10000"))
+        ("h,help", "Print usage");
+
+    const auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const auto port = result["port"].as<unsigned int>();
+    const auto warmup = result["warmup"].as<unsigned int>();
+    const auto iterations = result["iterations"].as<unsigned int>();
+
+    // Same control plane as the application, with the pipeline commands replaced by fakes
+    SET_LOG_LEVEL(LoggerInterface::LogLevel::Warn);
+    auto scheduler = std::make_shared<Scheduler>();
+    scheduler->init();
+    auto coalescer = std::make_shared<CommandCoalescer>(scheduler, std::chrono::milliseconds(0));
+    coalescer->init();
+    auto operation_tracker = std::make_shared<OperationTracker>(std::chrono::milliseconds(5000));
+    operation_tracker->init();
+    auto dispatcher = std::make_shared<CommandDispatcher>(scheduler, coalescer, operation_tracker);
+    dispatcher->registerCommand("test", std::make_shared<CommandFake>(), CommandPriority::Query);
+    dispatcher->registerCommand("toggle", std::make_shared<ToggleFake>());
+    const auto server = std::make_shared<MessageServer>(dispatcher, std::make_shared<TcpNetworkManager>(static_cast<int>(port)));
+    server->init();
+
+    const int client_socket = connect_client(port);
+    if (client_socket < 0) {
+        LOG_ERROR("Cannot connect to port {}", port);
+        return EXIT_FAILURE;
+    }
+
+    const auto command = [](const unsigned int i) { return i % 2 == 0 ? "test" : "toggle"; };
+    for (unsigned int i = 0; i < warmup; ++i) {
+        if (!round_trip(client_socket, command(i))) {
+            LOG_ERROR("Warm up round trip {} failed", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    counting = true;
+    unsigned int failed {0};
+    for (unsigned int i = 0; i < iterations; ++i) {
+        failed += round_trip(client_socket, command(i)) ? 0 : 1;
+    }
+    counting = false;
+
+    close(client_socket);
+    server->deinit();
+    operation_tracker->deinit();
+    coalescer->deinit();
+    scheduler->deinit();
+
+    std::cout << iterations << " round trips, " << failed << " failed, " << allocations.load() << " allocations" << std::endl;
+
+    return failed == 0 && allocations.load() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "cxxopts.hpp"
+#include "EventLog/EventFormat.h"
+#include "TasksManager/CommandInterface.h"
+
+namespace {
+struct SegmentFile {
+    std::filesystem::path path;
+    SegmentHeader header;
+    std::vector<char> data;
+};
+
+bool readSegment(const std::filesystem::path& path, SegmentFile& segment) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path.string() << std::endl;
+        return false;
+    }
+    segment.path = path;
+    segment.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (segment.data.size() < sizeof(SegmentHeader)) {
+        std::cerr << path.string() << " is not an event log segment" << std::endl;
+        return false;
+    }
+
+    std::memcpy(&segment.header, segment.data.data(), sizeof(SegmentHeader));
+    if (std::memcmp(segment.header.magic, EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC)) != 0 ||
+        segment.header.version != EVENT_LOG_VERSION) {
+        std::cerr << path.string() << " is not an event log segment of version " << EVENT_LOG_VERSION << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Expands directories to their events-<index>.bin files
+std::vector<std::filesystem::path> collectPaths(const std::vector<std::string>& inputs) {
+    std::vector<std::filesystem::path> paths;
+    for (const auto& input: inputs) {
+        if (!std::filesystem::is_directory(input)) {
+            paths.emplace_back(input);
+            continue;
+        }
+        for (const auto& entry: std::filesystem::directory_iterator(input)) {
+            const auto file_name = entry.path().filename().string();
+            if (file_name.rfind("events-", 0) == 0 && entry.path().extension() == ".bin") {
+                paths.push_back(entry.path());
+            }
+        }
+    }
+    return paths;
+}
+
+std::string formatTimestamp(const uint64_t timestamp_ns) {
+    const auto seconds = static_cast<std::time_t>(timestamp_ns / 1000000000);
+    std::tm time {};
+    localtime_r(&seconds, &time);
+    char text[48];
+    const auto size = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &time);
+    std::snprintf(text + size, sizeof(text) - size, ".%06llu",
+                  static_cast<unsigned long long>(timestamp_ns % 1000000000 / 1000));
+    return text;
+}
+
+const char* toStateName(const int64_t state) {
+    static constexpr const char* STATE_NAMES[] = {"VOID_PENDING", "NULL", "READY", "PAUSED", "PLAYING"};
+    return state >= 0 && state < 5 ? STATE_NAMES[state] : "unknown";
+}
+
+const char* toMessageTypeName(const int64_t type) {
+    switch (type) {
+        case 1:
+            return "eos";
+        case 2:
+            return "error";
+        case 4:
+            return "warning";
+        default:
+            return "unknown";
+    }
+}
+
+// Symbolic name of a value, nullptr if the value is a plain number
+const char* getValueSymbol(const EventType type, const size_t index, const int64_t value) {
+    switch (type) {
+        case EventType::Command:
+            return index == 0 && value >= 0 && value <= static_cast<int64_t>(CommandPriority::Background)
+                       ? toString(static_cast<CommandPriority>(value)) : nullptr;
+        case EventType::StateChange:
+            return toStateName(value);
+        case EventType::Probe:
+            return index == 0 ? toString(static_cast<ProbeAction>(value)) : nullptr;
+        case EventType::BusMessage:
+            return index == 0 ? toMessageTypeName(value) : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+void writeJsonString(std::ostream& out, const std::string_view text) {
+    out << '"';
+    for (const auto c: text) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\r':
+                out << "\\r";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out << escaped;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+void printRecord(const EventRecordHeader& record, const std::string_view text, const bool json) {
+    const auto type = static_cast<EventType>(record.type);
+    const auto [first_name, second_name] = getValueNames(type);
+    const char* names[] = {first_name, second_name};
+
+    if (json) {
+        std::cout << "{\"timestamp_ns\":" << record.timestamp_ns << ",\"type\":\"" << toString(type) << '"';
+        for (size_t i = 0; i < 2; ++i) {
+            std::cout << ",\"" << names[i] << "\":";
+            if (const auto symbol = getValueSymbol(type, i, record.values[i])) {
+                std::cout << '"' << symbol << '"';
+            } else {
+                std::cout << record.values[i];
+            }
+        }
+        std::cout << ",\"text\":";
+        writeJsonString(std::cout, text);
+        std::cout << "}\n";
+        return;
+    }
+
+    std::cout << formatTimestamp(record.timestamp_ns) << ' ' << toString(type);
+    for (size_t i = 0; i < 2; ++i) {
+        std::cout << ' ' << names[i] << '=';
+        if (const auto symbol = getValueSymbol(type, i, record.values[i])) {
+            std::cout << symbol;
+        } else {
+            std::cout << record.values[i];
+        }
+    }
+    std::cout << " '" << text << "'\n";
+}
+
+// Prints records up to the first empty one, which marks the end of the data or a record torn by a crash
+size_t printSegment(const SegmentFile& segment, const bool json) {
+    size_t count = 0;
+    auto offset = alignRecordSize(segment.header.header_size);
+    while (offset + sizeof(EventRecordHeader) <= segment.data.size()) {
+        EventRecordHeader record;
+        std::memcpy(&record, segment.data.data() + offset, sizeof(record));
+        if (record.size == 0) {
+            break;
+        }
+        if (record.size < sizeof(record) + record.text_size || offset + record.size > segment.data.size()) {
+            std::cerr << segment.path.string() << ": corrupt record at offset " << offset << std::endl;
+            break;
+        }
+
+        printRecord(record, {segment.data.data() + offset + sizeof(record), record.text_size}, json);
+        offset += record.size;
+        ++count;
+    }
+    return count;
+}
+}
+
+int main(const int argc, const char* argv[]) {
+    cxxopts::Options options(argv[0], "Prints the records of binary event log segments in time order");
+    options.add_options()
+        ("j,json", "Print one JSON object per record", cxxopts::value<bool>()->default_value("false"))
+        ("files", "Event log directories or segment files", cxxopts::value<std::vector<std::string>>())
+        ("h,help", "Print usage");
+    options.parse_positional({"files"});
+    options.positional_help("<directory|segment>...");
+
+    const auto result = options.parse(argc, argv);
+
+    if (result.count("help") || !result.count("files")) {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    std::vector<SegmentFile> segments;
+    for (const auto& path: collectPaths(result["files"].as<std::vector<std::string>>())) {
+        if (SegmentFile segment; readSegment(path, segment)) {
+            segments.push_back(std::move(segment));
+        }
+    }
+    std::sort(segments.begin(), segments.end(), [](const SegmentFile& lhs, const SegmentFile& rhs) {
+        return lhs.header.segment_index < rhs.header.segment_index;
+    });
+
+    // Records are ordered by reservation, timestamps of concurrent writers may be slightly out of order
+    size_t count = 0;
+    for (const auto& segment: segments) {
+        count += printSegment(segment, result["json"].as<bool>());
+    }
+    std::cerr << count << " records in " << segments.size() << " segments" << std::endl;
+
+    return segments.empty() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "cxxopts.hpp"
+#include "Pipeline/FrameRingFormat.h"
+
+// Reference consumer of a frame-export element: maps the ring, follows the frames with its own cursor and reports
+// the frame rate, the frames it lost to the producer and the caps once a second.
+namespace {
+struct Ring {
+    int memfd{-1};
+    int event_fd{-1};
+    uint32_t consumer_index{FRAME_RING_NO_CONSUMER};
+    size_t size{0};
+    FrameRingHeader* header{nullptr};
+};
+
+bool connectRing(const std::string& socket_name, Ring& ring, int& connection) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_name.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket name too long" << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, socket_name.data(), socket_name.size());
+    if (socket_name.front() == '@') {
+        address.sun_path[0] = '\0';
+    }
+    const auto address_size = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + socket_name.size() +
+                                                     (socket_name.front() == '@' ? 0 : 1));
+
+    connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0 || connect(connection, reinterpret_cast<sockaddr*>(&address), address_size) < 0) {
+        std::cerr << "Failed to connect to " << socket_name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Sent once the producer got its first frame
+    FrameRingHandshake handshake{};
+    iovec data{&handshake, sizeof(handshake)};
+    alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))]{};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(connection, &message, MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(sizeof(handshake)) ||
+        std::memcmp(handshake.magic, FRAME_RING_MAGIC, sizeof(FRAME_RING_MAGIC)) != 0 ||
+        handshake.version != FRAME_RING_VERSION) {
+        std::cerr << "Invalid handshake from " << socket_name << std::endl;
+        return false;
+    }
+    if (handshake.consumer_index == FRAME_RING_NO_CONSUMER) {
+        std::cerr << "Refused by " << socket_name << ", too many consumers" << std::endl;
+        return false;
+    }
+    const auto control_message = CMSG_FIRSTHDR(&message);
+    if (!control_message || control_message->cmsg_type != SCM_RIGHTS ||
+        control_message->cmsg_len != CMSG_LEN(2 * sizeof(int))) {
+        std::cerr << "No ring descriptors from " << socket_name << std::endl;
+        return false;
+    }
+    int fds[2];
+    std::memcpy(fds, CMSG_DATA(control_message), sizeof(fds));
+    ring.memfd = fds[0];
+    ring.event_fd = fds[1];
+    ring.consumer_index = handshake.consumer_index;
+    ring.size = handshake.ring_size;
+
+    const auto address_space = mmap(nullptr, ring.size, PROT_READ | PROT_WRITE, MAP_SHARED, ring.memfd, 0);
+    if (address_space == MAP_FAILED) {
+        std::cerr << "Failed to map the ring: " << strerror(errno) << std::endl;
+        return false;
+    }
+    ring.header = static_cast<FrameRingHeader*>(address_space);
+    return true;
+}
+
+std::string readCaps(const FrameRingHeader& header) {
+    while (true) {
+        const auto before = header.caps_sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::string caps(header.caps, strnlen(header.caps, FRAME_RING_MAX_CAPS_SIZE));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header.caps_sequence.load(std::memory_order_relaxed) == before) {
+            return caps;
+        }
+    }
+}
+}
+
+int main(const int argc, const char* argv[]) {
+    cxxopts::Options options(argv[0], "Reads the frames of a frame-export element");
+    options.add_options()
+        ("s,socket", "Socket of the frame-export element, a leading @ selects the abstract namespace", cxxopts::value<std::string>())
+        ("delay", "Simulated processing time of a frame in ms", cxxopts::value<unsigned int>()->default_value("0"))
+        ("duration", "Seconds to read for, 0 reads until the producer hangs up", cxxopts::value<unsigned int>()->default_value("0"))
+        ("h,help", "Print usage");
+    const auto result = options.parse(argc, argv);
+    if (result.count("help") || !result.count("socket")) {
+        std::cout << options.help() << std::endl;
+        return result.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    const auto socket_name = result["socket"].as<std::string>();
+    const auto delay = std::chrono::milliseconds(result["delay"].as<unsigned int>());
+    const auto duration = std::chrono::seconds(result["duration"].as<unsigned int>());
+
+    Ring ring;
+    auto connection = -1;
+    if (!connectRing(socket_name, ring, connection)) {
+        return EXIT_FAILURE;
+    }
+    auto& header = *ring.header;
+    auto& cursor = header.cursors[ring.consumer_index];
+    std::cout << "Consumer " << ring.consumer_index << ": " << header.slot_count << " slots of "
+              << header.slot_capacity << " bytes" << std::endl;
+
+    auto next_sequence = cursor.read_sequence.load(std::memory_order_acquire);
+    uint64_t dropped = 0;
+    uint64_t frames = 0;
+    uint64_t caps_sequence = 0;
+    uint64_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto report_time = start + std::chrono::seconds(1);
+    while (duration.count() == 0 || std::chrono::steady_clock::now() - start < duration) {
+        pollfd poll_fds[] {{ring.event_fd, POLLIN, 0}, {connection, POLLIN, 0}};
+        if (poll(poll_fds, 2, 1000) < 0 && errno != EINTR) {
+            break;
+        }
+        if (poll_fds[1].revents) {
+            std::cout << "Producer hung up" << std::endl;
+            break;
+        }
+        uint64_t signalled;
+        while (read(ring.event_fd, &signalled, sizeof(signalled)) > 0) {}
+
+        while (true) {
+            const auto write_sequence = header.write_sequence.load(std::memory_order_acquire);
+            if (next_sequence > write_sequence) {
+                break;
+            }
+            // A full ring behind, the oldest frames are the next ones overwritten
+            if (write_sequence - next_sequence + 1 >= header.slot_count) {
+                dropped += write_sequence - next_sequence;
+                next_sequence = write_sequence;
+            }
+            const auto slot_address = reinterpret_cast<const char*>(ring.header) + header.slot_offset +
+                                      next_sequence % header.slot_count * header.slot_stride;
+            const auto& slot = *reinterpret_cast<const FrameSlotHeader*>(slot_address);
+            if (slot.sequence.load(std::memory_order_acquire) != next_sequence) {
+                ++dropped;
+                ++next_sequence;
+                continue;
+            }
+
+            // The frame is processed in place, it is only valid if the slot was not rewritten meanwhile
+            const auto frame_caps_sequence = slot.caps_sequence;
+            const auto size = slot.size;
+            const auto data = reinterpret_cast<const unsigned char*>(slot_address + FRAME_SLOT_DATA_OFFSET);
+            checksum += size ? data[0] + data[size - 1] : 0;
+            std::this_thread::sleep_for(delay);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != next_sequence) {
+                ++dropped;
+            } else {
+                ++frames;
+                if (frame_caps_sequence != caps_sequence) {
+                    caps_sequence = frame_caps_sequence;
+                    std::cout << "Caps: " << readCaps(header) << std::endl;
+                }
+            }
+            ++next_sequence;
+            cursor.read_sequence.store(next_sequence, std::memory_order_release);
+            cursor.dropped.store(dropped, std::memory_order_relaxed);
+            // A consumer that never catches up still reports
+            if (std::chrono::steady_clock::now() >= report_time) {
+                break;
+            }
+        }
+
+        if (const auto now = std::chrono::steady_clock::now(); now >= report_time) {
+            std::cout << frames << " frames/s, " << dropped << " dropped, last frame " << next_sequence - 1 << std::endl;
+            frames = 0;
+            report_time = now + std::chrono::seconds(1);
+        }
+    }
+
+    munmap(ring.header, ring.size);
+    close(ring.memfd);
+    close(ring.event_fd);
+    close(connection);
+    std::cout << "Checksum of the frame edges " << checksum << std::endl;
+    return EXIT_SUCCESS;
+}
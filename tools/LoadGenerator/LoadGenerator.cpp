@@ -0,0 +1,230 @@
+#include "LoadGenerator.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fmt/format.h>
+#include "Logger/Logger.h"
+
+constexpr size_t MAX_RESPONSE_SIZE {1024};
+
+double LoadReport::throughput() const {
+    return elapsed_seconds > 0 ? static_cast<double>(acked + nacked) / elapsed_seconds : 0;
+}
+
+namespace {
+uint64_t percentile_of(const std::vector<uint64_t>& sorted_latencies_us, const double fraction) {
+    if (sorted_latencies_us.empty()) {
+        return 0;
+    }
+
+    const auto index = static_cast<size_t>(fraction * static_cast<double>(sorted_latencies_us.size() - 1));
+    return sorted_latencies_us.at(index);
+}
+
+// Returns the outcome line of a command, skipping its acceptance line. Empty while it has not arrived completely.
+std::string_view find_outcome(std::string_view received) {
+    for (auto line_end = received.find('\n'); line_end != std::string_view::npos; line_end = received.find('\n')) {
+        const auto line = received.substr(0, line_end);
+        if (line.find("Accepted id=") == std::string_view::npos) {
+            return line;
+        }
+        received.remove_prefix(line_end + 1);
+    }
+    return {};
+}
+}
+
+uint64_t LoadReport::percentile(const double fraction) const {
+    return percentile_of(latencies_us, fraction);
+}
+
+std::string LoadReport::toString() const {
+    auto text = fmt::format("sent {} ack {} nack {} failed {} (timed out {}) in {:.2f}s, throughput {:.1f} cmd/s, "
+                            "rtt p50 {}us p99 {}us p999 {}us max {}us",
+                            sent, acked, nacked, failed, timed_out, elapsed_seconds, throughput(),
+                            percentile(0.5), percentile(0.99), percentile(0.999),
+                            latencies_us.empty() ? 0 : latencies_us.back());
+    // A mix is broken down per command, e.g. to see stop or disable_branches through a toggle storm
+    if (command_latencies_us.size() > 1) {
+        for (const auto& [command, command_latencies]: command_latencies_us) {
+            text += fmt::format("\n  '{}': {} replies, rtt p50 {}us p99 {}us max {}us", command, command_latencies.size(),
+                                percentile_of(command_latencies, 0.5), percentile_of(command_latencies, 0.99),
+                                command_latencies.empty() ? 0 : command_latencies.back());
+        }
+    }
+    return text;
+}
+
+LoadGenerator::LoadGenerator(LoadGeneratorConfig config) : config_(std::move(config)) {}
+
+std::error_code LoadGenerator::connectClient(int& client_socket) const {
+    client_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client_socket < 0) {
+        return {errno, std::generic_category()};
+    }
+
+    constexpr int no_delay = 1;
+    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    constexpr timeval receive_timeout {1, 0};
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+
+    sockaddr_in server_address{};
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(config_.port);
+    if (inet_pton(AF_INET, config_.host.c_str(), &server_address.sin_addr) != 1) {
+        close(client_socket);
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    if (connect(client_socket, reinterpret_cast<sockaddr*>(&server_address), sizeof(server_address)) != 0) {
+        const std::error_code ec {errno, std::generic_category()};
+        close(client_socket);
+        return ec;
+    }
+
+    return {};
+}
+
+void LoadGenerator::runConnection(int& client_socket, const unsigned int connection_index, LoadReport& report) const {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> weights;
+    for (const auto& [command, weight]: config_.command_mix) {
+        weights.push_back(weight);
+    }
+    std::mt19937 generator(connection_index);
+    std::discrete_distribution<size_t> pick_command(weights.begin(), weights.end());
+
+    // Open loop pacing: latency is measured from the intended send time, so a stalled server
+    // shows up as latency instead of silently lowering the offered load
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(config_.connections / config_.rate));
+    const auto start = Clock::now();
+    const auto end = start + config_.duration;
+    auto next_send = start + interval * connection_index / config_.connections;
+
+    std::array<char, MAX_RESPONSE_SIZE> response{};
+    report.latencies_us.reserve(static_cast<size_t>(config_.rate * config_.duration.count() / config_.connections) + 1);
+
+    while (next_send < end) {
+        std::this_thread::sleep_until(next_send);
+
+        const auto& command = config_.command_mix.at(pick_command(generator)).first;
+        ++report.sent;
+        if (send(client_socket, command.data(), command.size(), MSG_NOSIGNAL) < 0) {
+            ++report.failed;
+            break;
+        }
+
+        // The outcome follows the acceptance line, in the same segment or a later one
+        std::string_view reply;
+        size_t received{0};
+        ssize_t bytes_read{0};
+        while (reply.empty()) {
+            bytes_read = recv(client_socket, response.data() + received, response.size() - received, 0);
+            if (bytes_read <= 0) {
+                break;
+            }
+            received += static_cast<size_t>(bytes_read);
+            reply = find_outcome(std::string_view(response.data(), received));
+            if (reply.empty() && received == response.size()) {
+                bytes_read = -1;
+                break;
+            }
+        }
+        const auto now = Clock::now();
+        if (bytes_read == 0) {
+            ++report.failed;
+            break;
+        }
+        if (bytes_read < 0) {
+            // The reply may still arrive and would be taken for the next command's, so the
+            // connection is replaced instead of reused
+            ++report.failed;
+            ++report.timed_out;
+            close(client_socket);
+            client_socket = -1;
+            if (const auto ec = connectClient(client_socket)) {
+                LOG_ERROR("Connection {} failed to reconnect: {}", connection_index, ec.message());
+                client_socket = -1;
+                break;
+            }
+        } else {
+            reply.rfind("Nack", 0) == 0 ? ++report.nacked : ++report.acked;
+            const auto latency_us = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(now - next_send).count());
+            report.latencies_us.push_back(latency_us);
+            report.command_latencies_us[command].push_back(latency_us);
+        }
+
+        next_send += interval;
+    }
+}
+
+std::error_code LoadGenerator::run(LoadReport& report) const {
+    if (config_.connections == 0 || config_.rate <= 0 || config_.command_mix.empty()) {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    std::vector<int> sockets(config_.connections, -1);
+    for (auto& client_socket: sockets) {
+        if (auto ec = connectClient(client_socket)) {
+            LOG_ERROR("Failed to connect to {}:{}: {}", config_.host, config_.port, ec.message());
+            for (const auto opened: sockets) {
+                if (opened >= 0) {
+                    close(opened);
+                }
+            }
+            return ec;
+        }
+    }
+
+    LOG_INFO("Connected {} clients to {}:{}", sockets.size(), config_.host, config_.port);
+
+    std::vector<LoadReport> connection_reports(sockets.size());
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < sockets.size(); ++i) {
+        threads.emplace_back(&LoadGenerator::runConnection, this, std::ref(sockets.at(i)), i,
+                             std::ref(connection_reports.at(i)));
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    report.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto client_socket: sockets) {
+        if (client_socket >= 0) {
+            close(client_socket);
+        }
+    }
+
+    for (auto& connection_report: connection_reports) {
+        report.sent += connection_report.sent;
+        report.acked += connection_report.acked;
+        report.nacked += connection_report.nacked;
+        report.failed += connection_report.failed;
+        report.timed_out += connection_report.timed_out;
+        report.latencies_us.insert(report.latencies_us.end(), connection_report.latencies_us.begin(),
+                                   connection_report.latencies_us.end());
+        for (const auto& [command, command_latencies]: connection_report.command_latencies_us) {
+            auto& merged = report.command_latencies_us[command];
+            merged.insert(merged.end(), command_latencies.begin(), command_latencies.end());
+        }
+    }
+    std::sort(report.latencies_us.begin(), report.latencies_us.end());
+    for (auto& [command, command_latencies]: report.command_latencies_us) {
+        std::sort(command_latencies.begin(), command_latencies.end());
+    }
+
+    return {};
+}
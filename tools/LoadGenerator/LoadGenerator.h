@@ -0,0 +1,47 @@
+#ifndef PERIPHERY_MANAGER_LOADGENERATOR_H
+#define PERIPHERY_MANAGER_LOADGENERATOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <system_error>
+#include <vector>
+
+struct LoadGeneratorConfig {
+    std::string host;
+    unsigned int port;
+    unsigned int connections;
+    double rate; // Commands per second across all connections
+    std::chrono::seconds duration;
+    std::vector<std::pair<std::string, double>> command_mix; // Command name and its relative weight
+};
+
+struct LoadReport {
+    uint64_t sent{0};
+    uint64_t acked{0};
+    uint64_t nacked{0};
+    uint64_t failed{0};
+    uint64_t timed_out{0}; // Included in failed, each one replaced its connection
+    double elapsed_seconds{0};
+    std::vector<uint64_t> latencies_us;
+    std::map<std::string, std::vector<uint64_t>> command_latencies_us;
+
+    double throughput() const;
+    uint64_t percentile(double fraction) const;
+    std::string toString() const;
+};
+
+class LoadGenerator {
+public:
+    explicit LoadGenerator(LoadGeneratorConfig config);
+    ~LoadGenerator() = default;
+    std::error_code run(LoadReport& report) const;
+
+private:
+    std::error_code connectClient(int& client_socket) const;
+    void runConnection(int& client_socket, unsigned int connection_index, LoadReport& report) const;
+    LoadGeneratorConfig config_;
+};
+
+#endif //PERIPHERY_MANAGER_LOADGENERATOR_H
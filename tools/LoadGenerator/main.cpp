@@ -0,0 +1,75 @@
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include "cxxopts.hpp"
+#include "Logger/Logger.h"
+#include "LoadGenerator.h"
+
+// Parses "test:80,enable timeoverlay:10,disable timeoverlay:10" into commands and weights, false on an entry without
+// a command or with a weight that is not a positive number
+bool parse_command_mix(const std::string& mix, std::vector<std::pair<std::string, double>>& command_mix) {
+    std::istringstream stream(mix);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        const auto separator = entry.find(':');
+        const auto command = entry.substr(0, separator);
+        auto weight = 1.0;
+        if (separator != std::string::npos) {
+            const auto* begin = entry.data() + separator + 1;
+            const auto* end = entry.data() + entry.size();
+            if (const auto [last, ec] = std::from_chars(begin, end, weight); ec != std::errc() || last != end) {
+                weight = 0;
+            }
+        }
+        if (command.empty() || !std::isfinite(weight) || weight <= 0) {
+            LOG_ERROR("Invalid command mix entry '{}', expected <command>[:<weight>] with a positive weight", entry);
+            return false;
+        }
+        command_mix.emplace_back(command, weight);
+    }
+    return true;
+}
+
+int main(const int argc, const char* argv[]) {
+    cxxopts::Options options(argv[0], "Control plane load generator");
+    options.add_options()
+        ("a,address", "Server IPv4 address", cxxopts::value<std::string>()->default_value("127.0.0.1"))
+        ("p,port", "Server TCP port", cxxopts::value<unsigned int>()->default_value("12345"))
+        ("c,connections", "Number of concurrent connections", cxxopts::value<unsigned int>()->default_value("8"))
+        ("r,rate", "Total commands per second", cxxopts::value<double>()->default_value("1000"))
+        ("d,duration", "Test duration in seconds", cxxopts::value<unsigned int>()->default_value("10"))
+        ("m,mix", "Command mix as name:weight pairs", cxxopts::value<std::string>()->default_value("test:1"))
+        ("h,help", "Print usage");
+
+    const auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<std::pair<std::string, double>> command_mix;
+    if (!parse_command_mix(result["mix"].as<std::string>(), command_mix)) {
+        return EXIT_FAILURE;
+    }
+
+    const LoadGeneratorConfig config {
+        .host = result["address"].as<std::string>(),
+        .port = result["port"].as<unsigned int>(),
+        .connections = result["connections"].as<unsigned int>(),
+        .rate = result["rate"].as<double>(),
+        .duration = std::chrono::seconds(result["duration"].as<unsigned int>()),
+        .command_mix = std::move(command_mix)
+    };
+
+    LoadReport report;
+    if (const auto ec = LoadGenerator(config).run(report)) {
+        LOG_ERROR("Load generation failed: {}", ec.message());
+        return EXIT_FAILURE;
+    }
+
+    LOG_INFO("{}", report.toString());
+
+    return report.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
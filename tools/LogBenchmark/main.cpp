@@ -0,0 +1,80 @@
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include "cxxopts.hpp"
+#include "Logger/Logger.h"
+
+namespace {
+// Discards messages after formatting, so the measurement excludes the output
+class NullLogAdapter : public LoggerInterface {
+public:
+    void setLogLevel(LogLevel) override {}
+
+protected:
+    void logImpl(LogLevel, const std::string_view msg) override {
+        size_ += msg.size();
+    }
+
+private:
+    size_t size_ {0};
+};
+
+// Stands in for PipelineElement::toString(), which builds its text with an ostringstream
+std::string describeElement(const std::map<std::string, std::string>& properties) {
+    std::ostringstream oss;
+    oss << "'queue";
+    for (const auto& [key, value] : properties) {
+        oss << " " << key << "=" << value;
+    }
+    oss << " (main)'";
+    return oss.str();
+}
+
+template<typename Function>
+double measureNanoseconds(const unsigned int iterations, Function&& function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; ++i) {
+        function(i);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+}
+
+int main(const int argc, const char* argv[]) {
+    cxxopts::Options options(argv[0], "Logger call cost benchmark");
+    options.add_options()
+        ("n,iterations", "Calls per measurement", cxxopts::value<unsigned int>()->default_value("1000000"))
+        ("h,help", "Print usage");
+
+    const auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const auto iterations = result["iterations"].as<unsigned int>();
+    const std::map<std::string, std::string> properties {{"max-size-buffers", "200"}, {"leaky", "2"}};
+
+    Logger::getInstance().setAdapter(std::make_shared<NullLogAdapter>());
+    SET_LOG_LEVEL(LoggerInterface::LogLevel::Info);
+
+    const auto disabled = measureNanoseconds(iterations, [&properties](const unsigned int i) {
+        LOG_DEBUG("Linked element {} iteration {}", describeElement(properties), i);
+    });
+    const auto enabled = measureNanoseconds(iterations, [&properties](const unsigned int i) {
+        LOG_INFO("Linked element {} iteration {}", describeElement(properties), i);
+    });
+    const auto enabled_plain = measureNanoseconds(iterations, [](const unsigned int i) {
+        LOG_INFO("Linked element queue iteration {}", i);
+    });
+
+    std::cout << "LOG_ACTIVE_LEVEL " << LOG_ACTIVE_LEVEL << ", " << iterations << " calls each\n"
+              << "disabled level, expensive argument: " << disabled << " ns/call\n"
+              << "enabled level, expensive argument:  " << enabled << " ns/call\n"
+              << "enabled level, plain arguments:     " << enabled_plain << " ns/call" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fmt/format.h>
+#include "cxxopts.hpp"
+#include "AppInputs/MessageServer.h"
+#include "Logger/Logger.h"
+#include "Network/TcpNetworkManager.h"
+#include "Network/UringNetworkManager.h"
+#include "TasksManager/CommandDispatcher.h"
+#include "TasksManager/Scheduler.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkResult {
+    uint64_t round_trips {0};
+    uint64_t failed {0};
+    double elapsed_seconds {0};
+    uint64_t io_syscalls {0};
+    std::vector<uint64_t> latencies_us;
+};
+
+int connect_client(const unsigned int port) {
+    const int client_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client_socket < 0) {
+        return -1;
+    }
+
+    constexpr int no_delay = 1;
+    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    sockaddr_in server_address{};
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(port);
+    server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // The server starts listening on its own thread
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        if (connect(client_socket, reinterpret_cast<sockaddr*>(&server_address), sizeof(server_address)) == 0) {
+            return client_socket;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    close(client_socket);
+    return -1;
+}
+
+// Keeps one command in flight on each of its connections until every connection completed its round trips
+void run_clients(const std::vector<int>& client_sockets, const unsigned int round_trips, BenchmarkResult& result) {
+    constexpr std::string_view COMMAND {"test"};
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Clock::time_point> sent_at(client_sockets.size());
+    std::vector<unsigned int> remaining(client_sockets.size(), round_trips);
+    size_t active = 0;
+    for (size_t i = 0; i < client_sockets.size(); ++i) {
+        epoll_event event {EPOLLIN, {.u64 = i}};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_sockets[i], &event);
+        sent_at[i] = Clock::now();
+        if (send(client_sockets[i], COMMAND.data(), COMMAND.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(COMMAND.size())) {
+            ++active;
+        } else {
+            ++result.failed;
+            remaining[i] = 0;
+        }
+    }
+
+    std::array<epoll_event, 64> events{};
+    std::array<char, 256> response{};
+    while (active > 0) {
+        const int ready = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), 1000);
+        if (ready <= 0) {
+            result.failed += active;
+            break;
+        }
+        for (int e = 0; e < ready; ++e) {
+            const auto i = static_cast<size_t>(events[e].data.u64);
+            const auto bytes_read = recv(client_sockets[i], response.data(), response.size(), 0);
+            const auto now = Clock::now();
+            if (bytes_read <= 0 || std::string_view(response.data(), 3) != "Ack") {
+                ++result.failed;
+                remaining[i] = 0;
+                --active;
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_sockets[i], nullptr);
+                continue;
+            }
+            result.latencies_us.push_back(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(now - sent_at[i]).count()));
+            ++result.round_trips;
+            if (--remaining[i] == 0) {
+                --active;
+                continue;
+            }
+            sent_at[i] = now;
+            if (send(client_sockets[i], COMMAND.data(), COMMAND.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(COMMAND.size())) {
+                ++result.failed;
+                remaining[i] = 0;
+                --active;
+            }
+        }
+    }
+    close(epoll_fd);
+}
+
+bool run_benchmark(const std::shared_ptr<NetworkInterface>& network_manager, const unsigned int port,
+                   const unsigned int connections, const unsigned int client_threads, const unsigned int round_trips,
+                   BenchmarkResult& result) {
+    // The commands are answered on the scheduler like in the application, without a pipeline behind them
+    auto scheduler = std::make_shared<Scheduler>();
+    scheduler->init();
+    auto dispatcher = std::make_shared<CommandDispatcher>(scheduler);
+    dispatcher->registerCommand("test", std::make_shared<CommandFake>(), CommandPriority::Query);
+    const auto server = std::make_shared<MessageServer>(dispatcher, network_manager);
+    server->init();
+
+    std::vector<std::vector<int>> client_sockets(client_threads);
+    auto connected = true;
+    for (unsigned int i = 0; i < connections && connected; ++i) {
+        const int client_socket = connect_client(port);
+        connected = client_socket >= 0;
+        if (connected) {
+            client_sockets[i % client_threads].push_back(client_socket);
+        }
+    }
+    // Every connection is accepted before the measurement starts
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    if (connected) {
+        std::vector<BenchmarkResult> thread_results(client_threads);
+        const auto io_syscalls_before = network_manager->getIoSyscallCount();
+        const auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < client_threads; ++i) {
+            threads.emplace_back(run_clients, std::cref(client_sockets[i]), round_trips, std::ref(thread_results[i]));
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        result.elapsed_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        result.io_syscalls = network_manager->getIoSyscallCount() - io_syscalls_before;
+        for (const auto& thread_result: thread_results) {
+            result.round_trips += thread_result.round_trips;
+            result.failed += thread_result.failed;
+            result.latencies_us.insert(result.latencies_us.end(), thread_result.latencies_us.begin(),
+                                       thread_result.latencies_us.end());
+        }
+        std::sort(result.latencies_us.begin(), result.latencies_us.end());
+    }
+
+    for (const auto& sockets: client_sockets) {
+        for (const auto client_socket: sockets) {
+            close(client_socket);
+        }
+    }
+    server->deinit();
+    scheduler->deinit();
+    return connected;
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted_latencies_us, const double fraction) {
+    if (sorted_latencies_us.empty()) {
+        return 0;
+    }
+    return sorted_latencies_us.at(static_cast<size_t>(fraction * static_cast<double>(sorted_latencies_us.size() - 1)));
+}
+}
+
+int main(const int argc, const char* argv[]) {
+    cxxopts::Options options(argv[0], "Compares the syscalls and round trip latency of the control network backends "
+                                      "with many concurrent clients, each keeping one command in flight");
+    options.add_options()
+        ("b,backend", "Backends to measure (select, io_uring, both)", cxxopts::value<std::string>()->default_value("both"))
+        ("p,port", "Loopback TCP port to serve on, the io_uring backend uses the next one", cxxopts::value<unsigned int>()->default_value("23470"))
+        ("c,connections", "Concurrent client connections", cxxopts::value<unsigned int>()->default_value("256"))
+        ("t,client-threads", "Client threads sharing the connections", cxxopts::value<unsigned int>()->default_value("4"))
+        ("n,round-trips", "Round trips per connection", cxxopts::value<unsigned int>()->default_value("200"))
+        ("h,help", "Print usage");
+
+    const auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const auto backend = result["backend"].as<std::string>();
+    const auto port = result["port"].as<unsigned int>();
+    const auto connections = std::max(1u, result["connections"].as<unsigned int>());
+    const auto client_threads = std::clamp(result["client-threads"].as<unsigned int>(), 1u, connections);
+    const auto round_trips = std::max(1u, result["round-trips"].as<unsigned int>());
+
+    SET_LOG_LEVEL(LoggerInterface::LogLevel::Warn);
+    std::vector<std::pair<std::string, std::shared_ptr<NetworkInterface>>> backends;
+    if (backend == "select" || backend == "both") {
+        backends.emplace_back("select", std::make_shared<TcpNetworkManager>(static_cast<int>(port)));
+    }
+    if (backend == "io_uring" || backend == "both") {
+        if (!UringNetworkManager::isSupported()) {
+            LOG_ERROR("io_uring is not supported by the kernel");
+            return EXIT_FAILURE;
+        }
+        backends.emplace_back("io_uring", std::make_shared<UringNetworkManager>(static_cast<int>(port + 1)));
+    }
+    if (backends.empty()) {
+        LOG_ERROR("Unknown backend '{}'", backend);
+        return EXIT_FAILURE;
+    }
+
+    auto failed = false;
+    for (unsigned int i = 0; i < backends.size(); ++i) {
+        const auto& [name, network_manager] = backends[i];
+        BenchmarkResult benchmark;
+        if (!run_benchmark(network_manager, port + (name == "io_uring" ? 1 : 0), connections, client_threads, round_trips,
+                           benchmark)) {
+            LOG_ERROR("Cannot connect to the {} backend", name);
+            return EXIT_FAILURE;
+        }
+        failed = failed || benchmark.failed != 0;
+        std::cout << fmt::format("{:>8}: {} connections, {} round trips ({} failed) in {:.2f}s, {:.0f} round trips/s, "
+                                 "rtt p50 {}us p99 {}us p999 {}us, {} io syscalls ({:.2f} per round trip)",
+                                 name, connections, benchmark.round_trips, benchmark.failed, benchmark.elapsed_seconds,
+                                 static_cast<double>(benchmark.round_trips) / benchmark.elapsed_seconds,
+                                 percentile(benchmark.latencies_us, 0.5), percentile(benchmark.latencies_us, 0.99),
+                                 percentile(benchmark.latencies_us, 0.999), benchmark.io_syscalls,
+                                 benchmark.round_trips ? static_cast<double>(benchmark.io_syscalls) /
+                                                         static_cast<double>(benchmark.round_trips) : 0.0)
+                  << std::endl;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}